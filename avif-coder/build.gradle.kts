@@ -110,6 +110,10 @@ android {
                 )
 //                abiFilters += setOf("arm64-v8a")
                 abiFilters += setOf( "arm64-v8a", "armeabi-v7a", "x86_64", "x86")
+                // -PavifweaverFromSource builds avifpixart with nightly cargo instead of lib/*/libavifweaver.a
+                if (project.hasProperty("avifweaverFromSource")) {
+                    arguments += "-DAVIFWEAVER_FROM_SOURCE=ON"
+                }
             }
         }
 
@@ -29,6 +29,7 @@
 #include "AvifDecoderController.h"
 #include "avif/avif.h"
 #include <exception>
+#include <algorithm>
 #include <thread>
 #include "imagebits/CopyUnalignedRGBA.h"
 #include "colorspace.h"
@@ -38,15 +39,18 @@
 #include <ITUR.h>
 #include "ColorMatrix.h"
 #include "avifweaver.h"
+#include "AvifImageConversion.h"
+#include "ReformatBitmap.h"
+#include "JniException.h"
 #include <android/log.h>
 
 class AvifUniqueImage {
  public:
   avifRGBImage rgbImage;
 
-  AvifUniqueImage(avifDecoder *decoder) {
+  AvifUniqueImage(const avifImage *image) {
     rgbImage = {0};
-    avifRGBImageSetDefaults(&rgbImage, decoder->image);
+    avifRGBImageSetDefaults(&rgbImage, image);
     rgbImage.format = AVIF_RGB_FORMAT_RGBA;
   }
 
@@ -76,12 +80,51 @@ class AvifUniqueImage {
   bool isPlanesAllocated = false;
 };
 
+/**
+ * Rows of intermediate RGBA converted at once, band is bounded in bytes so wide images
+ * don't make it grow, and it starts on even rows as 4:2:0 conversion needs
+ */
+static uint32_t ConversionStripRows(uint32_t rgbaStride, uint32_t height) {
+  constexpr uint32_t kStripBytes = 16 * 1024 * 1024;
+  uint32_t rows = std::max(kStripBytes / std::max(rgbaStride, 1u), 16u) & ~1u;
+  return std::min(rows, height);
+}
+
+/**
+ * Converts image band by band straight into final bitmap format: each band goes from YUV
+ * to RGBA, through color management and alpha premultiplication and is packed into the output,
+ * so besides the output only one band of RGBA is alive
+ */
+static void ConvertAvifImageInStrips(const avifImage *image,
+                                     PreferredColorConfig config,
+                                     bool hasAlpha,
+                                     CurveToneMapper toneMapper,
+                                     uint8_t *dst,
+                                     uint32_t dstStride) {
+  bool is16Bit = avifImageUsesU16(image);
+  uint32_t rgbaStride = image->width * 4 * (is16Bit ? sizeof(uint16_t) : sizeof(uint8_t));
+
+  uint32_t stripRows = ConversionStripRows(rgbaStride, image->height);
+  aligned_uint8_vector strip(rgbaStride * stripRows);
+  for (uint32_t y = 0; y < image->height; y += stripRows) {
+    uint32_t rows = std::min(stripRows, image->height - y);
+    ConvertAvifYuvRowsInto(image, strip.data(), rgbaStride, y, rows);
+    ApplyAvifColorManagement(image, strip, rgbaStride, image->width, rows, toneMapper);
+    coder::ReformatColorConfigInto(strip, rgbaStride, is16Bit, config, image->depth,
+                                   image->width, rows, dst + y * dstStride, dstStride,
+                                   false, hasAlpha);
+  }
+}
+
 AvifImageFrame AvifDecoderController::getFrame(uint32_t frame,
                                                uint32_t scaledWidth,
                                                uint32_t scaledHeight,
                                                PreferredColorConfig javaColorSpace,
                                                ScaleMode javaScaleMode,
-                                               int scalingQuality) {
+                                               int scalingQuality,
+                                               const ImageRegion *region,
+                                               CurveToneMapper toneMapper,
+                                               const FrameTargetProvider &target) {
   std::lock_guard guard(this->mutex);
   if (!this->isBufferAttached) {
     throw std::runtime_error("AVIF controller methods can't be called without attached buffer");
@@ -92,23 +135,133 @@ AvifImageFrame AvifDecoderController::getFrame(uint32_t frame,
     throw std::runtime_error(str);
   }
 
+  // Grid cells outside of the region are not decoded at all. Region view may start a pixel
+  // earlier for subsampled chroma, so the region is widened to even coordinates.
+  avifCropRect regionOfInterest = {0, 0, 0, 0};
+  if (region) {
+    regionOfInterest.x = region->x & ~1u;
+    regionOfInterest.y = region->y & ~1u;
+    regionOfInterest.width = region->width + region->x - regionOfInterest.x;
+    regionOfInterest.height = region->height + region->y - regionOfInterest.y;
+  }
+  this->decoder->regionOfInterest = regionOfInterest;
+
+  // Target is resolved on the primary item, a thumbnail decoded in its place ends at the same size
+  ScaledGeometry geometry = ResolveScaledGeometry(region ? region->width : this->primaryWidth,
+                                                  region ? region->height : this->primaryHeight,
+                                                  scaledWidth, scaledHeight, javaScaleMode);
+
+  // Downscaled still images come from the smallest embedded thumbnail that covers the target
+  uint32_t thumbnailMinWidth = 0, thumbnailMinHeight = 0;
+  if (!region && this->decoder->imageCount == 1
+      && this->decoder->progressiveState != AVIF_PROGRESSIVE_STATE_ACTIVE
+      && (geometry.resampledWidth < this->primaryWidth
+          || geometry.resampledHeight < this->primaryHeight)) {
+    thumbnailMinWidth = geometry.resampledWidth;
+    thumbnailMinHeight = geometry.resampledHeight;
+  }
+  this->selectThumbnail(thumbnailMinWidth, thumbnailMinHeight);
+
   avifResult nextImageResult = avifDecoderNthImage(this->decoder.get(), frame);
   if (nextImageResult != AVIF_RESULT_OK) {
     std::string str = "Can't time of frame number: " + std::to_string(frame);
     throw std::runtime_error(str);
   }
 
-  AvifUniqueImage avifUniqueImage(this->decoder.get());
+  const avifImage *sourceImage = decoder->image;
 
   auto
-      imageUsesAlpha = decoder->image->imageOwnsAlphaPlane || decoder->image->alphaPlane != nullptr;
+      imageUsesAlpha = sourceImage->imageOwnsAlphaPlane || sourceImage->alphaPlane != nullptr;
+
+  uint32_t bitDepth = sourceImage->depth;
+
+  bool isImageRequires64Bit = avifImageUsesU16(sourceImage);
+
+  // Region is converted through a view into decoded planes, rest of the frame is never touched.
+  // View may start a pixel earlier for subsampled chroma, then it is cut after conversion.
+  avif::ImagePtr regionImage;
+  uint32_t regionOffsetX = 0, regionOffsetY = 0;
+  uint32_t frameWidth = sourceImage->width;
+  uint32_t frameHeight = sourceImage->height;
+  if (region) {
+    regionImage = AvifRegionView(sourceImage, *region, &regionOffsetX, &regionOffsetY);
+    sourceImage = regionImage.get();
+    frameWidth = region->width;
+    frameHeight = region->height;
+  }
+  bool isExactView = regionOffsetX == 0 && regionOffsetY == 0
+      && sourceImage->width == frameWidth && sourceImage->height == frameHeight;
+
+  // Downscaling planes first leaves conversion and color management only for target pixels
+  avif::ImagePtr scaledImage;
+  if (isExactView
+      && geometry.resampledWidth <= sourceImage->width
+      && geometry.resampledHeight <= sourceImage->height
+      && (geometry.resampledWidth != sourceImage->width
+          || geometry.resampledHeight != sourceImage->height)
+      && CanScaleAvifYuv(sourceImage)) {
+    if (scalingQuality == ScalingQualityHigh) {
+      // libyuv has no Lanczos: planes are only box decimated, Lanczos finishes in RGB
+      uint32_t factor = PreDecimationFactor(sourceImage->width, sourceImage->height,
+                                            geometry.resampledWidth, geometry.resampledHeight,
+                                            scalingQuality);
+      if (factor > 1) {
+        scaledImage = ScaleAvifYuvImage(sourceImage,
+                                        (sourceImage->width + factor - 1) / factor,
+                                        (sourceImage->height + factor - 1) / factor,
+                                        scalingQuality);
+        sourceImage = scaledImage.get();
+      }
+    } else {
+      scaledImage = ScaleAvifYuvImage(sourceImage, geometry.resampledWidth,
+                                      geometry.resampledHeight, scalingQuality);
+      sourceImage = scaledImage.get();
+    }
+  } else if (isExactView && sourceImage->yuvFormat == AVIF_PIXEL_FORMAT_YUV420
+      && IsChromaNativeScale(sourceImage->width, sourceImage->height,
+                             geometry.resampledWidth, geometry.resampledHeight)) {
+    // Thumbnails of images with alpha: convert at chroma resolution, the rest is resampled in RGB
+    scaledImage = ChromaNativeAvifImage(sourceImage);
+    sourceImage = scaledImage.get();
+  }
 
-  auto colorPrimaries = decoder->image->colorPrimaries;
-  auto transferCharacteristics = decoder->image->transferCharacteristics;
+  bool keepsImageSize = isExactView && !geometry.isCropped
+      && geometry.resampledWidth == sourceImage->width
+      && geometry.resampledHeight == sourceImage->height;
 
-  uint32_t bitDepth = decoder->image->depth;
+  PreferredColorConfig fusedConfig = javaColorSpace;
+  if (fusedConfig == Default) {
+    fusedConfig = isImageRequires64Bit ? (androidOSVersion() >= 26 ? Rgba_F16 : Default)
+                                       : Rgba_8888;
+  }
+
+  // Frame keeps its size: pixels go from planes straight into the final format,
+  // into caller memory when target accepts them. Resampled or cropped frames still make
+  // full size RGBA below, the resampler works on whole images
+  bool isPackedConfig = fusedConfig == Rgba_8888 || fusedConfig == Rgba_F16
+      || fusedConfig == Rgb_565 || fusedConfig == Rgba_1010102;
+  if (allowFusedConversion && keepsImageSize && isPackedConfig) {
+    AvifImageFrame imageFrame = {
+        .width = sourceImage->width,
+        .height = sourceImage->height,
+        .is16Bit = fusedConfig == Rgba_F16,
+        .bitDepth = bitDepth,
+        .hasAlpha = imageUsesAlpha,
+        .storeConfig = fusedConfig
+    };
+    FrameTarget output = coder::AcquireFrameTarget(target, imageFrame);
+    if (HasFusedAvifYuvConversion(sourceImage, fusedConfig)) {
+      ConvertAvifYuvToColorConfig(sourceImage, fusedConfig, output.data, output.stride);
+    } else {
+      // Bands go through color management, no full size RGBA is made
+      ConvertAvifImageInStrips(sourceImage, fusedConfig, imageUsesAlpha, toneMapper,
+                               output.data, output.stride);
+    }
+    return imageFrame;
+  }
+
+  AvifUniqueImage avifUniqueImage(sourceImage);
 
-  bool isImageRequires64Bit = avifImageUsesU16(decoder->image);
   if (isImageRequires64Bit) {
     avifUniqueImage.rgbImage.alphaPremultiplied = false;
     avifUniqueImage.rgbImage.depth = bitDepth;
@@ -124,299 +277,31 @@ AvifImageFrame AvifDecoderController::getFrame(uint32_t frame,
     throw std::runtime_error(str);
   }
 
-  bool isImageConverted = false;
-
-  auto image = decoder->image;
-
-  auto type = decoder->image->yuvFormat;
-
-  YuvMatrix matrix = YuvMatrix::Bt709;
-  if (image->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_BT601) {
-    matrix = YuvMatrix::Bt601;
-  } else if (image->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_BT2020_NCL
-      || image->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_SMPTE2085) {
-    matrix = YuvMatrix::Bt2020;
-  } else if (image->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_IDENTITY) {
-    matrix = YuvMatrix::Identity;
-    if (type != AVIF_PIXEL_FORMAT_YUV444) {
-      std::string
-          str = "On identity matrix image layout must be 4:4:4 but it wasn't";
-      throw std::runtime_error(str);
-    }
-  }
-
-  YuvRange range = YuvRange::Tv;
-  if (image->yuvRange == AVIF_RANGE_FULL) {
-    range = YuvRange::Pc;
-  }
-
-  YuvType yuvType = YuvType::Yuv420;
-  if (type == AVIF_PIXEL_FORMAT_YUV422) {
-    yuvType = YuvType::Yuv422;
-  } else if (type == AVIF_PIXEL_FORMAT_YUV444) {
-    yuvType = YuvType::Yuv444;
-  }
-
-  if (type == AVIF_PIXEL_FORMAT_YUV444 || type == AVIF_PIXEL_FORMAT_YUV422
-      || type == AVIF_PIXEL_FORMAT_YUV420) {
-
-    if (isImageRequires64Bit) {
-      if (imageUsesAlpha) {
-        weave_yuv16_with_alpha_to_rgba16(
-            reinterpret_cast<const uint16_t *>(image->yuvPlanes[0]),
-            image->yuvRowBytes[0],
-            reinterpret_cast<const uint16_t *>(image->yuvPlanes[1]),
-            image->yuvRowBytes[1],
-            reinterpret_cast<const uint16_t *>(image->yuvPlanes[2]),
-            image->yuvRowBytes[2],
-            reinterpret_cast<const uint16_t *>(image->alphaPlane),
-            image->alphaRowBytes,
-            reinterpret_cast<uint16_t *>(avifUniqueImage.rgbImage.pixels),
-            avifUniqueImage.rgbImage.rowBytes,
-            bitDepth,
-            avifUniqueImage.rgbImage.width,
-            avifUniqueImage.rgbImage.height,
-            range,
-            matrix,
-            yuvType
-        );
-        isImageConverted = true;
-      } else {
-        weave_yuv16_to_rgba16(
-            reinterpret_cast<const uint16_t *>(image->yuvPlanes[0]),
-            image->yuvRowBytes[0],
-            reinterpret_cast<const uint16_t *>(image->yuvPlanes[1]),
-            image->yuvRowBytes[1],
-            reinterpret_cast<const uint16_t *>(image->yuvPlanes[2]),
-            image->yuvRowBytes[2],
-            reinterpret_cast<uint16_t *>(avifUniqueImage.rgbImage.pixels),
-            avifUniqueImage.rgbImage.rowBytes,
-            bitDepth,
-            avifUniqueImage.rgbImage.width,
-            avifUniqueImage.rgbImage.height,
-            range,
-            matrix,
-            yuvType
-        );
-        isImageConverted = true;
-      }
-    } else {
-      if (imageUsesAlpha) {
-        weave_yuv8_with_alpha_to_rgba8(
-            image->yuvPlanes[0], image->yuvRowBytes[0],
-            image->yuvPlanes[1], image->yuvRowBytes[1],
-            image->yuvPlanes[2], image->yuvRowBytes[2],
-            image->alphaPlane, image->alphaRowBytes,
-            avifUniqueImage.rgbImage.pixels, avifUniqueImage.rgbImage.rowBytes,
-            avifUniqueImage.rgbImage.width, avifUniqueImage.rgbImage.height,
-            range, matrix, yuvType
-        );
-        isImageConverted = true;
-      } else {
-        weave_yuv8_to_rgba8(
-            image->yuvPlanes[0], image->yuvRowBytes[0],
-            image->yuvPlanes[1], image->yuvRowBytes[1],
-            image->yuvPlanes[2], image->yuvRowBytes[2],
-            avifUniqueImage.rgbImage.pixels, avifUniqueImage.rgbImage.rowBytes,
-            avifUniqueImage.rgbImage.width, avifUniqueImage.rgbImage.height,
-            range, matrix, yuvType
-        );
-        isImageConverted = true;
-      }
-    }
-  } else if (type == AVIF_PIXEL_FORMAT_YUV400) {
-    if (isImageRequires64Bit) {
-      if (imageUsesAlpha) {
-        weave_yuv400_p16_with_alpha_to_rgba16(
-            reinterpret_cast<const uint16_t *>(image->yuvPlanes[0]),
-            image->yuvRowBytes[0],
-            reinterpret_cast<const uint16_t *>(image->alphaPlane),
-            image->alphaRowBytes,
-            reinterpret_cast<uint16_t *>(avifUniqueImage.rgbImage.pixels),
-            avifUniqueImage.rgbImage.rowBytes,
-            bitDepth,
-            avifUniqueImage.rgbImage.width,
-            avifUniqueImage.rgbImage.height,
-            range,
-            matrix
-        );
-      } else {
-        weave_yuv400_p16_to_rgba16(
-            reinterpret_cast<const uint16_t *>(image->yuvPlanes[0]),
-            image->yuvRowBytes[0],
-            reinterpret_cast<uint16_t *>(avifUniqueImage.rgbImage.pixels),
-            avifUniqueImage.rgbImage.rowBytes,
-            bitDepth,
-            avifUniqueImage.rgbImage.width,
-            avifUniqueImage.rgbImage.height,
-            range,
-            matrix
-        );
-      }
-      isImageConverted = true;
-    } else {
-      if (imageUsesAlpha) {
-        weave_yuv400_with_alpha_to_rgba8(
-            reinterpret_cast<const uint8_t *>(image->yuvPlanes[0]),
-            image->yuvRowBytes[0],
-            image->alphaPlane, image->alphaRowBytes,
-            reinterpret_cast<uint8_t *>(avifUniqueImage.rgbImage.pixels),
-            avifUniqueImage.rgbImage.rowBytes,
-            avifUniqueImage.rgbImage.width,
-            avifUniqueImage.rgbImage.height,
-            range,
-            matrix
-        );
-      } else {
-        weave_yuv400_to_rgba8(
-            reinterpret_cast<const uint8_t *>(image->yuvPlanes[0]),
-            image->yuvRowBytes[0],
-            reinterpret_cast<uint8_t *>(avifUniqueImage.rgbImage.pixels),
-            avifUniqueImage.rgbImage.rowBytes,
-            avifUniqueImage.rgbImage.width,
-            avifUniqueImage.rgbImage.height,
-            range,
-            matrix
-        );
-      }
-      isImageConverted = true;
-    }
-  }
-
-  if (!isImageConverted) {
-    std::string
-        str = "Unfortunately image type is not supported" + std::to_string(frame);
-    throw std::runtime_error(str);
-  }
-
-  float intensityTarget =
-      decoder->image->clli.maxCLL == 0 ? 1000.0f : static_cast<float>(decoder->image->clli.maxCLL);
-
-  aligned_uint8_vector iccProfile(0);
-  if (decoder->image->icc.data && decoder->image->icc.size) {
-    iccProfile.resize(decoder->image->icc.size);
-    std::copy(decoder->image->icc.data,
-              decoder->image->icc.data + decoder->image->icc.size,
-              iccProfile.begin());
-  }
+  ConvertAvifYuvRows(sourceImage,
+                     avifUniqueImage.rgbImage.pixels,
+                     avifUniqueImage.rgbImage.rowBytes,
+                     0,
+                     avifUniqueImage.rgbImage.height);
 
-  uint32_t imageWidth = decoder->image->width;
-  uint32_t imageHeight = decoder->image->height;
+  uint32_t imageWidth = sourceImage->width - regionOffsetX;
+  uint32_t imageHeight = sourceImage->height - regionOffsetY;
 
   uint32_t stride = avifUniqueImage.rgbImage.rowBytes;
+  uint32_t pixelSize = 4 * (isImageRequires64Bit ? sizeof(uint16_t) : sizeof(uint8_t));
+  const uint8_t *regionPixels = avifUniqueImage.rgbImage.pixels
+      + regionOffsetY * stride + regionOffsetX * pixelSize;
 
   aligned_uint8_vector imageStore;
 
-  imageStore = RescaleSourceImage(avifUniqueImage.rgbImage.pixels, &stride,
-                                  bitDepth, isImageRequires64Bit, &imageWidth,
-                                  &imageHeight, scaledWidth, scaledHeight, javaScaleMode,
-                                  scalingQuality, imageUsesAlpha);
+  imageStore = ApplyScaledGeometry(regionPixels, &stride,
+                                   bitDepth, isImageRequires64Bit, &imageWidth,
+                                   &imageHeight, geometry,
+                                   scalingQuality, imageUsesAlpha);
 
   avifUniqueImage.clear();
 
-  if (!iccProfile.empty()) {
-    convertUseICC(imageStore, stride, imageWidth, imageHeight, iccProfile.data(),
-                  iccProfile.size(),
-                  isImageRequires64Bit, bitDepth);
-  } else if (transferCharacteristics != AVIF_TRANSFER_CHARACTERISTICS_UNSPECIFIED
-      || colorPrimaries != AVIF_COLOR_PRIMARIES_UNSPECIFIED) {
-    Eigen::Matrix<float, 3, 2> primaries;
-    float imagePrimaries[8] = {0.64f, 0.33f, 0.3f, 0.6f, 0.15f, 0.06f, 0.3127f, 0.329f};
-    avifColorPrimariesGetValues(colorPrimaries, imagePrimaries);
-
-    primaries << static_cast<float>(imagePrimaries[0]),
-        static_cast<float>(imagePrimaries[1]),
-        static_cast<float>(imagePrimaries[2]),
-        static_cast<float>(imagePrimaries[3]),
-        static_cast<float>(imagePrimaries[4]),
-        static_cast<float>(imagePrimaries[5]);
-
-    Eigen::Vector2f whitePoint;
-    whitePoint << static_cast<float>(imagePrimaries[6]),
-        static_cast<float>(imagePrimaries[7]);
-
-    Eigen::Matrix3f destinationProfile = GamutRgbToXYZ(getSRGBPrimaries(), getIlluminantD65());
-    Eigen::Matrix3f sourceProfile = GamutRgbToXYZ(primaries, whitePoint);
-
-    Eigen::Matrix3f conversion = destinationProfile.inverse() * sourceProfile;
-
-    ToneMapping toneMapping = ToneMapping::Rec2408;
-
-    if (transferCharacteristics !=
-        AVIF_TRANSFER_CHARACTERISTICS_HLG &&
-        transferCharacteristics != AVIF_TRANSFER_CHARACTERISTICS_PQ) {
-      toneMapping = ToneMapping::Skip;
-    }
-
-    FfiTrc transferFfi = FfiTrc::Srgb;
-
-    if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_HLG) {
-      transferFfi = FfiTrc::Hlg;
-    } else if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_SMPTE428) {
-      transferFfi = FfiTrc::Smpte428;
-    } else if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_PQ) {
-      transferFfi = FfiTrc::Smpte2084;
-    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_LINEAR) {
-      transferFfi = FfiTrc::Linear;
-    } else if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_BT470M) {
-      transferFfi = FfiTrc::Bt470M;
-    } else if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_BT470BG) {
-      transferFfi = FfiTrc::Bt470Bg;
-    } else if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_BT601) {
-      transferFfi = FfiTrc::Bt709;
-    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_BT709) {
-      transferFfi = FfiTrc::Bt709;
-    } else if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_BT2020_10BIT ||
-        transferCharacteristics ==
-            AVIF_TRANSFER_CHARACTERISTICS_BT2020_12BIT) {
-      transferFfi = FfiTrc::Bt709;
-    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_SMPTE240) {
-      transferFfi = FfiTrc::Smpte240;
-    } else if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_LOG100) {
-      transferFfi = FfiTrc::Log100;
-    } else if (transferCharacteristics ==
-        AVIF_TRANSFER_CHARACTERISTICS_LOG100_SQRT10) {
-      transferFfi = FfiTrc::Log100sqrt10;
-    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_SRGB) {
-      transferFfi = FfiTrc::Srgb;
-    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_IEC61966) {
-      transferFfi = FfiTrc::Iec61966;
-    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_BT1361) {
-      transferFfi = FfiTrc::Bt1361;
-    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_UNSPECIFIED) {
-      transferFfi = FfiTrc::Srgb;
-    }
-
-    const float cPrimaries[6] = {
-        imagePrimaries[0], imagePrimaries[1],
-        imagePrimaries[2], imagePrimaries[3],
-        imagePrimaries[4], imagePrimaries[5]
-    };
-    const float wp[2] = {
-        whitePoint(0), whitePoint(1)
-    };
-
-    if (isImageRequires64Bit) {
-      apply_tone_mapping_rgba16(
-          reinterpret_cast<uint16_t *>(imageStore.data()), stride, bitDepth,
-          imageWidth, imageHeight, cPrimaries, wp, transferFfi, toneMapping, intensityTarget
-      );
-    } else {
-      apply_tone_mapping_rgba8(
-          reinterpret_cast<uint8_t *>(imageStore.data()), stride,
-          imageWidth, imageHeight, cPrimaries, wp, transferFfi, toneMapping, intensityTarget
-      );
-    }
-
-  }
+  ApplyAvifColorManagement(sourceImage, imageStore, stride, imageWidth, imageHeight,
+                           toneMapper);
 
   AvifImageFrame imageFrame = {
       .store = imageStore,
@@ -429,6 +314,57 @@ AvifImageFrame AvifDecoderController::getFrame(uint32_t frame,
   return imageFrame;
 }
 
+void AvifDecoderController::readYuvPlanes(uint32_t frame,
+                                          const std::function<void(const YuvPlanesView &)> &consumer) {
+  std::lock_guard guard(this->mutex);
+  if (!this->isBufferAttached) {
+    throw std::runtime_error("AVIF controller methods can't be called without attached buffer");
+  }
+
+  if (frame >= this->decoder->imageCount) {
+    std::string str = "Can't time of frame number: " + std::to_string(frame);
+    throw std::runtime_error(str);
+  }
+
+  // Planes are lent whole, every grid cell of the primary item is needed
+  this->decoder->regionOfInterest = {0, 0, 0, 0};
+  this->selectThumbnail(0, 0);
+  avifResult nextImageResult = avifDecoderNthImage(this->decoder.get(), frame);
+  if (nextImageResult != AVIF_RESULT_OK) {
+    std::string str = "Can't time of frame number: " + std::to_string(frame);
+    throw std::runtime_error(str);
+  }
+
+  auto image = this->decoder->image;
+
+  YuvSubsampling subsampling;
+  switch (image->yuvFormat) {
+    case AVIF_PIXEL_FORMAT_YUV420: subsampling = YUV_SUBSAMPLING_420;
+      break;
+    case AVIF_PIXEL_FORMAT_YUV422: subsampling = YUV_SUBSAMPLING_422;
+      break;
+    case AVIF_PIXEL_FORMAT_YUV444: subsampling = YUV_SUBSAMPLING_444;
+      break;
+    case AVIF_PIXEL_FORMAT_YUV400: subsampling = YUV_SUBSAMPLING_400;
+      break;
+    default: throw std::runtime_error("Unfortunately image type is not supported");
+  }
+
+  YuvPlanesView view = {
+      .planes = {image->yuvPlanes[0], image->yuvPlanes[1], image->yuvPlanes[2]},
+      .rowBytes = {image->yuvRowBytes[0], image->yuvRowBytes[1], image->yuvRowBytes[2]},
+      .width = image->width,
+      .height = image->height,
+      .bitDepth = image->depth,
+      .subsampling = subsampling,
+      .colorPrimaries = image->colorPrimaries,
+      .transferCharacteristics = image->transferCharacteristics,
+      .matrixCoefficients = image->matrixCoefficients,
+      .fullRange = image->yuvRange == AVIF_RANGE_FULL
+  };
+  consumer(view);
+}
+
 void AvifDecoderController::attachBuffer(uint8_t *data, uint32_t bufferSize) {
   std::lock_guard guard(this->mutex);
   if (this->isBufferAttached) {
@@ -436,24 +372,137 @@ void AvifDecoderController::attachBuffer(uint8_t *data, uint32_t bufferSize) {
   }
   this->buffer.resize(bufferSize);
   std::copy(data, data + bufferSize, this->buffer.begin());
+  this->parseSource(this->buffer.data(), this->buffer.size());
+}
+
+void AvifDecoderController::borrowBuffer(const uint8_t *data, uint32_t bufferSize) {
+  std::lock_guard guard(this->mutex);
+  if (this->isBufferAttached) {
+    throw std::runtime_error("AVIF controller can accept buffer only once");
+  }
+  this->parseSource(data, bufferSize);
+}
+
+/**
+ * Same contract as libavif memory reader, but over a mapped file: returned pointers stay valid
+ * while mapping is alive, so reader is persistent and nothing is copied
+ */
+struct MappedFileIO {
+  avifIO io; // must be the first member for casting to avifIO*
+  std::shared_ptr<MappedFile> file;
+};
+
+static avifResult MappedFileIORead(struct avifIO *io,
+                                   uint32_t readFlags,
+                                   uint64_t offset,
+                                   size_t size,
+                                   avifROData *out) {
+  if (readFlags != 0) {
+    return AVIF_RESULT_IO_ERROR;
+  }
+  auto reader = reinterpret_cast<MappedFileIO *>(io);
+  uint64_t fileSize = reader->file->size();
+  if (offset > fileSize) {
+    return AVIF_RESULT_IO_ERROR;
+  }
+  uint64_t availableSize = fileSize - offset;
+  if (size > availableSize) {
+    size = static_cast<size_t>(availableSize);
+  }
+  // Payload reads are followed by a decode of the whole range, let kernel read it ahead at once
+  if (size >= 64 * 1024) {
+    reader->file->willNeed(static_cast<size_t>(offset), size);
+  }
+  out->data = reader->file->data() + offset;
+  out->size = size;
+  return AVIF_RESULT_OK;
+}
+
+static void MappedFileIODestroy(struct avifIO *io) {
+  delete reinterpret_cast<MappedFileIO *>(io);
+}
+
+void AvifDecoderController::attachFile(std::shared_ptr<MappedFile> file) {
+  std::lock_guard guard(this->mutex);
+  if (this->isBufferAttached) {
+    throw std::runtime_error("AVIF controller can accept buffer only once");
+  }
+  this->mappedFile = std::move(file);
+
+  auto reader = new MappedFileIO();
+  reader->io.destroy = MappedFileIODestroy;
+  reader->io.read = MappedFileIORead;
+  reader->io.write = nullptr;
+  reader->io.sizeHint = this->mappedFile->size();
+  reader->io.persistent = AVIF_TRUE;
+  reader->io.data = nullptr;
+  reader->file = this->mappedFile;
+  // Decoder owns the reader from now on and destroys it together with itself
+  avifDecoderSetIO(this->decoder.get(), &reader->io);
+  this->parseAttachedIO();
+}
+
+void AvifDecoderController::parseSource(const uint8_t *data, uint32_t bufferSize) {
   auto result =
-      avifDecoderSetIOMemory(this->decoder.get(), this->buffer.data(), this->buffer.size());
+      avifDecoderSetIOMemory(this->decoder.get(), data, bufferSize);
   if (result != AVIF_RESULT_OK) {
     throw std::runtime_error("Can't successfully attach memory");
   }
+  this->parseAttachedIO();
+}
+
+void AvifDecoderController::parseAttachedIO() {
   this->decoder->ignoreExif = false;
   this->decoder->ignoreXMP = false;
   this->decoder->strictFlags = AVIF_STRICT_DISABLED;
+  this->decoder->allowProgressive = this->allowProgressive ? AVIF_TRUE : AVIF_FALSE;
 
   uint32_t hwThreads = std::thread::hardware_concurrency();
   this->decoder->maxThreads = static_cast<int>(hwThreads);
-  result = avifDecoderParse(decoder.get());
+  auto result = avifDecoderParse(decoder.get());
   if (result != AVIF_RESULT_OK) {
     throw std::runtime_error("This is doesn't looks like AVIF image");
   }
+  this->primaryWidth = this->decoder->image->width;
+  this->primaryHeight = this->decoder->image->height;
   this->isBufferAttached = true;
 }
 
+void AvifDecoderController::selectThumbnail(uint32_t minWidth, uint32_t minHeight) {
+  if (this->decoder->thumbnailMinWidth == minWidth
+      && this->decoder->thumbnailMinHeight == minHeight) {
+    return;
+  }
+  this->decoder->thumbnailMinWidth = minWidth;
+  this->decoder->thumbnailMinHeight = minHeight;
+  // Items are picked when decoder is reset, parsed boxes are kept
+  auto result = avifDecoderReset(this->decoder.get());
+  if (result != AVIF_RESULT_OK) {
+    throw std::runtime_error("Can't reset AVIF decoder");
+  }
+}
+
+void AvifDecoderController::setAllowProgressive(bool allow) {
+  std::lock_guard guard(this->mutex);
+  if (this->isBufferAttached) {
+    throw std::runtime_error("Progressive mode must be set before buffer is attached");
+  }
+  this->allowProgressive = allow;
+}
+
+void AvifDecoderController::setAllowFusedConversion(bool allow) {
+  std::lock_guard guard(this->mutex);
+  this->allowFusedConversion = allow;
+}
+
+bool AvifDecoderController::isProgressive() {
+  std::lock_guard guard(this->mutex);
+  if (!this->isBufferAttached) {
+    throw std::runtime_error("AVIF controller methods can't be called without attached buffer");
+  }
+  return this->decoder->progressiveState == AVIF_PROGRESSIVE_STATE_ACTIVE;
+}
+
 uint32_t AvifDecoderController::getFramesCount() {
   std::lock_guard guard(this->mutex);
   if (!this->isBufferAttached) {
@@ -507,9 +556,10 @@ AvifImageSize AvifDecoderController::getImageSize() {
   if (!this->decoder->image) {
     throw std::runtime_error("Parsed image is expected but there are nothing");
   }
+  // Decoder may hold a thumbnail after getFrame, size is always the primary one
   AvifImageSize imageSize = {
-      .width = this->decoder->image->width,
-      .height = this->decoder->image->height,
+      .width = this->primaryWidth,
+      .height = this->primaryHeight,
   };
   return imageSize;
 }
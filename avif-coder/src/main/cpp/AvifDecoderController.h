@@ -36,6 +36,10 @@
 #include "Support.h"
 #include <thread>
 #include "ImageFrame.h"
+#include "MappedFile.h"
+#include "YuvPlanes.h"
+#include <functional>
+#include <memory>
 
 class AvifDecoderController {
  public:
@@ -53,13 +57,45 @@ class AvifDecoderController {
     this->attachBuffer(data, bufferSize);
   }
 
+  /**
+   * Decodes frame, when region is set only that rectangle is converted and then scaled.
+   * Still images scaled down are decoded from the smallest embedded thumbnail that covers the target.
+   * PQ and HLG frames are tone mapped with the given curve.
+   * Frames already in final bitmap format are written into memory from target when it is set.
+   */
   AvifImageFrame getFrame(uint32_t frame,
                           uint32_t scaledWidth,
                           uint32_t scaledHeight,
                           PreferredColorConfig javaColorSpace,
                           ScaleMode javaScaleMode,
-                          int scalingQuality);
+                          int scalingQuality,
+                          const ImageRegion *region = nullptr,
+                          CurveToneMapper toneMapper = REC2408,
+                          const FrameTargetProvider &target = {});
   void attachBuffer(uint8_t *data, uint32_t bufferSize);
+  /**
+   * Parses the source in place without copying it, caller must keep the memory alive
+   * while controller is in use
+   */
+  void borrowBuffer(const uint8_t *data, uint32_t bufferSize);
+  /**
+   * Reads mapped file through a custom avifIO, only touched pages become resident
+   */
+  void attachFile(std::shared_ptr<MappedFile> file);
+  /**
+   * Exposes layers of progressive AVIF as frames, lowest quality first.
+   * Must be set before the source is attached.
+   */
+  void setAllowProgressive(bool allow);
+  /**
+   * When disabled, frames always come as unpremultiplied RGBA, never in final bitmap format
+   */
+  void setAllowFusedConversion(bool allow);
+  bool isProgressive();
+  /**
+   * Decodes frame and lends its planes to consumer without converting them to RGB
+   */
+  void readYuvPlanes(uint32_t frame, const std::function<void(const YuvPlanesView &)> &consumer);
   uint32_t getFramesCount();
   uint32_t getLoopsCount();
   uint32_t getTotalDuration();
@@ -69,8 +105,20 @@ class AvifDecoderController {
   static AvifImageSize getImageSize(uint8_t *data, uint32_t bufferSize);
 
  private:
+  void parseSource(const uint8_t *data, uint32_t bufferSize);
+  void parseAttachedIO();
+  /**
+   * Makes decoder read the smallest thumbnail at least that large, zeros pick the primary item
+   */
+  void selectThumbnail(uint32_t minWidth, uint32_t minHeight);
+
   bool isBufferAttached;
+  bool allowProgressive = false;
+  bool allowFusedConversion = true;
+  uint32_t primaryWidth = 0;
+  uint32_t primaryHeight = 0;
   aligned_uint8_vector buffer;
+  std::shared_ptr<MappedFile> mappedFile;
   avif::DecoderPtr decoder;
   std::mutex mutex;
 };
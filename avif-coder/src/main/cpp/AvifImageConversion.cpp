@@ -0,0 +1,716 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "AvifImageConversion.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "colorspace.h"
+#include "Eigen/Eigen"
+#include "ColorSpaceProfile.h"
+#include "avifweaver.h"
+#include <libyuv.h>
+#include "YuvPlanes.h"
+#include "ColorMatrix.h"
+
+static YuvMatrix AvifYuvMatrix(const avifImage *image) {
+  if (image->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_BT601) {
+    return YuvMatrix::Bt601;
+  } else if (image->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_BT2020_NCL
+      || image->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_SMPTE2085) {
+    return YuvMatrix::Bt2020;
+  } else if (image->matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_IDENTITY) {
+    return YuvMatrix::Identity;
+  }
+  return YuvMatrix::Bt709;
+}
+
+static YuvRange AvifYuvRange(const avifImage *image) {
+  return image->yuvRange == AVIF_RANGE_FULL ? YuvRange::Pc : YuvRange::Tv;
+}
+
+static YuvType AvifYuvType(const avifImage *image) {
+  if (image->yuvFormat == AVIF_PIXEL_FORMAT_YUV422) {
+    return YuvType::Yuv422;
+  } else if (image->yuvFormat == AVIF_PIXEL_FORMAT_YUV444) {
+    return YuvType::Yuv444;
+  }
+  return YuvType::Yuv420;
+}
+
+void ConvertAvifYuvRows(const avifImage *image,
+                        uint8_t *dst,
+                        uint32_t dstStride,
+                        uint32_t startRow,
+                        uint32_t rowsCount) {
+  if (startRow >= image->height) {
+    return;
+  }
+  ConvertAvifYuvRowsInto(image, dst + startRow * dstStride, dstStride, startRow, rowsCount);
+}
+
+void ConvertAvifYuvRowsInto(const avifImage *image,
+                            uint8_t *dstRows,
+                            uint32_t dstStride,
+                            uint32_t startRow,
+                            uint32_t rowsCount) {
+  bool isImageConverted = false;
+
+  auto type = image->yuvFormat;
+
+  YuvMatrix matrix = AvifYuvMatrix(image);
+  if (matrix == YuvMatrix::Identity && type != AVIF_PIXEL_FORMAT_YUV444) {
+    std::string
+        str = "On identity matrix image layout must be 4:4:4 but it wasn't";
+    throw std::runtime_error(str);
+  }
+
+  YuvRange range = AvifYuvRange(image);
+  YuvType yuvType = AvifYuvType(image);
+
+  if (startRow >= image->height) {
+    return;
+  }
+  rowsCount = std::min(rowsCount, image->height - startRow);
+  if (type == AVIF_PIXEL_FORMAT_YUV420 && (startRow & 1) != 0) {
+    throw std::runtime_error("Row conversion of 4:2:0 image must start on even row");
+  }
+
+  bool isImage16Bit = avifImageUsesU16(image);
+  uint32_t bitDepth = image->depth;
+  uint32_t chromaRow = type == AVIF_PIXEL_FORMAT_YUV420 ? (startRow >> 1) : startRow;
+
+  const uint8_t *yPlane = image->yuvPlanes[0] + startRow * image->yuvRowBytes[0];
+  const uint8_t *uPlane = image->yuvPlanes[1]
+                          ? image->yuvPlanes[1] + chromaRow * image->yuvRowBytes[1] : nullptr;
+  const uint8_t *vPlane = image->yuvPlanes[2]
+                          ? image->yuvPlanes[2] + chromaRow * image->yuvRowBytes[2] : nullptr;
+  const uint8_t *alphaPlane = image->alphaPlane
+                              ? image->alphaPlane + startRow * image->alphaRowBytes : nullptr;
+  bool imageUsesAlpha = alphaPlane != nullptr;
+
+  if (type == AVIF_PIXEL_FORMAT_YUV444 || type == AVIF_PIXEL_FORMAT_YUV422
+      || type == AVIF_PIXEL_FORMAT_YUV420) {
+
+    if (isImage16Bit) {
+      if (imageUsesAlpha) {
+        weave_yuv16_with_alpha_to_rgba16(
+            reinterpret_cast<const uint16_t *>(yPlane),
+            image->yuvRowBytes[0],
+            reinterpret_cast<const uint16_t *>(uPlane),
+            image->yuvRowBytes[1],
+            reinterpret_cast<const uint16_t *>(vPlane),
+            image->yuvRowBytes[2],
+            reinterpret_cast<const uint16_t *>(alphaPlane),
+            image->alphaRowBytes,
+            reinterpret_cast<uint16_t *>(dstRows),
+            dstStride,
+            bitDepth,
+            image->width,
+            rowsCount,
+            range,
+            matrix,
+            yuvType
+        );
+        isImageConverted = true;
+      } else {
+        weave_yuv16_to_rgba16(
+            reinterpret_cast<const uint16_t *>(yPlane),
+            image->yuvRowBytes[0],
+            reinterpret_cast<const uint16_t *>(uPlane),
+            image->yuvRowBytes[1],
+            reinterpret_cast<const uint16_t *>(vPlane),
+            image->yuvRowBytes[2],
+            reinterpret_cast<uint16_t *>(dstRows),
+            dstStride,
+            bitDepth,
+            image->width,
+            rowsCount,
+            range,
+            matrix,
+            yuvType
+        );
+        isImageConverted = true;
+      }
+    } else {
+      if (imageUsesAlpha) {
+        weave_yuv8_with_alpha_to_rgba8(
+            yPlane, image->yuvRowBytes[0],
+            uPlane, image->yuvRowBytes[1],
+            vPlane, image->yuvRowBytes[2],
+            alphaPlane, image->alphaRowBytes,
+            dstRows, dstStride,
+            image->width, rowsCount,
+            range, matrix, yuvType
+        );
+        isImageConverted = true;
+      } else {
+        weave_yuv8_to_rgba8(
+            yPlane, image->yuvRowBytes[0],
+            uPlane, image->yuvRowBytes[1],
+            vPlane, image->yuvRowBytes[2],
+            dstRows, dstStride,
+            image->width, rowsCount,
+            range, matrix, yuvType
+        );
+        isImageConverted = true;
+      }
+    }
+  } else if (type == AVIF_PIXEL_FORMAT_YUV400) {
+    if (isImage16Bit) {
+      if (imageUsesAlpha) {
+        weave_yuv400_p16_with_alpha_to_rgba16(
+            reinterpret_cast<const uint16_t *>(yPlane),
+            image->yuvRowBytes[0],
+            reinterpret_cast<const uint16_t *>(alphaPlane),
+            image->alphaRowBytes,
+            reinterpret_cast<uint16_t *>(dstRows),
+            dstStride,
+            bitDepth,
+            image->width,
+            rowsCount,
+            range,
+            matrix
+        );
+      } else {
+        weave_yuv400_p16_to_rgba16(
+            reinterpret_cast<const uint16_t *>(yPlane),
+            image->yuvRowBytes[0],
+            reinterpret_cast<uint16_t *>(dstRows),
+            dstStride,
+            bitDepth,
+            image->width,
+            rowsCount,
+            range,
+            matrix
+        );
+      }
+      isImageConverted = true;
+    } else {
+      if (imageUsesAlpha) {
+        weave_yuv400_with_alpha_to_rgba8(
+            reinterpret_cast<const uint8_t *>(yPlane),
+            image->yuvRowBytes[0],
+            alphaPlane, image->alphaRowBytes,
+            reinterpret_cast<uint8_t *>(dstRows),
+            dstStride,
+            image->width,
+            rowsCount,
+            range,
+            matrix
+        );
+      } else {
+        weave_yuv400_to_rgba8(
+            reinterpret_cast<const uint8_t *>(yPlane),
+            image->yuvRowBytes[0],
+            reinterpret_cast<uint8_t *>(dstRows),
+            dstStride,
+            image->width,
+            rowsCount,
+            range,
+            matrix
+        );
+      }
+      isImageConverted = true;
+    }
+  }
+
+  if (!isImageConverted) {
+    std::string
+        str = "Unfortunately image type is not supported";
+    throw std::runtime_error(str);
+  }
+}
+
+void ApplyAvifColorManagement(const avifImage *image,
+                              aligned_uint8_vector &imageStore,
+                              uint32_t stride,
+                              uint32_t imageWidth,
+                              uint32_t imageHeight,
+                              CurveToneMapper toneMapper) {
+  if (IsAvifColorManagementNoop(image)) {
+    return;
+  }
+  bool isImageRequires64Bit = avifImageUsesU16(image);
+  uint32_t bitDepth = image->depth;
+  auto colorPrimaries = image->colorPrimaries;
+  auto transferCharacteristics = image->transferCharacteristics;
+
+  float intensityTarget =
+      image->clli.maxCLL == 0 ? 1000.0f : static_cast<float>(image->clli.maxCLL);
+
+  if (image->icc.data && image->icc.size) {
+    convertUseICC(imageStore, stride, imageWidth, imageHeight, image->icc.data,
+                  image->icc.size,
+                  isImageRequires64Bit, bitDepth);
+  } else if (transferCharacteristics != AVIF_TRANSFER_CHARACTERISTICS_UNSPECIFIED
+      || colorPrimaries != AVIF_COLOR_PRIMARIES_UNSPECIFIED) {
+    Eigen::Matrix<float, 3, 2> primaries;
+    float imagePrimaries[8] = {0.64f, 0.33f, 0.3f, 0.6f, 0.15f, 0.06f, 0.3127f, 0.329f};
+    avifColorPrimariesGetValues(colorPrimaries, imagePrimaries);
+
+    primaries << static_cast<float>(imagePrimaries[0]),
+        static_cast<float>(imagePrimaries[1]),
+        static_cast<float>(imagePrimaries[2]),
+        static_cast<float>(imagePrimaries[3]),
+        static_cast<float>(imagePrimaries[4]),
+        static_cast<float>(imagePrimaries[5]);
+
+    Eigen::Vector2f whitePoint;
+    whitePoint << static_cast<float>(imagePrimaries[6]),
+        static_cast<float>(imagePrimaries[7]);
+
+    Eigen::Matrix3f destinationProfile = GamutRgbToXYZ(getSRGBPrimaries(), getIlluminantD65());
+    Eigen::Matrix3f sourceProfile = GamutRgbToXYZ(primaries, whitePoint);
+
+    Eigen::Matrix3f conversion = destinationProfile.inverse() * sourceProfile;
+
+    ToneMapping toneMapping = ToneMapping::Rec2408;
+
+    if (transferCharacteristics !=
+        AVIF_TRANSFER_CHARACTERISTICS_HLG &&
+        transferCharacteristics != AVIF_TRANSFER_CHARACTERISTICS_PQ) {
+      toneMapping = ToneMapping::Skip;
+    }
+
+    FfiTrc transferFfi = FfiTrc::Srgb;
+
+    if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_HLG) {
+      transferFfi = FfiTrc::Hlg;
+    } else if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_SMPTE428) {
+      transferFfi = FfiTrc::Smpte428;
+    } else if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_PQ) {
+      transferFfi = FfiTrc::Smpte2084;
+    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_LINEAR) {
+      transferFfi = FfiTrc::Linear;
+    } else if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_BT470M) {
+      transferFfi = FfiTrc::Bt470M;
+    } else if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_BT470BG) {
+      transferFfi = FfiTrc::Bt470Bg;
+    } else if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_BT601) {
+      transferFfi = FfiTrc::Bt709;
+    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_BT709) {
+      transferFfi = FfiTrc::Bt709;
+    } else if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_BT2020_10BIT ||
+        transferCharacteristics ==
+            AVIF_TRANSFER_CHARACTERISTICS_BT2020_12BIT) {
+      transferFfi = FfiTrc::Bt709;
+    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_SMPTE240) {
+      transferFfi = FfiTrc::Smpte240;
+    } else if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_LOG100) {
+      transferFfi = FfiTrc::Log100;
+    } else if (transferCharacteristics ==
+        AVIF_TRANSFER_CHARACTERISTICS_LOG100_SQRT10) {
+      transferFfi = FfiTrc::Log100sqrt10;
+    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_SRGB) {
+      transferFfi = FfiTrc::Srgb;
+    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_IEC61966) {
+      transferFfi = FfiTrc::Iec61966;
+    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_BT1361) {
+      transferFfi = FfiTrc::Bt1361;
+    } else if (transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_UNSPECIFIED) {
+      transferFfi = FfiTrc::Srgb;
+    }
+
+    const float cPrimaries[6] = {
+        imagePrimaries[0], imagePrimaries[1],
+        imagePrimaries[2], imagePrimaries[3],
+        imagePrimaries[4], imagePrimaries[5]
+    };
+    const float wp[2] = {
+        whitePoint(0), whitePoint(1)
+    };
+
+    if (toneMapping == ToneMapping::Rec2408 && toneMapper != REC2408) {
+      toneMapWithCurve(imageStore.data(), stride, imageWidth, imageHeight,
+                       isImageRequires64Bit, bitDepth, cPrimaries, wp,
+                       transferFfi == FfiTrc::Hlg ? TransferFunction::Hlg : TransferFunction::Pq,
+                       toneMapper, intensityTarget);
+    } else if (isImageRequires64Bit) {
+      apply_tone_mapping_rgba16(
+          reinterpret_cast<uint16_t *>(imageStore.data()), stride, bitDepth,
+          imageWidth, imageHeight, cPrimaries, wp, transferFfi, toneMapping, intensityTarget, 0
+      );
+    } else {
+      apply_tone_mapping_rgba8(
+          reinterpret_cast<uint8_t *>(imageStore.data()), stride,
+          imageWidth, imageHeight, cPrimaries, wp, transferFfi, toneMapping, intensityTarget, 0
+      );
+    }
+
+  }
+}
+
+bool IsAvifColorManagementNoop(const avifImage *image) {
+  if (image->icc.data && image->icc.size) {
+    // Byte-different but colorimetrically sRGB profiles need no transform either
+    return icc_profile_is_srgb(image->icc.data, static_cast<uint32_t>(image->icc.size));
+  }
+  bool isSrgbPrimaries = image->colorPrimaries == AVIF_COLOR_PRIMARIES_UNSPECIFIED
+      || image->colorPrimaries == AVIF_COLOR_PRIMARIES_BT709;
+  bool isSrgbTransfer = image->transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_UNSPECIFIED
+      || image->transferCharacteristics == AVIF_TRANSFER_CHARACTERISTICS_SRGB;
+  return isSrgbPrimaries && isSrgbTransfer;
+}
+
+/**
+ * libyuv writes its ARGB as B, G, R, A in memory, so Android RGBA order is produced
+ * by ARGB kernels with swapped chroma planes and mirrored constants, as libavif does
+ */
+static const libyuv::YuvConstants *LibyuvConstants(YuvMatrix matrix, YuvRange range,
+                                                   bool swapChroma) {
+  bool isFullRange = range == YuvRange::Pc;
+  switch (matrix) {
+    case YuvMatrix::Bt601:
+      if (swapChroma) {
+        return isFullRange ? &libyuv::kYvuJPEGConstants : &libyuv::kYvuI601Constants;
+      }
+      return isFullRange ? &libyuv::kYuvJPEGConstants : &libyuv::kYuvI601Constants;
+    case YuvMatrix::Bt709:
+      if (swapChroma) {
+        return isFullRange ? &libyuv::kYvuF709Constants : &libyuv::kYvuH709Constants;
+      }
+      return isFullRange ? &libyuv::kYuvF709Constants : &libyuv::kYuvH709Constants;
+    case YuvMatrix::Bt2020:
+      if (swapChroma) {
+        return isFullRange ? &libyuv::kYvuV2020Constants : &libyuv::kYvu2020Constants;
+      }
+      return isFullRange ? &libyuv::kYuvV2020Constants : &libyuv::kYuv2020Constants;
+    default:
+      return nullptr;
+  }
+}
+
+bool HasFusedAvifYuvConversion(const avifImage *image, PreferredColorConfig config) {
+  if (!IsAvifColorManagementNoop(image)) {
+    return false;
+  }
+  auto type = image->yuvFormat;
+  bool hasAlpha = image->alphaPlane != nullptr;
+  bool isImage16Bit = avifImageUsesU16(image);
+  bool isPlanarChroma = type == AVIF_PIXEL_FORMAT_YUV420 || type == AVIF_PIXEL_FORMAT_YUV422
+      || type == AVIF_PIXEL_FORMAT_YUV444;
+  YuvMatrix matrix = AvifYuvMatrix(image);
+
+  switch (config) {
+    case Rgba_8888:
+      if (isImage16Bit || matrix == YuvMatrix::Identity) {
+        return false;
+      }
+      return isPlanarChroma || (type == AVIF_PIXEL_FORMAT_YUV400 && !hasAlpha);
+    case Rgb_565:
+      return !isImage16Bit && !hasAlpha && matrix != YuvMatrix::Identity
+          && (type == AVIF_PIXEL_FORMAT_YUV420 || type == AVIF_PIXEL_FORMAT_YUV422);
+    case Rgba_1010102:
+      if (hasAlpha || matrix == YuvMatrix::Identity) {
+        return false;
+      }
+      if (image->depth == 10) {
+        return isPlanarChroma;
+      }
+      return image->depth == 12 && type == AVIF_PIXEL_FORMAT_YUV420;
+    case Rgba_F16:
+      if (matrix == YuvMatrix::Identity && type != AVIF_PIXEL_FORMAT_YUV444) {
+        return false;
+      }
+      return !hasAlpha && isPlanarChroma && (image->depth == 10 || image->depth == 12);
+    default:
+      return false;
+  }
+}
+
+void ConvertAvifYuvToColorConfig(const avifImage *image,
+                                 PreferredColorConfig config,
+                                 uint8_t *dst,
+                                 uint32_t dstStride) {
+  if (!HasFusedAvifYuvConversion(image, config)) {
+    throw std::runtime_error("Image layout can't be converted into requested color config directly");
+  }
+
+  auto type = image->yuvFormat;
+  YuvMatrix matrix = AvifYuvMatrix(image);
+  YuvRange range = AvifYuvRange(image);
+  int width = static_cast<int>(image->width);
+  int height = static_cast<int>(image->height);
+  int stride = static_cast<int>(dstStride);
+
+  if (config == Rgba_F16) {
+    weave_yuv16_to_rgba_f16(
+        reinterpret_cast<const uint16_t *>(image->yuvPlanes[0]), image->yuvRowBytes[0],
+        reinterpret_cast<const uint16_t *>(image->yuvPlanes[1]), image->yuvRowBytes[1],
+        reinterpret_cast<const uint16_t *>(image->yuvPlanes[2]), image->yuvRowBytes[2],
+        reinterpret_cast<uint16_t *>(dst), dstStride,
+        image->depth, image->width, image->height,
+        range, matrix, AvifYuvType(image)
+    );
+    return;
+  }
+
+  const uint8_t *yPlane = image->yuvPlanes[0];
+  const uint8_t *uPlane = image->yuvPlanes[1];
+  const uint8_t *vPlane = image->yuvPlanes[2];
+  int yStride = static_cast<int>(image->yuvRowBytes[0]);
+  int uStride = static_cast<int>(image->yuvRowBytes[1]);
+  int vStride = static_cast<int>(image->yuvRowBytes[2]);
+
+  int result = -1;
+
+  if (config == Rgba_8888) {
+    const libyuv::YuvConstants *constants = LibyuvConstants(matrix, range, true);
+    if (type == AVIF_PIXEL_FORMAT_YUV400) {
+      result = libyuv::I400ToARGBMatrix(yPlane, yStride, dst, stride, constants, width, height);
+    } else if (image->alphaPlane) {
+      const uint8_t *aPlane = image->alphaPlane;
+      int aStride = static_cast<int>(image->alphaRowBytes);
+      // Alpha is premultiplied in the same sweep, as Android expects from RGBA_8888
+      const int attenuate = 1;
+      if (type == AVIF_PIXEL_FORMAT_YUV420) {
+        result = libyuv::I420AlphaToARGBMatrix(yPlane, yStride, vPlane, vStride,
+                                               uPlane, uStride, aPlane, aStride,
+                                               dst, stride, constants, width, height, attenuate);
+      } else if (type == AVIF_PIXEL_FORMAT_YUV422) {
+        result = libyuv::I422AlphaToARGBMatrix(yPlane, yStride, vPlane, vStride,
+                                               uPlane, uStride, aPlane, aStride,
+                                               dst, stride, constants, width, height, attenuate);
+      } else {
+        result = libyuv::I444AlphaToARGBMatrix(yPlane, yStride, vPlane, vStride,
+                                               uPlane, uStride, aPlane, aStride,
+                                               dst, stride, constants, width, height, attenuate);
+      }
+    } else {
+      if (type == AVIF_PIXEL_FORMAT_YUV420) {
+        result = libyuv::I420ToARGBMatrix(yPlane, yStride, vPlane, vStride, uPlane, uStride,
+                                          dst, stride, constants, width, height);
+      } else if (type == AVIF_PIXEL_FORMAT_YUV422) {
+        result = libyuv::I422ToARGBMatrix(yPlane, yStride, vPlane, vStride, uPlane, uStride,
+                                          dst, stride, constants, width, height);
+      } else {
+        result = libyuv::I444ToARGBMatrix(yPlane, yStride, vPlane, vStride, uPlane, uStride,
+                                          dst, stride, constants, width, height);
+      }
+    }
+  } else if (config == Rgb_565) {
+    // libyuv RGB565 has red in high bits same as Android, so planes keep their order
+    const libyuv::YuvConstants *constants = LibyuvConstants(matrix, range, false);
+    if (type == AVIF_PIXEL_FORMAT_YUV420) {
+      result = libyuv::I420ToRGB565Matrix(yPlane, yStride, uPlane, uStride, vPlane, vStride,
+                                          dst, stride, constants, width, height);
+    } else {
+      result = libyuv::I422ToRGB565Matrix(yPlane, yStride, uPlane, uStride, vPlane, vStride,
+                                          dst, stride, constants, width, height);
+    }
+  } else if (config == Rgba_1010102) {
+    // Android RGBA_1010102 keeps red in low bits, that is libyuv AB30
+    const libyuv::YuvConstants *constants = LibyuvConstants(matrix, range, true);
+    auto y16 = reinterpret_cast<const uint16_t *>(yPlane);
+    auto u16 = reinterpret_cast<const uint16_t *>(uPlane);
+    auto v16 = reinterpret_cast<const uint16_t *>(vPlane);
+    int y16Stride = yStride / static_cast<int>(sizeof(uint16_t));
+    int u16Stride = uStride / static_cast<int>(sizeof(uint16_t));
+    int v16Stride = vStride / static_cast<int>(sizeof(uint16_t));
+    if (image->depth == 12) {
+      result = libyuv::I012ToAR30Matrix(y16, y16Stride, v16, v16Stride, u16, u16Stride,
+                                        dst, stride, constants, width, height);
+    } else if (type == AVIF_PIXEL_FORMAT_YUV420) {
+      result = libyuv::I010ToAR30Matrix(y16, y16Stride, v16, v16Stride, u16, u16Stride,
+                                        dst, stride, constants, width, height);
+    } else if (type == AVIF_PIXEL_FORMAT_YUV422) {
+      result = libyuv::I210ToAR30Matrix(y16, y16Stride, v16, v16Stride, u16, u16Stride,
+                                        dst, stride, constants, width, height);
+    } else {
+      result = libyuv::I410ToAR30Matrix(y16, y16Stride, v16, v16Stride, u16, u16Stride,
+                                        dst, stride, constants, width, height);
+    }
+  }
+
+  if (result != 0) {
+    throw std::runtime_error("Can't convert YUV image into requested color config");
+  }
+}
+
+bool CanScaleAvifYuv(const avifImage *image) {
+  return image->alphaPlane == nullptr;
+}
+
+avif::ImagePtr ScaleAvifYuvImage(const avifImage *image,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 int scalingQuality) {
+  avif::ImagePtr scaledImage(avifImageCreateEmpty());
+  if (!scaledImage) {
+    throw std::runtime_error("Can't create scaled image");
+  }
+  if (avifImageCopy(scaledImage.get(), image, static_cast<avifPlanesFlags>(0)) != AVIF_RESULT_OK) {
+    throw std::runtime_error("Can't copy image properties into scaled image");
+  }
+  scaledImage->width = width;
+  scaledImage->height = height;
+  if (avifImageAllocatePlanes(scaledImage.get(), AVIF_PLANES_YUV) != AVIF_RESULT_OK) {
+    throw std::runtime_error("Can't allocate planes of scaled image");
+  }
+
+  // High quality only decimates planes by a power of two, box averages each block exactly
+  // and the remaining ratio is left to Lanczos in RGB
+  libyuv::FilterMode filterMode;
+  switch (scalingQuality) {
+    case ScalingQualityFastest: filterMode = libyuv::kFilterNone;
+      break;
+    case ScalingQualityHigh: filterMode = libyuv::kFilterBox;
+      break;
+    default: filterMode = libyuv::kFilterBilinear;
+      break;
+  }
+  bool isImage16Bit = avifImageUsesU16(image);
+
+  for (int channel = AVIF_CHAN_Y; channel <= AVIF_CHAN_V; ++channel) {
+    if (!image->yuvPlanes[channel] || !scaledImage->yuvPlanes[channel]) {
+      continue;
+    }
+    int srcWidth = static_cast<int>(avifImagePlaneWidth(image, channel));
+    int srcHeight = static_cast<int>(avifImagePlaneHeight(image, channel));
+    int dstWidth = static_cast<int>(avifImagePlaneWidth(scaledImage.get(), channel));
+    int dstHeight = static_cast<int>(avifImagePlaneHeight(scaledImage.get(), channel));
+    int result;
+    if (isImage16Bit) {
+      result = libyuv::ScalePlane_16(
+          reinterpret_cast<const uint16_t *>(image->yuvPlanes[channel]),
+          static_cast<int>(image->yuvRowBytes[channel] / sizeof(uint16_t)),
+          srcWidth, srcHeight,
+          reinterpret_cast<uint16_t *>(scaledImage->yuvPlanes[channel]),
+          static_cast<int>(scaledImage->yuvRowBytes[channel] / sizeof(uint16_t)),
+          dstWidth, dstHeight, filterMode);
+    } else {
+      result = libyuv::ScalePlane(image->yuvPlanes[channel],
+                                  static_cast<int>(image->yuvRowBytes[channel]),
+                                  srcWidth, srcHeight,
+                                  scaledImage->yuvPlanes[channel],
+                                  static_cast<int>(scaledImage->yuvRowBytes[channel]),
+                                  dstWidth, dstHeight, filterMode);
+    }
+    if (result != 0) {
+      throw std::runtime_error("Can't scale image planes");
+    }
+  }
+  return scaledImage;
+}
+
+avif::ImagePtr ChromaNativeAvifImage(const avifImage *image) {
+  if (image->yuvFormat != AVIF_PIXEL_FORMAT_YUV420) {
+    throw std::runtime_error("Only 4:2:0 image can be decoded at chroma resolution");
+  }
+  avif::ImagePtr nativeImage(avifImageCreateEmpty());
+  if (!nativeImage) {
+    throw std::runtime_error("Can't create chroma resolution image");
+  }
+  if (avifImageCopy(nativeImage.get(), image, static_cast<avifPlanesFlags>(0)) != AVIF_RESULT_OK) {
+    throw std::runtime_error("Can't copy image properties into chroma resolution image");
+  }
+  nativeImage->width = avifImagePlaneWidth(image, AVIF_CHAN_U);
+  nativeImage->height = avifImagePlaneHeight(image, AVIF_CHAN_U);
+  nativeImage->yuvFormat = AVIF_PIXEL_FORMAT_YUV444;
+  avifPlanesFlags planes = image->alphaPlane ? AVIF_PLANES_ALL : AVIF_PLANES_YUV;
+  if (avifImageAllocatePlanes(nativeImage.get(), planes) != AVIF_RESULT_OK) {
+    throw std::runtime_error("Can't allocate planes of chroma resolution image");
+  }
+
+  DecimateLumaToChroma(image->yuvPlanes[AVIF_CHAN_Y], image->yuvRowBytes[AVIF_CHAN_Y],
+                       image->alphaPlane, image->alphaRowBytes,
+                       nativeImage->yuvPlanes[AVIF_CHAN_Y], nativeImage->yuvRowBytes[AVIF_CHAN_Y],
+                       nativeImage->alphaPlane, nativeImage->alphaRowBytes,
+                       image->width, image->height, image->depth);
+
+  bool isImage16Bit = avifImageUsesU16(image);
+  int chromaWidth = static_cast<int>(nativeImage->width);
+  int chromaHeight = static_cast<int>(nativeImage->height);
+  for (int channel = AVIF_CHAN_U; channel <= AVIF_CHAN_V; ++channel) {
+    if (isImage16Bit) {
+      libyuv::CopyPlane_16(reinterpret_cast<const uint16_t *>(image->yuvPlanes[channel]),
+                           static_cast<int>(image->yuvRowBytes[channel] / sizeof(uint16_t)),
+                           reinterpret_cast<uint16_t *>(nativeImage->yuvPlanes[channel]),
+                           static_cast<int>(nativeImage->yuvRowBytes[channel] / sizeof(uint16_t)),
+                           chromaWidth, chromaHeight);
+    } else {
+      libyuv::CopyPlane(image->yuvPlanes[channel],
+                        static_cast<int>(image->yuvRowBytes[channel]),
+                        nativeImage->yuvPlanes[channel],
+                        static_cast<int>(nativeImage->yuvRowBytes[channel]),
+                        chromaWidth, chromaHeight);
+    }
+  }
+  return nativeImage;
+}
+
+avif::ImagePtr AvifRegionView(const avifImage *image,
+                              const ImageRegion &region,
+                              uint32_t *offsetX,
+                              uint32_t *offsetY) {
+  if (region.width == 0 || region.height == 0
+      || region.x >= image->width || region.y >= image->height
+      || region.width > image->width - region.x || region.height > image->height - region.y) {
+    std::string str = "Region " + std::to_string(region.x) + "," + std::to_string(region.y)
+        + " " + std::to_string(region.width) + "x" + std::to_string(region.height)
+        + " is out of image bounds " + std::to_string(image->width) + "x"
+        + std::to_string(image->height);
+    throw std::runtime_error(str);
+  }
+
+  avifPixelFormatInfo formatInfo;
+  avifGetPixelFormatInfo(image->yuvFormat, &formatInfo);
+  uint32_t shiftX = formatInfo.monochrome ? 0 : formatInfo.chromaShiftX;
+  uint32_t shiftY = formatInfo.monochrome ? 0 : formatInfo.chromaShiftY;
+
+  avifCropRect rect;
+  rect.x = (region.x >> shiftX) << shiftX;
+  rect.y = (region.y >> shiftY) << shiftY;
+  rect.width = region.width + (region.x - rect.x);
+  rect.height = region.height + (region.y - rect.y);
+
+  avif::ImagePtr view(avifImageCreateEmpty());
+  if (!view) {
+    throw std::runtime_error("Can't create region image");
+  }
+  if (avifImageSetViewRect(view.get(), image, &rect) != AVIF_RESULT_OK) {
+    throw std::runtime_error("Can't create view of the region");
+  }
+  // View shares only planes and CICP, profile is needed by color management
+  if (image->icc.data && image->icc.size
+      && avifImageSetProfileICC(view.get(), image->icc.data, image->icc.size) != AVIF_RESULT_OK) {
+    throw std::runtime_error("Can't attach color profile to the region");
+  }
+  *offsetX = region.x - rect.x;
+  *offsetY = region.y - rect.y;
+  return view;
+}
@@ -0,0 +1,122 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef AVIF_CODER_SRC_MAIN_CPP_AVIFIMAGECONVERSION_H_
+#define AVIF_CODER_SRC_MAIN_CPP_AVIFIMAGECONVERSION_H_
+
+#include "avif/avif.h"
+#include "avif/avif_cxx.h"
+#include "definitions.h"
+#include "Support.h"
+#include "ImageFrame.h"
+#include <cstdint>
+
+/**
+ * Converts rows [startRow, startRow + rowsCount) of decoded YUV image into interleaved RGBA
+ * at the same rows of destination. RGBA is 16-bit when image uses 16-bit planes.
+ * For 4:2:0 images startRow must be even.
+ */
+void ConvertAvifYuvRows(const avifImage *image,
+                        uint8_t *dst,
+                        uint32_t dstStride,
+                        uint32_t startRow,
+                        uint32_t rowsCount);
+
+/**
+ * Same as ConvertAvifYuvRows, but dstRows points at the first converted row,
+ * so a buffer of rowsCount rows is enough
+ */
+void ConvertAvifYuvRowsInto(const avifImage *image,
+                            uint8_t *dstRows,
+                            uint32_t dstStride,
+                            uint32_t startRow,
+                            uint32_t rowsCount);
+
+/**
+ * Brings RGBA image to sRGB using embedded ICC profile, or CICP signalling when there is no profile.
+ * PQ and HLG images are tone mapped with the given curve.
+ */
+void ApplyAvifColorManagement(const avifImage *image,
+                              aligned_uint8_vector &imageStore,
+                              uint32_t stride,
+                              uint32_t imageWidth,
+                              uint32_t imageHeight,
+                              CurveToneMapper toneMapper = REC2408);
+
+/**
+ * Whether image is already in sRGB, so ApplyAvifColorManagement would leave it as is
+ */
+bool IsAvifColorManagementNoop(const avifImage *image);
+
+/**
+ * Whether there is a single pass kernel from image planes into the given bitmap config
+ */
+bool HasFusedAvifYuvConversion(const avifImage *image, PreferredColorConfig config);
+
+/**
+ * Converts whole image from YUV planes straight into final bitmap pixel format in one pass
+ * over memory, alpha is premultiplied on the way. Image must need no color management,
+ * check HasFusedAvifYuvConversion first.
+ */
+void ConvertAvifYuvToColorConfig(const avifImage *image,
+                                 PreferredColorConfig config,
+                                 uint8_t *dst,
+                                 uint32_t dstStride);
+
+/**
+ * Whether planes can be resampled before RGB conversion without changing the result.
+ * Images with alpha are resampled premultiplied, so they have to stay in RGB.
+ */
+bool CanScaleAvifYuv(const avifImage *image);
+
+/**
+ * Resamples YUV planes to the given size with the libyuv filter matching scaling quality,
+ * all color properties are kept, so the result goes through the same conversion as the source would
+ */
+avif::ImagePtr ScaleAvifYuvImage(const avifImage *image,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 int scalingQuality);
+
+/**
+ * Turns 4:2:0 image into 4:4:4 image at chroma resolution, luma is 2x2 averaged
+ * and chroma is taken as is, so conversion does a quarter of the work and no chroma upsampling
+ */
+avif::ImagePtr ChromaNativeAvifImage(const avifImage *image);
+
+/**
+ * Makes a view into image planes covering the region, nothing is copied so source must outlive it.
+ * Subsampled chroma needs an even origin, so view may start up to a pixel earlier,
+ * offset of the region inside the view is returned in offsetX and offsetY.
+ */
+avif::ImagePtr AvifRegionView(const avifImage *image,
+                              const ImageRegion &region,
+                              uint32_t *offsetX,
+                              uint32_t *offsetY);
+
+#endif //AVIF_CODER_SRC_MAIN_CPP_AVIFIMAGECONVERSION_H_
@@ -0,0 +1,221 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "AvifStreamingController.h"
+#include "AvifImageConversion.h"
+#include <thread>
+#include <string>
+
+static void DestroyStreamingIO(struct avifIO *io) {
+  delete io;
+}
+
+AvifStreamingController::AvifStreamingController(uint64_t expectedSize) {
+  this->decoder = avif::DecoderPtr(avifDecoderCreate());
+  if (!decoder) {
+    throw std::runtime_error("Can't create decoder");
+  }
+
+  auto io = new avifIO();
+  io->destroy = DestroyStreamingIO;
+  io->read = AvifStreamingController::readSource;
+  io->write = nullptr;
+  io->sizeHint = expectedSize;
+  // Source grows and may be reallocated, so libavif must keep its own copies
+  io->persistent = AVIF_FALSE;
+  io->data = this;
+  avifDecoderSetIO(this->decoder.get(), io);
+
+  // Metadata is often stored at the end of the file and would stall parsing until the last byte
+  this->decoder->ignoreExif = true;
+  this->decoder->ignoreXMP = true;
+  this->decoder->strictFlags = AVIF_STRICT_DISABLED;
+  this->decoder->allowIncremental = AVIF_TRUE;
+
+  uint32_t hwThreads = std::thread::hardware_concurrency();
+  this->decoder->maxThreads = static_cast<int>(hwThreads);
+}
+
+avifResult AvifStreamingController::readSource(struct avifIO *io,
+                                               uint32_t readFlags,
+                                               uint64_t offset,
+                                               size_t size,
+                                               avifROData *out) {
+  if (readFlags != 0) {
+    return AVIF_RESULT_IO_ERROR;
+  }
+  auto controller = reinterpret_cast<AvifStreamingController *>(io->data);
+  uint64_t available = controller->source.size();
+  if (offset > available) {
+    return controller->isSourceComplete ? AVIF_RESULT_IO_ERROR : AVIF_RESULT_WAITING_ON_IO;
+  }
+  uint64_t availableSize = available - offset;
+  if (size > availableSize) {
+    if (!controller->isSourceComplete) {
+      return AVIF_RESULT_WAITING_ON_IO;
+    }
+    size = static_cast<size_t>(availableSize);
+  }
+  out->data = controller->source.data() + offset;
+  out->size = size;
+  return AVIF_RESULT_OK;
+}
+
+uint32_t AvifStreamingController::append(const uint8_t *data, size_t size) {
+  std::lock_guard guard(this->mutex);
+  if (this->isSourceComplete) {
+    throw std::runtime_error("AVIF stream was already finished");
+  }
+  this->source.insert(this->source.end(), data, data + size);
+  return this->advance();
+}
+
+uint32_t AvifStreamingController::finish() {
+  std::lock_guard guard(this->mutex);
+  this->isSourceComplete = true;
+  uint32_t rows = this->advance();
+  if (!this->isImageDecoded) {
+    throw std::runtime_error("AVIF stream is truncated");
+  }
+  return rows;
+}
+
+uint32_t AvifStreamingController::advance() {
+  if (!this->isParsed) {
+    avifResult result = avifDecoderParse(this->decoder.get());
+    if (result == AVIF_RESULT_WAITING_ON_IO) {
+      return 0;
+    }
+    if (result != AVIF_RESULT_OK) {
+      throw std::runtime_error("This is doesn't looks like AVIF image");
+    }
+    this->isParsed = true;
+
+    auto image = this->decoder->image;
+    size_t componentSize = avifImageUsesU16(image) ? sizeof(uint16_t) : sizeof(uint8_t);
+    this->rgbaStride = image->width * 4 * componentSize;
+    this->rgbaStore.resize(static_cast<size_t>(this->rgbaStride) * image->height);
+    std::fill(this->rgbaStore.begin(), this->rgbaStore.end(), 0);
+  }
+
+  if (!this->isImageDecoded) {
+    avifResult result = avifDecoderNextImage(this->decoder.get());
+    if (result == AVIF_RESULT_OK) {
+      this->isImageDecoded = true;
+    } else if (result != AVIF_RESULT_WAITING_ON_IO) {
+      std::string str = "Can't decode AVIF stream: " + std::string(avifResultToString(result));
+      throw std::runtime_error(str);
+    }
+  }
+
+  auto image = this->decoder->image;
+  uint32_t readyRows = avifDecoderDecodedRowCount(this->decoder.get());
+  // Chroma row is shared by two luma rows in 4:2:0, keep the pair together until it is complete
+  if (image->yuvFormat == AVIF_PIXEL_FORMAT_YUV420 && readyRows < image->height) {
+    readyRows &= ~1u;
+  }
+
+  if (readyRows > this->convertedRows) {
+    ConvertAvifYuvRows(image,
+                       this->rgbaStore.data(),
+                       this->rgbaStride,
+                       this->convertedRows,
+                       readyRows - this->convertedRows);
+    this->convertedRows = readyRows;
+  }
+
+  return this->convertedRows;
+}
+
+bool AvifStreamingController::isHeaderParsed() {
+  std::lock_guard guard(this->mutex);
+  return this->isParsed;
+}
+
+bool AvifStreamingController::isComplete() {
+  std::lock_guard guard(this->mutex);
+  return this->isImageDecoded;
+}
+
+uint32_t AvifStreamingController::getDecodedRows() {
+  std::lock_guard guard(this->mutex);
+  return this->convertedRows;
+}
+
+AvifImageSize AvifStreamingController::getImageSize() {
+  std::lock_guard guard(this->mutex);
+  if (!this->isParsed) {
+    throw std::runtime_error("AVIF stream header is not available yet");
+  }
+  AvifImageSize size = {
+      .width = this->decoder->image->width,
+      .height = this->decoder->image->height
+  };
+  return size;
+}
+
+AvifImageFrame AvifStreamingController::getFrame(uint32_t scaledWidth,
+                                                 uint32_t scaledHeight,
+                                                 PreferredColorConfig javaColorSpace,
+                                                 ScaleMode javaScaleMode,
+                                                 int scalingQuality,
+                                                 CurveToneMapper toneMapper) {
+  std::lock_guard guard(this->mutex);
+  if (!this->isParsed) {
+    throw std::runtime_error("AVIF stream header is not available yet");
+  }
+
+  auto image = this->decoder->image;
+  bool isImageRequires64Bit = avifImageUsesU16(image);
+  uint32_t bitDepth = image->depth;
+  // Undecoded rows are transparent, so partial frame always carries alpha
+  bool imageUsesAlpha = this->decoder->alphaPresent || !this->isImageDecoded;
+
+  uint32_t imageWidth = image->width;
+  uint32_t imageHeight = image->height;
+  uint32_t stride = this->rgbaStride;
+
+  aligned_uint8_vector imageStore = RescaleSourceImage(this->rgbaStore.data(), &stride,
+                                                       bitDepth, isImageRequires64Bit,
+                                                       &imageWidth, &imageHeight,
+                                                       scaledWidth, scaledHeight,
+                                                       javaScaleMode, scalingQuality,
+                                                       imageUsesAlpha);
+
+  ApplyAvifColorManagement(image, imageStore, stride, imageWidth, imageHeight, toneMapper);
+
+  AvifImageFrame imageFrame = {
+      .store = imageStore,
+      .width = imageWidth,
+      .height = imageHeight,
+      .is16Bit = isImageRequires64Bit,
+      .bitDepth = bitDepth,
+      .hasAlpha = imageUsesAlpha
+  };
+  return imageFrame;
+}
@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef AVIF_CODER_SRC_MAIN_CPP_AVIFSTREAMINGCONTROLLER_H_
+#define AVIF_CODER_SRC_MAIN_CPP_AVIFSTREAMINGCONTROLLER_H_
+
+#include "avif/avif_cxx.h"
+#include "definitions.h"
+#include "SizeScaler.h"
+#include "Support.h"
+#include "ImageFrame.h"
+#include <mutex>
+
+/**
+ * Decodes the first image of AVIF while its bytes are still arriving.
+ *
+ * Source is fed chunk by chunk, after every chunk decoder advances as far as available data
+ * allows, grid cells are decoded as soon as their payload is complete, and only newly decoded rows
+ * are converted to RGBA. Frame may be requested at any moment after header was parsed,
+ * rows that are not decoded yet are transparent.
+ */
+class AvifStreamingController {
+ public:
+  /**
+   * @param expectedSize total size of the source when it's known upfront, 0 otherwise
+   */
+  explicit AvifStreamingController(uint64_t expectedSize);
+
+  /**
+   * Appends next chunk of the source and decodes whatever became available
+   * @return count of top rows ready to display
+   */
+  uint32_t append(const uint8_t *data, size_t size);
+  /**
+   * Marks source as complete, truncated sources fail here
+   * @return count of top rows ready to display
+   */
+  uint32_t finish();
+  bool isHeaderParsed();
+  bool isComplete();
+  uint32_t getDecodedRows();
+  AvifImageSize getImageSize();
+  /**
+   * Current state of the image, PQ and HLG images are tone mapped with the given curve
+   */
+  AvifImageFrame getFrame(uint32_t scaledWidth,
+                          uint32_t scaledHeight,
+                          PreferredColorConfig javaColorSpace,
+                          ScaleMode javaScaleMode,
+                          int scalingQuality,
+                          CurveToneMapper toneMapper = REC2408);
+
+ private:
+  static avifResult readSource(struct avifIO *io,
+                               uint32_t readFlags,
+                               uint64_t offset,
+                               size_t size,
+                               avifROData *out);
+  uint32_t advance();
+
+  aligned_uint8_vector source;
+  bool isSourceComplete = false;
+  bool isParsed = false;
+  bool isImageDecoded = false;
+  aligned_uint8_vector rgbaStore;
+  uint32_t rgbaStride = 0;
+  uint32_t convertedRows = 0;
+  avif::DecoderPtr decoder;
+  std::mutex mutex;
+};
+
+#endif //AVIF_CODER_SRC_MAIN_CPP_AVIFSTREAMINGCONTROLLER_H_
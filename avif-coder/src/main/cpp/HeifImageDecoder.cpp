@@ -28,6 +28,10 @@
 
 #include "HeifImageDecoder.h"
 #include <thread>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include "HeifItems.h"
 #include "IccRecognizer.h"
 #include "colorspace.h"
 #include "Eigen/Eigen"
@@ -36,31 +40,906 @@
 #include <ITUR.h>
 #include "ColorMatrix.h"
 #include "avifweaver.h"
+#include "imagebits/CopyUnalignedRGBA.h"
 
-AvifImageFrame HeifImageDecoder::getFrame(std::vector<uint8_t> &srcBuffer,
-                                          uint32_t scaledWidth,
-                                          uint32_t scaledHeight,
-                                          PreferredColorConfig javaColorSpace,
-                                          ScaleMode javaScaleMode,
-                                          int scalingQuality) {
-  heif_context_set_max_decoding_threads(ctx.get(), (int) std::thread::hardware_concurrency());
+/**
+ * Matrix libheif would use to convert the image, only ones our kernels implement are accepted
+ */
+static bool HeifYuvMatrix(const heif_color_profile_nclx *nclx, YuvMatrix *matrix, YuvRange *range) {
+  // Without nclx libheif decodes with BT.601 full range matrix
+  *matrix = YuvMatrix::Bt601;
+  *range = YuvRange::Pc;
+  if (!nclx) {
+    return true;
+  }
+  *range = nclx->full_range_flag ? YuvRange::Pc : YuvRange::Tv;
+  switch (nclx->matrix_coefficients) {
+    case heif_matrix_coefficients_ITU_R_BT_709_5: *matrix = YuvMatrix::Bt709;
+      return true;
+    case heif_matrix_coefficients_unspecified:
+    case heif_matrix_coefficients_ITU_R_BT_470_6_System_B_G:
+    case heif_matrix_coefficients_ITU_R_BT_601_6: *matrix = YuvMatrix::Bt601;
+      return true;
+    case heif_matrix_coefficients_ITU_R_BT_2020_2_non_constant_luminance:
+      *matrix = YuvMatrix::Bt2020;
+      return true;
+    default: return false;
+  }
+}
 
-  auto result = heif_context_read_from_memory_without_copy(ctx.get(), srcBuffer.data(),
-                                                           srcBuffer.size(),
-                                                           nullptr);
+/**
+ * Allocates interleaved RGBA image in the same layout libheif produces for RGB decoding
+ */
+static std::shared_ptr<heif_image> CreateHeifRgbaImage(uint32_t width, uint32_t height,
+                                                       int bitDepth) {
+  bool isHighBitDepth = bitDepth > 8;
+  heif_image *rgbaPtr = nullptr;
+  auto result = heif_image_create(static_cast<int>(width), static_cast<int>(height),
+                                  heif_colorspace_RGB,
+                                  isHighBitDepth ? heif_chroma_interleaved_RRGGBBAA_LE
+                                                 : heif_chroma_interleaved_RGBA,
+                                  &rgbaPtr);
+  if (result.code != heif_error_Ok || !rgbaPtr) {
+    throw std::runtime_error("Can't create RGBA image");
+  }
+  std::shared_ptr<heif_image> rgbaImage(rgbaPtr, [](heif_image *im) {
+    heif_image_release(im);
+  });
+  result = heif_image_add_plane(rgbaImage.get(), heif_channel_interleaved,
+                                static_cast<int>(width), static_cast<int>(height),
+                                isHighBitDepth ? bitDepth : 8);
   if (result.code != heif_error_Ok) {
-    throw std::runtime_error("Can't read heif file exception");
+    throw std::runtime_error("Can't allocate RGBA image");
   }
+  return rgbaImage;
+}
 
-  heif_image_handle *handlePtr;
-  result = heif_context_get_primary_image_handle(ctx.get(), &handlePtr);
-  if (result.code != heif_error_Ok || handlePtr == nullptr) {
-    throw std::runtime_error("Acquiring an image from file has failed");
+static void ConvertHeifYuvPlanes(const uint8_t *luma, uint32_t lumaStride,
+                                 const uint8_t *cb, uint32_t cbStride,
+                                 const uint8_t *cr, uint32_t crStride,
+                                 const uint8_t *alpha, uint32_t alphaStride,
+                                 uint8_t *rgba, uint32_t rgbaStride,
+                                 int bitDepth, uint32_t width, uint32_t height,
+                                 YuvRange range, YuvMatrix matrix, YuvType yuvType) {
+  if (bitDepth > 8) {
+    if (alpha) {
+      weave_yuv16_with_alpha_to_rgba16(
+          reinterpret_cast<const uint16_t *>(luma), lumaStride,
+          reinterpret_cast<const uint16_t *>(cb), cbStride,
+          reinterpret_cast<const uint16_t *>(cr), crStride,
+          reinterpret_cast<const uint16_t *>(alpha), alphaStride,
+          reinterpret_cast<uint16_t *>(rgba), rgbaStride,
+          static_cast<uint32_t>(bitDepth), width, height,
+          range, matrix, yuvType);
+    } else {
+      weave_yuv16_to_rgba16(
+          reinterpret_cast<const uint16_t *>(luma), lumaStride,
+          reinterpret_cast<const uint16_t *>(cb), cbStride,
+          reinterpret_cast<const uint16_t *>(cr), crStride,
+          reinterpret_cast<uint16_t *>(rgba), rgbaStride,
+          static_cast<uint32_t>(bitDepth), width, height,
+          range, matrix, yuvType);
+    }
+  } else {
+    if (alpha) {
+      weave_yuv8_with_alpha_to_rgba8(luma, lumaStride, cb, cbStride, cr, crStride,
+                                     alpha, alphaStride, rgba, rgbaStride,
+                                     width, height, range, matrix, yuvType);
+    } else {
+      weave_yuv8_to_rgba8(luma, lumaStride, cb, cbStride, cr, crStride,
+                          rgba, rgbaStride, width, height, range, matrix, yuvType);
+    }
   }
+}
 
-  std::shared_ptr<heif_image_handle> handle(handlePtr, [](heif_image_handle *hd) {
-    heif_image_handle_release(hd);
-  });
+/**
+ * Reads conversion parameters of decoded YCbCr image, false when our kernels can't convert it
+ */
+static bool HeifYuvConversion(const std::shared_ptr<heif_image> &img, int bitDepth,
+                              YuvMatrix *matrix, YuvRange *range) {
+  heif_color_profile_nclx *nclx = nullptr;
+  auto nclxResult = heif_image_get_nclx_color_profile(img.get(), &nclx);
+  bool isMatrixSupported = HeifYuvMatrix(nclxResult.code == heif_error_Ok ? nclx : nullptr,
+                                         matrix, range);
+  if (nclx) {
+    heif_nclx_color_profile_free(nclx);
+  }
+  if (!isMatrixSupported) {
+    return false;
+  }
+  if (heif_image_has_channel(img.get(), heif_channel_Alpha)
+      && heif_image_get_bits_per_pixel_range(img.get(), heif_channel_Alpha) != bitDepth) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Converts decoded 4:2:0 image into interleaved RGBA at chroma resolution, in the same
+ * layout libheif produces for RGB decoding. Returns nullptr when image can't be handled here.
+ */
+static std::shared_ptr<heif_image> ChromaNativeHeifImage(const std::shared_ptr<heif_image> &img,
+                                                         int bitDepth) {
+  if (heif_image_get_chroma_format(img.get()) != heif_chroma_420) {
+    return nullptr;
+  }
+
+  YuvMatrix matrix;
+  YuvRange range;
+  if (!HeifYuvConversion(img, bitDepth, &matrix, &range)) {
+    return nullptr;
+  }
+
+  bool hasAlpha = heif_image_has_channel(img.get(), heif_channel_Alpha);
+
+  int lumaStride = 0, cbStride = 0, crStride = 0, alphaStride = 0;
+  const uint8_t *luma = heif_image_get_plane_readonly(img.get(), heif_channel_Y, &lumaStride);
+  const uint8_t *cb = heif_image_get_plane_readonly(img.get(), heif_channel_Cb, &cbStride);
+  const uint8_t *cr = heif_image_get_plane_readonly(img.get(), heif_channel_Cr, &crStride);
+  const uint8_t *alpha = hasAlpha
+                         ? heif_image_get_plane_readonly(img.get(), heif_channel_Alpha, &alphaStride)
+                         : nullptr;
+  if (!luma || !cb || !cr || (hasAlpha && !alpha)) {
+    return nullptr;
+  }
+
+  uint32_t width = static_cast<uint32_t>(heif_image_get_width(img.get(), heif_channel_Y));
+  uint32_t height = static_cast<uint32_t>(heif_image_get_height(img.get(), heif_channel_Y));
+  uint32_t chromaWidth = (width + 1) / 2;
+  uint32_t chromaHeight = (height + 1) / 2;
+  bool isHighBitDepth = bitDepth > 8;
+  uint32_t planeStride = chromaWidth * (isHighBitDepth ? sizeof(uint16_t) : sizeof(uint8_t));
+
+  aligned_uint8_vector decimatedLuma(planeStride * chromaHeight);
+  aligned_uint8_vector decimatedAlpha(hasAlpha ? planeStride * chromaHeight : 0);
+  DecimateLumaToChroma(luma, static_cast<uint32_t>(lumaStride),
+                       alpha, static_cast<uint32_t>(alphaStride),
+                       decimatedLuma.data(), planeStride,
+                       hasAlpha ? decimatedAlpha.data() : nullptr, planeStride,
+                       width, height, static_cast<uint32_t>(bitDepth));
+
+  auto rgbaImage = CreateHeifRgbaImage(chromaWidth, chromaHeight, bitDepth);
+  int rgbaStride = 0;
+  uint8_t *rgba = heif_image_get_plane(rgbaImage.get(), heif_channel_interleaved, &rgbaStride);
+
+  ConvertHeifYuvPlanes(decimatedLuma.data(), planeStride,
+                       cb, static_cast<uint32_t>(cbStride),
+                       cr, static_cast<uint32_t>(crStride),
+                       hasAlpha ? decimatedAlpha.data() : nullptr, planeStride,
+                       rgba, static_cast<uint32_t>(rgbaStride),
+                       bitDepth, chromaWidth, chromaHeight,
+                       range, matrix, YuvType::Yuv444);
+  return rgbaImage;
+}
+
+/**
+ * Converts only the region of decoded YCbCr image into interleaved RGBA,
+ * planes are read in place at the region offset. Returns nullptr when image can't be handled here.
+ */
+static std::shared_ptr<heif_image> RegionHeifImage(const std::shared_ptr<heif_image> &img,
+                                                   const ImageRegion &region,
+                                                   int bitDepth) {
+  YuvType yuvType;
+  uint32_t shiftX, shiftY;
+  switch (heif_image_get_chroma_format(img.get())) {
+    case heif_chroma_420: yuvType = YuvType::Yuv420;
+      shiftX = 1;
+      shiftY = 1;
+      break;
+    case heif_chroma_422: yuvType = YuvType::Yuv422;
+      shiftX = 1;
+      shiftY = 0;
+      break;
+    case heif_chroma_444: yuvType = YuvType::Yuv444;
+      shiftX = 0;
+      shiftY = 0;
+      break;
+    default: return nullptr;
+  }
+
+  YuvMatrix matrix;
+  YuvRange range;
+  if (!HeifYuvConversion(img, bitDepth, &matrix, &range)) {
+    return nullptr;
+  }
+
+  bool hasAlpha = heif_image_has_channel(img.get(), heif_channel_Alpha);
+
+  int lumaStride = 0, cbStride = 0, crStride = 0, alphaStride = 0;
+  const uint8_t *luma = heif_image_get_plane_readonly(img.get(), heif_channel_Y, &lumaStride);
+  const uint8_t *cb = heif_image_get_plane_readonly(img.get(), heif_channel_Cb, &cbStride);
+  const uint8_t *cr = heif_image_get_plane_readonly(img.get(), heif_channel_Cr, &crStride);
+  const uint8_t *alpha = hasAlpha
+                         ? heif_image_get_plane_readonly(img.get(), heif_channel_Alpha, &alphaStride)
+                         : nullptr;
+  if (!luma || !cb || !cr || (hasAlpha && !alpha)) {
+    return nullptr;
+  }
+
+  auto width = static_cast<uint32_t>(heif_image_get_width(img.get(), heif_channel_Y));
+  auto height = static_cast<uint32_t>(heif_image_get_height(img.get(), heif_channel_Y));
+  if (region.x + region.width > width || region.y + region.height > height) {
+    return nullptr;
+  }
+
+  // Subsampled chroma needs an even origin, conversion starts a pixel earlier then
+  uint32_t alignedX = (region.x >> shiftX) << shiftX;
+  uint32_t alignedY = (region.y >> shiftY) << shiftY;
+  uint32_t offsetX = region.x - alignedX;
+  uint32_t offsetY = region.y - alignedY;
+  uint32_t alignedWidth = region.width + offsetX;
+  uint32_t alignedHeight = region.height + offsetY;
+  uint32_t componentSize = bitDepth > 8 ? sizeof(uint16_t) : sizeof(uint8_t);
+
+  luma += alignedY * lumaStride + alignedX * componentSize;
+  cb += (alignedY >> shiftY) * cbStride + (alignedX >> shiftX) * componentSize;
+  cr += (alignedY >> shiftY) * crStride + (alignedX >> shiftX) * componentSize;
+  if (alpha) {
+    alpha += alignedY * alphaStride + alignedX * componentSize;
+  }
+
+  auto rgbaImage = CreateHeifRgbaImage(region.width, region.height, bitDepth);
+  int rgbaStride = 0;
+  uint8_t *rgba = heif_image_get_plane(rgbaImage.get(), heif_channel_interleaved, &rgbaStride);
+
+  if (offsetX == 0 && offsetY == 0) {
+    ConvertHeifYuvPlanes(luma, static_cast<uint32_t>(lumaStride),
+                         cb, static_cast<uint32_t>(cbStride),
+                         cr, static_cast<uint32_t>(crStride),
+                         alpha, static_cast<uint32_t>(alphaStride),
+                         rgba, static_cast<uint32_t>(rgbaStride),
+                         bitDepth, region.width, region.height,
+                         range, matrix, yuvType);
+    return rgbaImage;
+  }
+
+  uint32_t pixelSize = 4 * componentSize;
+  uint32_t alignedStride = alignedWidth * pixelSize;
+  aligned_uint8_vector alignedRgba(alignedStride * alignedHeight);
+  ConvertHeifYuvPlanes(luma, static_cast<uint32_t>(lumaStride),
+                       cb, static_cast<uint32_t>(cbStride),
+                       cr, static_cast<uint32_t>(crStride),
+                       alpha, static_cast<uint32_t>(alphaStride),
+                       alignedRgba.data(), alignedStride,
+                       bitDepth, alignedWidth, alignedHeight,
+                       range, matrix, yuvType);
+  coder::CopyUnaligned(alignedRgba.data() + offsetY * alignedStride + offsetX * pixelSize,
+                       alignedStride, rgba, static_cast<uint32_t>(rgbaStride),
+                       region.width * pixelSize, region.height);
+  return rgbaImage;
+}
+
+/**
+ * Cuts region out of image libheif already converted to interleaved RGBA
+ */
+static std::shared_ptr<heif_image> CropHeifRgbaImage(const std::shared_ptr<heif_image> &img,
+                                                     const ImageRegion &region,
+                                                     int bitDepth) {
+  int stride = 0;
+  const uint8_t *data = heif_image_get_plane_readonly(img.get(), heif_channel_interleaved,
+                                                      &stride);
+  if (!data) {
+    throw std::runtime_error("Can't get an image plane");
+  }
+  auto width = static_cast<uint32_t>(heif_image_get_width(img.get(), heif_channel_interleaved));
+  auto height = static_cast<uint32_t>(heif_image_get_height(img.get(), heif_channel_interleaved));
+  if (region.x + region.width > width || region.y + region.height > height) {
+    throw std::runtime_error("Region is out of decoded image bounds");
+  }
+  uint32_t pixelSize = 4 * (bitDepth > 8 ? sizeof(uint16_t) : sizeof(uint8_t));
+  auto rgbaImage = CreateHeifRgbaImage(region.width, region.height, bitDepth);
+  int rgbaStride = 0;
+  uint8_t *rgba = heif_image_get_plane(rgbaImage.get(), heif_channel_interleaved, &rgbaStride);
+  coder::CopyUnaligned(data + region.y * stride + region.x * pixelSize,
+                       static_cast<uint32_t>(stride), rgba, static_cast<uint32_t>(rgbaStride),
+                       region.width * pixelSize, region.height);
+  return rgbaImage;
+}
+
+/**
+ * Colour management of decoded HEIF image: ICC profile, or nclx primaries and transfer with
+ * tone mapping. Every pixel is managed on its own, so any part of the image may be managed
+ * separately, e.g. grid tiles as they are converted.
+ */
+struct HeifColorManagement {
+  std::vector<uint8_t> profile;
+  bool hasNclxTransform = false;
+  float primaries[6] = {0};
+  float whitePoint[2] = {0};
+  ToneMapping toneMapping = ToneMapping::Skip;
+  FfiTrc transferFfi = FfiTrc::Srgb;
+  TransferFunction forwardTrc = TransferFunction::Srgb;
+  CurveToneMapper toneMapper = REC2408;
+  float intensityTarget = 1000.0f;
+  bool is16Bit = false;
+  int bitDepth = 8;
+
+  /** threads caps the workers of the pass, 0 lets it use every core */
+  void apply(uint8_t *rgba, uint32_t stride, uint32_t width, uint32_t height,
+             uint32_t threads = 0) const {
+    if (!profile.empty()) {
+      convertUseICC(rgba, stride, width, height, profile.data(), profile.size(),
+                    is16Bit, static_cast<uint16_t>(bitDepth), threads);
+    } else if (!hasNclxTransform) {
+      return;
+    } else if (toneMapping == ToneMapping::Rec2408 && toneMapper != REC2408) {
+      toneMapWithCurve(rgba, stride, width, height, is16Bit, bitDepth, primaries, whitePoint,
+                       forwardTrc, toneMapper, intensityTarget, threads);
+    } else if (is16Bit) {
+      apply_tone_mapping_rgba16(reinterpret_cast<uint16_t *>(rgba), stride, bitDepth,
+                                width, height, primaries, whitePoint, transferFfi, toneMapping,
+                                intensityTarget, threads);
+    } else {
+      apply_tone_mapping_rgba8(rgba, stride, width, height, primaries, whitePoint,
+                               transferFfi, toneMapping, intensityTarget, threads);
+    }
+  }
+};
+
+/**
+ * ICC profile takes precedence, nclx is used only when it names both primaries and transfer
+ */
+static HeifColorManagement ResolveHeifColorManagement(std::vector<uint8_t> profile,
+                                                      const heif_color_profile_nclx *nclx,
+                                                      CurveToneMapper toneMapper,
+                                                      float intensityTarget,
+                                                      bool is16Bit, int bitDepth) {
+  HeifColorManagement management;
+  management.toneMapper = toneMapper;
+  management.intensityTarget = intensityTarget;
+  management.is16Bit = is16Bit;
+  management.bitDepth = bitDepth;
+  if (!profile.empty()) {
+    management.profile = std::move(profile);
+    return management;
+  }
+  if (!nclx || nclx->transfer_characteristics == heif_transfer_characteristic_unspecified
+      || nclx->color_primaries == heif_color_primaries_unspecified) {
+    return management;
+  }
+  Eigen::Matrix<float, 3, 2> primaries;
+  if (nclx->color_primaries != heif_color_primaries_unspecified) {
+    primaries << static_cast<float>(nclx->color_primary_red_x),
+        static_cast<float>(nclx->color_primary_red_y),
+        static_cast<float>(nclx->color_primary_green_x),
+        static_cast<float>(nclx->color_primary_green_y),
+        static_cast<float>(nclx->color_primary_blue_x),
+        static_cast<float>(nclx->color_primary_blue_y);
+  } else {
+    primaries = getSRGBPrimaries();
+  }
+  Eigen::Vector2f whitePoint;
+  if (nclx->color_primaries != heif_color_primaries_unspecified) {
+    whitePoint << static_cast<float>(nclx->color_primary_white_x),
+        static_cast<float>(nclx->color_primary_white_y);
+  } else {
+    whitePoint = getIlluminantD65();
+  }
+
+  ToneMapping toneMapping = ToneMapping::Rec2408;
+
+  if (nclx->transfer_characteristics !=
+      heif_transfer_characteristic_ITU_R_BT_2100_0_HLG &&
+      nclx->transfer_characteristics != heif_transfer_characteristic_ITU_R_BT_2100_0_PQ) {
+    toneMapping = ToneMapping::Skip;
+  }
+
+  FfiTrc transferFfi = FfiTrc::Srgb;
+  TransferFunction forwardTrc = TransferFunction::Srgb;
+
+  if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_ITU_R_BT_2100_0_HLG) {
+    transferFfi = FfiTrc::Hlg;
+    forwardTrc = TransferFunction::Hlg;
+  } else if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_SMPTE_ST_428_1) {
+    transferFfi = FfiTrc::Smpte428;
+  } else if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_ITU_R_BT_2100_0_PQ) {
+    transferFfi = FfiTrc::Smpte2084;
+    forwardTrc = TransferFunction::Pq;
+  } else if (nclx->transfer_characteristics == heif_transfer_characteristic_linear) {
+    transferFfi = FfiTrc::Linear;
+  } else if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_ITU_R_BT_470_6_System_M) {
+    transferFfi = FfiTrc::Bt470M;
+  } else if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_ITU_R_BT_470_6_System_B_G) {
+    transferFfi = FfiTrc::Bt470Bg;
+  } else if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_ITU_R_BT_601_6) {
+    transferFfi = FfiTrc::Bt709;
+  } else if (nclx->transfer_characteristics == heif_transfer_characteristic_ITU_R_BT_709_5) {
+    transferFfi = FfiTrc::Bt709;
+  } else if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_ITU_R_BT_2020_2_10bit ||
+      nclx->transfer_characteristics ==
+          heif_transfer_characteristic_ITU_R_BT_2020_2_12bit) {
+    transferFfi = FfiTrc::Bt709;
+  } else if (nclx->transfer_characteristics == heif_transfer_characteristic_SMPTE_240M) {
+    transferFfi = FfiTrc::Smpte240;
+  } else if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_logarithmic_100) {
+    transferFfi = FfiTrc::Log100;
+  } else if (nclx->transfer_characteristics ==
+      heif_transfer_characteristic_logarithmic_100_sqrt10) {
+    transferFfi = FfiTrc::Log100sqrt10;
+  } else if (nclx->transfer_characteristics == heif_transfer_characteristic_IEC_61966_2_1) {
+    transferFfi = FfiTrc::Srgb;
+  } else if (nclx->transfer_characteristics == heif_transfer_characteristic_IEC_61966_2_4) {
+    transferFfi = FfiTrc::Iec61966;
+  } else if (nclx->transfer_characteristics == heif_transfer_characteristic_ITU_R_BT_1361) {
+    transferFfi = FfiTrc::Bt1361;
+  } else if (nclx->transfer_characteristics == heif_transfer_characteristic_unspecified) {
+    transferFfi = FfiTrc::Srgb;
+  }
+
+  management.hasNclxTransform = true;
+  management.toneMapping = toneMapping;
+  management.transferFfi = transferFfi;
+  management.forwardTrc = forwardTrc;
+  management.primaries[0] = primaries(0, 0);
+  management.primaries[1] = primaries(0, 1);
+  management.primaries[2] = primaries(1, 0);
+  management.primaries[3] = primaries(1, 1);
+  management.primaries[4] = primaries(2, 0);
+  management.primaries[5] = primaries(2, 1);
+  management.whitePoint[0] = whitePoint(0);
+  management.whitePoint[1] = whitePoint(1);
+  return management;
+}
+
+/**
+ * Colour management of grid read from its handle, ICC profile or nclx there are what libheif
+ * attaches to the assembled image
+ */
+static HeifColorManagement HeifGridColorManagement(const std::shared_ptr<heif_image_handle> &handle,
+                                                   CurveToneMapper toneMapper,
+                                                   bool is16Bit, int bitDepth) {
+  std::vector<uint8_t> profile;
+  auto profileType = heif_image_handle_get_color_profile_type(handle.get());
+  if (profileType == heif_color_profile_type_prof || profileType == heif_color_profile_type_rICC) {
+    profile.resize(heif_image_handle_get_raw_color_profile_size(handle.get()));
+    if (profile.empty()
+        || heif_image_handle_get_raw_color_profile(handle.get(), profile.data()).code
+            != heif_error_Ok) {
+      profile.clear();
+    }
+  }
+  heif_color_profile_nclx *nclx = nullptr;
+  if (heif_image_handle_get_nclx_color_profile(handle.get(), &nclx).code != heif_error_Ok) {
+    nclx = nullptr;
+  }
+  HeifColorManagement management = ResolveHeifColorManagement(std::move(profile), nclx,
+                                                               toneMapper, 1000.0f,
+                                                               is16Bit, bitDepth);
+  if (nclx) {
+    heif_nclx_color_profile_free(nclx);
+  }
+  return management;
+}
+
+/**
+ * Decodes grid image tile by tile on workers: each tile is converted from YCbCr and box decimated
+ * by factor straight into its place on interleaved RGBA canvas, so full resolution YCbCr grid
+ * libheif assembles first is never held. With region only tiles under it are decoded and canvas
+ * holds just the region at full resolution. Colour management, when given, runs on each tile
+ * right after it is placed. heif_context can't decode on several threads at once, so every
+ * worker reads its own context from srcBuffer. Returns nullptr when grid can't be handled here.
+ */
+static std::shared_ptr<heif_image> DecodeHeifGridTiles(heif_context *ctx,
+                                                       const uint8_t *srcBuffer,
+                                                       size_t srcSize,
+                                                       const std::shared_ptr<heif_image_handle> &handle,
+                                                       int bitDepth,
+                                                       uint32_t factor,
+                                                       const ImageRegion *region = nullptr,
+                                                       HeifColorManagement *management = nullptr) {
+  heif_item_id gridId = heif_image_handle_get_item_id(handle.get());
+  if (heif_item_get_item_type(ctx, gridId) != heif_fourcc('g', 'r', 'i', 'd')
+      || heif_image_handle_has_alpha_channel(handle.get())) {
+    return nullptr;
+  }
+  // Rotation, mirroring and crop apply to assembled grid, libheif does them
+  heif_property_id transformations[4];
+  if (heif_item_get_transformation_properties(ctx, gridId, transformations, 4) > 0) {
+    return nullptr;
+  }
+
+  std::vector<heif_item_id> tileIds;
+  for (int index = 0; tileIds.empty(); ++index) {
+    uint32_t referenceType = 0;
+    heif_item_id *references = nullptr;
+    size_t count = heif_context_get_item_references(ctx, gridId, index,
+                                                    &referenceType, &references);
+    if (count > 0 && referenceType == heif_fourcc('d', 'i', 'm', 'g')) {
+      tileIds.assign(references, references + count);
+    }
+    if (references) {
+      heif_release_item_references(ctx, &references);
+    }
+    if (count == 0) {
+      break;
+    }
+  }
+  if (tileIds.size() < 2) {
+    return nullptr;
+  }
+
+  std::vector<std::shared_ptr<heif_image_handle>> tiles;
+  for (heif_item_id tileId : tileIds) {
+    heif_image_handle *tilePtr = nullptr;
+    auto result = heif_context_get_image_handle(ctx, tileId, &tilePtr);
+    if (result.code != heif_error_Ok || !tilePtr) {
+      return nullptr;
+    }
+    tiles.emplace_back(tilePtr, [](heif_image_handle *hd) {
+      heif_image_handle_release(hd);
+    });
+  }
+
+  auto width = static_cast<uint32_t>(heif_image_handle_get_width(handle.get()));
+  auto height = static_cast<uint32_t>(heif_image_handle_get_height(handle.get()));
+  auto tileWidth = static_cast<uint32_t>(heif_image_handle_get_width(tiles[0].get()));
+  auto tileHeight = static_cast<uint32_t>(heif_image_handle_get_height(tiles[0].get()));
+  if (tileWidth == 0 || tileHeight == 0) {
+    return nullptr;
+  }
+  for (const auto &tile : tiles) {
+    if (static_cast<uint32_t>(heif_image_handle_get_width(tile.get())) != tileWidth
+        || static_cast<uint32_t>(heif_image_handle_get_height(tile.get())) != tileHeight) {
+      return nullptr;
+    }
+  }
+  uint32_t columns = (width + tileWidth - 1) / tileWidth;
+  uint32_t rows = (height + tileHeight - 1) / tileHeight;
+  if (static_cast<size_t>(columns) * rows != tiles.size()) {
+    return nullptr;
+  }
+
+  heif_colorspace colorspace = heif_colorspace_undefined;
+  heif_chroma chroma = heif_chroma_undefined;
+  if (heif_image_handle_get_preferred_decoding_colorspace(tiles[0].get(), &colorspace,
+                                                          &chroma).code != heif_error_Ok
+      || colorspace != heif_colorspace_YCbCr) {
+    return nullptr;
+  }
+  YuvType yuvType;
+  uint32_t chromaShiftX = 0, chromaShiftY = 0;
+  switch (chroma) {
+    case heif_chroma_420: yuvType = YuvType::Yuv420;
+      chromaShiftX = chromaShiftY = 1;
+      break;
+    case heif_chroma_422: yuvType = YuvType::Yuv422;
+      chromaShiftX = 1;
+      break;
+    case heif_chroma_444: yuvType = YuvType::Yuv444;
+      break;
+    default: return nullptr;
+  }
+
+  // Grid colr is what libheif converts assembled grid with, tiles are only asked when it's absent
+  YuvMatrix matrix = YuvMatrix::Bt601;
+  YuvRange range = YuvRange::Pc;
+  heif_color_profile_nclx *gridNclx = nullptr;
+  bool hasGridNclx =
+      heif_image_handle_get_nclx_color_profile(handle.get(), &gridNclx).code == heif_error_Ok
+          && gridNclx;
+  bool isMatrixSupported = !hasGridNclx || HeifYuvMatrix(gridNclx, &matrix, &range);
+  if (gridNclx) {
+    heif_nclx_color_profile_free(gridNclx);
+  }
+  if (!isMatrixSupported) {
+    return nullptr;
+  }
+
+  // Box blocks must not straddle tiles, otherwise tiles can't be decimated independently
+  while (factor > 1 && (tileWidth % factor != 0 || tileHeight % factor != 0)) {
+    factor /= 2;
+  }
+
+  ImageRegion area = {.x = 0, .y = 0, .width = width, .height = height};
+  if (region) {
+    if (region->width == 0 || region->height == 0
+        || region->x >= width || region->width > width - region->x
+        || region->y >= height || region->height > height - region->y) {
+      return nullptr;
+    }
+    area = *region;
+    factor = 1;
+  }
+  std::vector<size_t> cells;
+  for (size_t index = 0; index < tiles.size(); ++index) {
+    uint32_t x = static_cast<uint32_t>(index % columns) * tileWidth;
+    uint32_t y = static_cast<uint32_t>(index / columns) * tileHeight;
+    if (x < area.x + area.width && x + tileWidth > area.x
+        && y < area.y + area.height && y + tileHeight > area.y) {
+      cells.push_back(index);
+    }
+  }
+
+  uint32_t canvasWidth = (area.width + factor - 1) / factor;
+  uint32_t canvasHeight = (area.height + factor - 1) / factor;
+  auto canvas = CreateHeifRgbaImage(canvasWidth, canvasHeight, bitDepth);
+  int canvasStride = 0;
+  uint8_t *canvasData = heif_image_get_plane(canvas.get(), heif_channel_interleaved,
+                                             &canvasStride);
+  uint32_t pixelSize = 4 * (bitDepth > 8 ? sizeof(uint16_t) : sizeof(uint8_t));
+
+  auto decodeTile = [&](heif_image_handle *tileHandle) -> std::shared_ptr<heif_image> {
+    heif_image *tilePtr = nullptr;
+    std::unique_ptr<heif_decoding_options, HeifUniquePtrDeleter>
+        options(heif_decoding_options_alloc());
+    options->convert_hdr_to_8bit = false;
+    auto result = heif_decode_image(tileHandle, &tilePtr, heif_colorspace_YCbCr,
+                                    chroma, options.get());
+    if (result.code != heif_error_Ok || !tilePtr) {
+      return nullptr;
+    }
+    return {tilePtr, [](heif_image *im) {
+      heif_image_release(im);
+    }};
+  };
+
+  // Tiles already run side by side, colour managing each of them on every core oversubscribes
+  size_t threadsCount = std::clamp(cells.size() - 1, static_cast<size_t>(1),
+                                   static_cast<size_t>(std::max(std::thread::hardware_concurrency(),
+                                                                1u)));
+  uint32_t manageThreads = threadsCount > 1 ? 1 : 0;
+
+  auto convertTile = [&](size_t index, const std::shared_ptr<heif_image> &tile,
+                         uint32_t threads) -> bool {
+    if (!tile
+        || heif_image_get_chroma_format(tile.get()) != chroma
+        || heif_image_get_bits_per_pixel_range(tile.get(), heif_channel_Y) != bitDepth
+        || static_cast<uint32_t>(heif_image_get_width(tile.get(), heif_channel_Y)) < tileWidth
+        || static_cast<uint32_t>(heif_image_get_height(tile.get(), heif_channel_Y)) < tileHeight) {
+      return false;
+    }
+
+    int lumaStride = 0, cbStride = 0, crStride = 0;
+    const uint8_t *luma = heif_image_get_plane_readonly(tile.get(), heif_channel_Y, &lumaStride);
+    const uint8_t *cb = heif_image_get_plane_readonly(tile.get(), heif_channel_Cb, &cbStride);
+    const uint8_t *cr = heif_image_get_plane_readonly(tile.get(), heif_channel_Cr, &crStride);
+    if (!luma || !cb || !cr) {
+      return false;
+    }
+
+    uint32_t x = static_cast<uint32_t>(index % columns) * tileWidth;
+    uint32_t y = static_cast<uint32_t>(index / columns) * tileHeight;
+    // Part of the tile on the area, right column and bottom row also overhang the grid
+    uint32_t left = std::max(x, area.x) - x;
+    uint32_t top = std::max(y, area.y) - y;
+    uint32_t right = std::min(x + tileWidth, area.x + area.width) - x;
+    uint32_t bottom = std::min(y + tileHeight, area.y + area.height) - y;
+    // Conversion starts on a chroma sample, extra column or row is cut afterwards
+    uint32_t alignedLeft = (left >> chromaShiftX) << chromaShiftX;
+    uint32_t alignedTop = (top >> chromaShiftY) << chromaShiftY;
+    uint32_t sampleSize = bitDepth > 8 ? sizeof(uint16_t) : sizeof(uint8_t);
+    luma += alignedTop * lumaStride + alignedLeft * sampleSize;
+    cb += (alignedTop >> chromaShiftY) * cbStride + (alignedLeft >> chromaShiftX) * sampleSize;
+    cr += (alignedTop >> chromaShiftY) * crStride + (alignedLeft >> chromaShiftX) * sampleSize;
+    uint32_t convertedWidth = right - alignedLeft;
+    uint32_t convertedHeight = bottom - alignedTop;
+    uint8_t *target = canvasData + ((y + top - area.y) / factor) * canvasStride
+        + ((x + left - area.x) / factor) * pixelSize;
+
+    uint32_t placedWidth = factor == 1 ? right - left : (convertedWidth + factor - 1) / factor;
+    uint32_t placedHeight = factor == 1 ? bottom - top : (convertedHeight + factor - 1) / factor;
+    auto manage = [&]() {
+      if (management) {
+        management->apply(target, static_cast<uint32_t>(canvasStride), placedWidth, placedHeight,
+                          threads);
+      }
+      return true;
+    };
+
+    if (factor == 1 && alignedLeft == left && alignedTop == top) {
+      ConvertHeifYuvPlanes(luma, static_cast<uint32_t>(lumaStride),
+                           cb, static_cast<uint32_t>(cbStride),
+                           cr, static_cast<uint32_t>(crStride),
+                           nullptr, 0,
+                           target, static_cast<uint32_t>(canvasStride),
+                           bitDepth, convertedWidth, convertedHeight,
+                           range, matrix, yuvType);
+      return manage();
+    }
+    uint32_t tileStride = convertedWidth * pixelSize;
+    aligned_uint8_vector tileRgba(tileStride * convertedHeight);
+    ConvertHeifYuvPlanes(luma, static_cast<uint32_t>(lumaStride),
+                         cb, static_cast<uint32_t>(cbStride),
+                         cr, static_cast<uint32_t>(crStride),
+                         nullptr, 0,
+                         tileRgba.data(), tileStride,
+                         bitDepth, convertedWidth, convertedHeight,
+                         range, matrix, yuvType);
+    if (factor == 1) {
+      coder::CopyUnaligned(tileRgba.data() + (top - alignedTop) * tileStride
+                               + (left - alignedLeft) * pixelSize, tileStride,
+                           target, static_cast<uint32_t>(canvasStride),
+                           (right - left) * pixelSize, bottom - top);
+      return manage();
+    }
+    BoxDecimateRgbaImage(tileRgba.data(), tileStride, convertedWidth, convertedHeight,
+                         target, static_cast<uint32_t>(canvasStride),
+                         factor, static_cast<uint32_t>(bitDepth), false);
+    return manage();
+  };
+
+  // First tile goes alone, its colr stands in when grid has none
+  auto firstTile = decodeTile(tiles[cells[0]].get());
+  if (!firstTile || (!hasGridNclx && !HeifYuvConversion(firstTile, bitDepth, &matrix, &range))) {
+    return nullptr;
+  }
+  if (management && heif_image_has_content_light_level(firstTile.get())) {
+    heif_content_light_level lightLevel = {0};
+    heif_image_get_content_light_level(firstTile.get(), &lightLevel);
+    if (lightLevel.max_content_light_level != 0) {
+      management->intensityTarget = lightLevel.max_content_light_level;
+    }
+  }
+  if (!convertTile(cells[0], firstTile, 0)) {
+    return nullptr;
+  }
+
+  int decoderThreads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u)
+      / threadsCount);
+  std::atomic<size_t> nextTile(1);
+  std::atomic<bool> failed(false);
+  auto worker = [&]() {
+    if (nextTile >= cells.size()) {
+      return;
+    }
+    std::unique_ptr<heif_context, HeifUniquePtrDeleter> workerCtx(heif_context_alloc());
+    if (!workerCtx
+        || heif_context_read_from_memory_without_copy(workerCtx.get(), srcBuffer, srcSize,
+                                                      nullptr).code != heif_error_Ok) {
+      failed = true;
+      return;
+    }
+    heif_context_set_max_decoding_threads(workerCtx.get(), std::max(decoderThreads, 1));
+    while (!failed) {
+      size_t cell = nextTile++;
+      if (cell >= cells.size()) {
+        break;
+      }
+      heif_image_handle *tilePtr = nullptr;
+      auto result = heif_context_get_image_handle(workerCtx.get(), tileIds[cells[cell]], &tilePtr);
+      if (result.code != heif_error_Ok || !tilePtr) {
+        failed = true;
+        break;
+      }
+      std::shared_ptr<heif_image_handle> tileHandle(tilePtr, [](heif_image_handle *hd) {
+        heif_image_handle_release(hd);
+      });
+      try {
+        if (!convertTile(cells[cell], decodeTile(tileHandle.get()), manageThreads)) {
+          failed = true;
+        }
+      } catch (std::exception &) {
+        failed = true;
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threadsCount; ++i) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : workers) {
+    thread.join();
+  }
+  if (failed) {
+    return nullptr;
+  }
+
+  // RecognizeICC and tone mapping read these from decoded image
+  auto profileType = heif_image_handle_get_color_profile_type(handle.get());
+  if (profileType == heif_color_profile_type_prof || profileType == heif_color_profile_type_rICC) {
+    size_t profileSize = heif_image_handle_get_raw_color_profile_size(handle.get());
+    if (profileSize > 0) {
+      std::vector<uint8_t> profile(profileSize);
+      if (heif_image_handle_get_raw_color_profile(handle.get(), profile.data()).code
+          == heif_error_Ok) {
+        heif_image_set_raw_color_profile(canvas.get(),
+                                         profileType == heif_color_profile_type_prof ? "prof"
+                                                                                     : "rICC",
+                                         profile.data(), profile.size());
+      }
+    }
+  }
+  if (heif_image_has_content_light_level(firstTile.get())) {
+    heif_content_light_level lightLevel = {0};
+    heif_image_get_content_light_level(firstTile.get(), &lightLevel);
+    heif_image_set_content_light_level(canvas.get(), &lightLevel);
+  }
+  return canvas;
+}
+
+/**
+ * Smallest embedded thumbnail that still covers the target with the same aspect ratio,
+ * nullptr when target needs the primary image
+ */
+static std::shared_ptr<heif_image_handle>
+PickThumbnail(const std::shared_ptr<heif_image_handle> &handle,
+              uint32_t scaledWidth,
+              uint32_t scaledHeight,
+              ScaleMode scaleMode) {
+  // Zero or negative sizes keep the source size or its aspect, there is nothing to go smaller for
+  if (static_cast<int32_t>(scaledWidth) <= 0 || static_cast<int32_t>(scaledHeight) <= 0) {
+    return nullptr;
+  }
+  int thumbnailsCount = heif_image_handle_get_number_of_thumbnails(handle.get());
+  if (thumbnailsCount <= 0) {
+    return nullptr;
+  }
+
+  auto width = static_cast<uint32_t>(heif_image_handle_get_width(handle.get()));
+  auto height = static_cast<uint32_t>(heif_image_handle_get_height(handle.get()));
+  ScaledGeometry geometry = ResolveScaledGeometry(width, height,
+                                                  scaledWidth, scaledHeight, scaleMode);
+  if (geometry.resampledWidth >= width || geometry.resampledHeight >= height) {
+    return nullptr;
+  }
+  bool hasAlpha = heif_image_handle_has_alpha_channel(handle.get());
+
+  std::vector<heif_item_id> ids(thumbnailsCount);
+  thumbnailsCount = heif_image_handle_get_list_of_thumbnail_IDs(handle.get(), ids.data(),
+                                                                thumbnailsCount);
+
+  std::shared_ptr<heif_image_handle> picked;
+  uint64_t pickedArea = 0;
+  for (int i = 0; i < thumbnailsCount; ++i) {
+    heif_image_handle *thumbnailPtr = nullptr;
+    auto result = heif_image_handle_get_thumbnail(handle.get(), ids[i], &thumbnailPtr);
+    if (result.code != heif_error_Ok || !thumbnailPtr) {
+      continue;
+    }
+    std::shared_ptr<heif_image_handle> thumbnail(thumbnailPtr, [](heif_image_handle *hd) {
+      heif_image_handle_release(hd);
+    });
+    auto thumbnailWidth = static_cast<uint32_t>(heif_image_handle_get_width(thumbnail.get()));
+    auto thumbnailHeight = static_cast<uint32_t>(heif_image_handle_get_height(thumbnail.get()));
+    if (thumbnailWidth < geometry.resampledWidth || thumbnailHeight < geometry.resampledHeight) {
+      continue;
+    }
+    // Only rounding of the thumbnail size is tolerated, previews cut to another shape are skipped
+    uint64_t crossWidth = static_cast<uint64_t>(thumbnailWidth) * height;
+    uint64_t crossHeight = static_cast<uint64_t>(thumbnailHeight) * width;
+    uint64_t aspectError = crossWidth > crossHeight ? crossWidth - crossHeight
+                                                    : crossHeight - crossWidth;
+    if (aspectError > std::max(width, height)) {
+      continue;
+    }
+    if (static_cast<bool>(heif_image_handle_has_alpha_channel(thumbnail.get())) != hasAlpha) {
+      continue;
+    }
+    uint64_t area = static_cast<uint64_t>(thumbnailWidth) * thumbnailHeight;
+    if (!picked || area < pickedArea) {
+      picked = thumbnail;
+      pickedArea = area;
+    }
+  }
+  return picked;
+}
+
+AvifImageFrame HeifImageDecoder::getFrame(const uint8_t *srcBuffer,
+                                          size_t srcSize,
+                                          uint32_t scaledWidth,
+                                          uint32_t scaledHeight,
+                                          PreferredColorConfig javaColorSpace,
+                                          ScaleMode javaScaleMode,
+                                          int scalingQuality,
+                                          const ImageRegion *region,
+                                          CurveToneMapper toneMapper) {
+  std::shared_ptr<heif_image_handle> handle = openPrimaryImage(srcBuffer, srcSize);
+  // Small targets are served from embedded thumbnail, regions are in primary image coordinates
+  if (!region) {
+    auto thumbnail = PickThumbnail(handle, scaledWidth, scaledHeight, javaScaleMode);
+    if (thumbnail) {
+      handle = thumbnail;
+    }
+  }
 
   int bitDepth = heif_image_handle_get_chroma_bits_per_pixel(handle.get());
   bool useBitmapHalf16Floats = bitDepth > 8;
@@ -70,24 +949,80 @@ AvifImageFrame HeifImageDecoder::getFrame(std::vector<uint8_t> &srcBuffer,
     throw std::runtime_error(currentBitDepthNotSupported);
   }
 
-  heif_image *imgPtr;
-  std::unique_ptr<heif_decoding_options, HeifUniquePtrDeleter>
-      options(heif_decoding_options_alloc());
-  options->convert_hdr_to_8bit = false;
-  options->ignore_transformations = false;
-  result = heif_decode_image(handle.get(), &imgPtr, heif_colorspace_RGB,
-                             useBitmapHalf16Floats ? heif_chroma_interleaved_RRGGBBAA_LE
-                                                   : heif_chroma_interleaved_RGBA,
-                             options.get());
-  options.reset();
+  heif_chroma rgbChroma = useBitmapHalf16Floats ? heif_chroma_interleaved_RRGGBBAA_LE
+                                                : heif_chroma_interleaved_RGBA;
 
-  if (result.code != heif_error_Ok || imgPtr == nullptr) {
-    throw std::runtime_error("Decoding an image has failed");
+  auto handleWidth = static_cast<uint32_t>(heif_image_handle_get_width(handle.get()));
+  auto handleHeight = static_cast<uint32_t>(heif_image_handle_get_height(handle.get()));
+  if (region && (region->width == 0 || region->height == 0
+      || region->x >= handleWidth || region->y >= handleHeight
+      || region->width > handleWidth - region->x || region->height > handleHeight - region->y)) {
+    std::string str = "Region " + std::to_string(region->x) + "," + std::to_string(region->y)
+        + " " + std::to_string(region->width) + "x" + std::to_string(region->height)
+        + " is out of image bounds " + std::to_string(handleWidth) + "x"
+        + std::to_string(handleHeight);
+    throw std::runtime_error(str);
   }
 
-  std::shared_ptr<heif_image> img(imgPtr, [](heif_image *im) {
-    heif_image_release(im);
-  });
+  heif_colorspace nativeColorspace = heif_colorspace_undefined;
+  heif_chroma nativeChroma = heif_chroma_undefined;
+  bool isNativeYCbCr =
+      heif_image_handle_get_preferred_decoding_colorspace(handle.get(),
+                                                          &nativeColorspace,
+                                                          &nativeChroma).code == heif_error_Ok
+          && nativeColorspace == heif_colorspace_YCbCr;
+
+  // 4:2:0 thumbnails are converted at chroma resolution, the rest is left to the resampler
+  ScaledGeometry geometry = ResolveScaledGeometry(region ? region->width : handleWidth,
+                                                  region ? region->height : handleHeight,
+                                                  scaledWidth, scaledHeight, javaScaleMode);
+  bool decodeAtChromaResolution = !region
+      && IsChromaNativeScale(handleWidth, handleHeight,
+                             geometry.resampledWidth, geometry.resampledHeight)
+      && isNativeYCbCr && nativeChroma == heif_chroma_420;
+
+  std::shared_ptr<heif_image> img;
+  std::shared_ptr<heif_image> convertedImage;
+  // Grid tiles are colour managed as they are converted
+  bool isColorManaged = false;
+  if (region) {
+    // Grid items outside of the region are never decoded. Other images are decoded whole,
+    // only the region is converted from YCbCr and the rest of decoded planes is never touched.
+    HeifColorManagement gridManagement = HeifGridColorManagement(handle, toneMapper,
+                                                                 useBitmapHalf16Floats,
+                                                                 bitDepth);
+    img = DecodeHeifGridTiles(ctx.get(), srcBuffer, srcSize, handle, bitDepth, 1, region,
+                              &gridManagement);
+    isColorManaged = img != nullptr;
+    if (!img && isNativeYCbCr && nativeChroma != heif_chroma_monochrome) {
+      img = decodeImage(handle, heif_colorspace_YCbCr, nativeChroma);
+      convertedImage = RegionHeifImage(img, *region, bitDepth);
+    }
+    if (!img || (!convertedImage && heif_image_get_colorspace(img.get()) != heif_colorspace_RGB)) {
+      img = decodeImage(handle, heif_colorspace_RGB, rgbChroma);
+      convertedImage = CropHeifRgbaImage(img, *region, bitDepth);
+    }
+  } else {
+    // Grids are converted tile by tile, already reduced as far as the resampler would box them
+    uint32_t decimation = PreDecimationFactor(handleWidth, handleHeight,
+                                              geometry.resampledWidth, geometry.resampledHeight,
+                                              scalingQuality);
+    HeifColorManagement gridManagement = HeifGridColorManagement(handle, toneMapper,
+                                                                 useBitmapHalf16Floats,
+                                                                 bitDepth);
+    img = DecodeHeifGridTiles(ctx.get(), srcBuffer, srcSize, handle, bitDepth, decimation,
+                              nullptr, &gridManagement);
+    isColorManaged = img != nullptr;
+    if (!img && decodeAtChromaResolution) {
+      img = decodeImage(handle, heif_colorspace_YCbCr, heif_chroma_420);
+      convertedImage = ChromaNativeHeifImage(img, bitDepth);
+      if (!convertedImage) {
+        img = decodeImage(handle, heif_colorspace_RGB, rgbChroma);
+      }
+    } else if (!img) {
+      img = decodeImage(handle, heif_colorspace_RGB, rgbChroma);
+    }
+  }
 
   float intensityTarget = 1000.0f;
 
@@ -109,6 +1044,11 @@ AvifImageFrame HeifImageDecoder::getFrame(std::vector<uint8_t> &srcBuffer,
 
   bool imageHasAlpha = heif_image_handle_has_alpha_channel(handle.get());
 
+  if (convertedImage) {
+    img = convertedImage;
+    convertedImage.reset();
+  }
+
   int imageWidth;
   int imageHeight;
   int stride;
@@ -139,113 +1079,17 @@ AvifImageFrame HeifImageDecoder::getFrame(std::vector<uint8_t> &srcBuffer,
 
   initialData.clear();
 
-  if (!profile.empty()) {
-    convertUseICC(dstARGB, stride, imageWidth, imageHeight, profile.data(),
-                  profile.size(),
-                  useBitmapHalf16Floats, bitDepth);
-  } else if (hasNCLX && nclx &&
-      nclx->transfer_characteristics != heif_transfer_characteristic_unspecified &&
-      nclx->color_primaries != heif_color_primaries_unspecified) {
-    Eigen::Matrix<float, 3, 2> primaries;
-    if (nclx->color_primaries != heif_color_primaries_unspecified) {
-      primaries << static_cast<float>(nclx->color_primary_red_x),
-          static_cast<float>(nclx->color_primary_red_y),
-          static_cast<float>(nclx->color_primary_green_x),
-          static_cast<float>(nclx->color_primary_green_y),
-          static_cast<float>(nclx->color_primary_blue_x),
-          static_cast<float>(nclx->color_primary_blue_y);
-    } else {
-      primaries = getSRGBPrimaries();
-    }
-    Eigen::Vector2f whitePoint;
-    if (nclx->color_primaries != heif_color_primaries_unspecified) {
-      whitePoint << static_cast<float>(nclx->color_primary_white_x),
-          static_cast<float>(nclx->color_primary_white_y);
-    } else {
-      whitePoint = getIlluminantD65();
-    }
-
-    Eigen::Matrix3f destinationProfile = GamutRgbToXYZ(getSRGBPrimaries(), getIlluminantD65());
-    Eigen::Matrix3f sourceProfile = GamutRgbToXYZ(primaries, whitePoint);
-
-    Eigen::Matrix3f conversion = destinationProfile.inverse() * sourceProfile;
-
-    ToneMapping toneMapping = ToneMapping::Rec2408;
-
-    if (nclx->transfer_characteristics !=
-        heif_transfer_characteristic_ITU_R_BT_2100_0_HLG &&
-        nclx->transfer_characteristics != heif_transfer_characteristic_ITU_R_BT_2100_0_PQ) {
-      toneMapping = ToneMapping::Skip;
-    }
-
-    FfiTrc transferFfi = FfiTrc::Srgb;
-    TransferFunction forwardTrc = TransferFunction::Srgb;
-
-    if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_ITU_R_BT_2100_0_HLG) {
-      transferFfi = FfiTrc::Hlg;
-    } else if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_SMPTE_ST_428_1) {
-      transferFfi = FfiTrc::Smpte428;
-    } else if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_ITU_R_BT_2100_0_PQ) {
-      transferFfi = FfiTrc::Smpte2084;
-    } else if (nclx->transfer_characteristics == heif_transfer_characteristic_linear) {
-      transferFfi = FfiTrc::Linear;
-    } else if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_ITU_R_BT_470_6_System_M) {
-      transferFfi = FfiTrc::Bt470M;
-    } else if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_ITU_R_BT_470_6_System_B_G) {
-      transferFfi = FfiTrc::Bt470Bg;
-    } else if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_ITU_R_BT_601_6) {
-      transferFfi = FfiTrc::Bt709;
-    } else if (nclx->transfer_characteristics == heif_transfer_characteristic_ITU_R_BT_709_5) {
-      transferFfi = FfiTrc::Bt709;
-    } else if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_ITU_R_BT_2020_2_10bit ||
-        nclx->transfer_characteristics ==
-            heif_transfer_characteristic_ITU_R_BT_2020_2_12bit) {
-      transferFfi = FfiTrc::Bt709;
-    } else if (nclx->transfer_characteristics == heif_transfer_characteristic_SMPTE_240M) {
-      transferFfi = FfiTrc::Smpte240;
-    } else if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_logarithmic_100) {
-      transferFfi = FfiTrc::Log100;
-    } else if (nclx->transfer_characteristics ==
-        heif_transfer_characteristic_logarithmic_100_sqrt10) {
-      transferFfi = FfiTrc::Log100sqrt10;
-    } else if (nclx->transfer_characteristics == heif_transfer_characteristic_IEC_61966_2_1) {
-      transferFfi = FfiTrc::Srgb;
-    } else if (nclx->transfer_characteristics == heif_transfer_characteristic_IEC_61966_2_4) {
-      transferFfi = FfiTrc::Iec61966;
-    } else if (nclx->transfer_characteristics == heif_transfer_characteristic_ITU_R_BT_1361) {
-      transferFfi = FfiTrc::Bt1361;
-    } else if (nclx->transfer_characteristics == heif_transfer_characteristic_unspecified) {
-      transferFfi = FfiTrc::Srgb;
-    }
-
-    const float cPrimaries[6] = {
-        primaries(0), primaries(1),
-        primaries(2), primaries(3),
-        primaries(4), primaries(5)
-    };
-    const float wp[2] = {
-        whitePoint(0), whitePoint(1)
-    };
-
-    if (useBitmapHalf16Floats) {
-      apply_tone_mapping_rgba16(
-          reinterpret_cast<uint16_t *>(dstARGB.data()), stride, bitDepth,
-          imageWidth, imageHeight, cPrimaries, wp, transferFfi, toneMapping, intensityTarget
-      );
-    } else {
-      apply_tone_mapping_rgba8(
-          reinterpret_cast<uint8_t *>(dstARGB.data()), stride,
-          imageWidth, imageHeight, cPrimaries, wp, transferFfi, toneMapping, intensityTarget
-      );
-    }
+  if (!isColorManaged) {
+    HeifColorManagement management = ResolveHeifColorManagement(std::move(profile),
+                                                                 hasNCLX ? nclx : nullptr,
+                                                                 toneMapper, intensityTarget,
+                                                                 useBitmapHalf16Floats,
+                                                                 bitDepth);
+    management.apply(dstARGB.data(), static_cast<uint32_t>(stride),
+                     static_cast<uint32_t>(imageWidth), static_cast<uint32_t>(imageHeight));
+  }
+  if (nclx) {
+    heif_nclx_color_profile_free(nclx);
   }
 
   AvifImageFrame imageFrame = {
@@ -259,13 +1103,164 @@ AvifImageFrame HeifImageDecoder::getFrame(std::vector<uint8_t> &srcBuffer,
   return imageFrame;
 }
 
-std::string HeifImageDecoder::getImageType(std::vector<uint8_t> &srcBuffer) {
-  auto cMime = heif_get_file_mime_type(reinterpret_cast<const uint8_t *>(srcBuffer.data()),
-                                       static_cast<int>(srcBuffer.size()));
-  if (!cMime) {
-    std::string vec = "image/avif";
-    return vec;
+std::shared_ptr<heif_image_handle> HeifImageDecoder::openPrimaryImage(const uint8_t *srcBuffer,
+                                                                      size_t srcSize) {
+  if (primaryHandle) {
+    return primaryHandle;
   }
-  std::string mime(cMime);
-  return mime;
-}
\ No newline at end of file
+
+  heif_context_set_max_decoding_threads(ctx.get(), (int) std::thread::hardware_concurrency());
+
+  auto result = heif_context_read_from_memory_without_copy(ctx.get(), srcBuffer,
+                                                           srcSize,
+                                                           nullptr);
+  if (result.code != heif_error_Ok) {
+    throw std::runtime_error("Can't read heif file exception");
+  }
+
+  heif_image_handle *handlePtr;
+  result = heif_context_get_primary_image_handle(ctx.get(), &handlePtr);
+  if (result.code != heif_error_Ok || handlePtr == nullptr) {
+    throw std::runtime_error("Acquiring an image from file has failed");
+  }
+
+  primaryHandle = std::shared_ptr<heif_image_handle>(handlePtr, [](heif_image_handle *hd) {
+    heif_image_handle_release(hd);
+  });
+  return primaryHandle;
+}
+
+std::shared_ptr<heif_image>
+HeifImageDecoder::decodeImage(const std::shared_ptr<heif_image_handle> &handle,
+                              heif_colorspace colorspace,
+                              heif_chroma chroma) {
+  heif_item_id itemId = heif_image_handle_get_item_id(handle.get());
+  if (decodedImage && decodedItemId == itemId
+      && decodedColorspace == colorspace && decodedChroma == chroma) {
+    return decodedImage;
+  }
+
+  heif_image *imgPtr;
+  std::unique_ptr<heif_decoding_options, HeifUniquePtrDeleter>
+      options(heif_decoding_options_alloc());
+  options->convert_hdr_to_8bit = false;
+  options->ignore_transformations = false;
+  auto result = heif_decode_image(handle.get(), &imgPtr, colorspace, chroma, options.get());
+  options.reset();
+
+  if (result.code != heif_error_Ok || imgPtr == nullptr) {
+    throw std::runtime_error("Decoding an image has failed");
+  }
+
+  std::shared_ptr<heif_image> img(imgPtr, [](heif_image *im) {
+    heif_image_release(im);
+  });
+  if (retainDecodedImage) {
+    decodedImage = img;
+    decodedItemId = itemId;
+    decodedColorspace = colorspace;
+    decodedChroma = chroma;
+  }
+  return img;
+}
+
+AvifImageSize HeifImageDecoder::getImageSize(const uint8_t *srcBuffer, size_t srcSize) {
+  auto handle = openPrimaryImage(srcBuffer, srcSize);
+  AvifImageSize size = {
+      .width = static_cast<uint32_t>(heif_image_handle_get_width(handle.get())),
+      .height = static_cast<uint32_t>(heif_image_handle_get_height(handle.get())),
+  };
+  return size;
+}
+
+void HeifImageDecoder::readYuvPlanes(const uint8_t *srcBuffer,
+                                     size_t srcSize,
+                                     const std::function<void(const YuvPlanesView &)> &consumer) {
+  heif_context_set_max_decoding_threads(ctx.get(), (int) std::thread::hardware_concurrency());
+
+  auto result = heif_context_read_from_memory_without_copy(ctx.get(), srcBuffer,
+                                                           srcSize,
+                                                           nullptr);
+  if (result.code != heif_error_Ok) {
+    throw std::runtime_error("Can't read heif file exception");
+  }
+
+  heif_image_handle *handlePtr;
+  result = heif_context_get_primary_image_handle(ctx.get(), &handlePtr);
+  if (result.code != heif_error_Ok || handlePtr == nullptr) {
+    throw std::runtime_error("Acquiring an image from file has failed");
+  }
+
+  std::shared_ptr<heif_image_handle> handle(handlePtr, [](heif_image_handle *hd) {
+    heif_image_handle_release(hd);
+  });
+
+  heif_image *imgPtr;
+  std::unique_ptr<heif_decoding_options, HeifUniquePtrDeleter>
+      options(heif_decoding_options_alloc());
+  options->convert_hdr_to_8bit = false;
+  options->ignore_transformations = false;
+  result = heif_decode_image(handle.get(), &imgPtr, heif_colorspace_undefined,
+                             heif_chroma_undefined, options.get());
+  options.reset();
+
+  if (result.code != heif_error_Ok || imgPtr == nullptr) {
+    throw std::runtime_error("Decoding an image has failed");
+  }
+
+  std::shared_ptr<heif_image> img(imgPtr, [](heif_image *im) {
+    heif_image_release(im);
+  });
+
+  YuvSubsampling subsampling;
+  switch (heif_image_get_chroma_format(img.get())) {
+    case heif_chroma_420: subsampling = YUV_SUBSAMPLING_420;
+      break;
+    case heif_chroma_422: subsampling = YUV_SUBSAMPLING_422;
+      break;
+    case heif_chroma_444: subsampling = YUV_SUBSAMPLING_444;
+      break;
+    case heif_chroma_monochrome: subsampling = YUV_SUBSAMPLING_400;
+      break;
+    default: throw std::runtime_error("Image is not stored as YCbCr");
+  }
+
+  int bitDepth = heif_image_get_bits_per_pixel_range(img.get(), heif_channel_Y);
+  if (bitDepth <= 0) {
+    throw std::runtime_error("Stored bit depth in an image is not supported");
+  }
+
+  YuvPlanesView view = {0};
+  const heif_channel channels[3] = {heif_channel_Y, heif_channel_Cb, heif_channel_Cr};
+  int planesCount = subsampling == YUV_SUBSAMPLING_400 ? 1 : 3;
+  for (int plane = 0; plane < planesCount; ++plane) {
+    int rowBytes = 0;
+    view.planes[plane] = heif_image_get_plane_readonly(img.get(), channels[plane], &rowBytes);
+    if (!view.planes[plane]) {
+      throw std::runtime_error("Image plane is missing");
+    }
+    view.rowBytes[plane] = static_cast<uint32_t>(rowBytes);
+  }
+  view.width = static_cast<uint32_t>(heif_image_get_width(img.get(), heif_channel_Y));
+  view.height = static_cast<uint32_t>(heif_image_get_height(img.get(), heif_channel_Y));
+  view.bitDepth = static_cast<uint32_t>(bitDepth);
+  view.subsampling = subsampling;
+
+  // Without nclx libheif decodes with BT.601 full range matrix
+  view.colorPrimaries = heif_color_primaries_unspecified;
+  view.transferCharacteristics = heif_transfer_characteristic_unspecified;
+  view.matrixCoefficients = heif_matrix_coefficients_ITU_R_BT_601_6;
+  view.fullRange = true;
+
+  heif_color_profile_nclx *nclx = nullptr;
+  result = heif_image_handle_get_nclx_color_profile(handle.get(), &nclx);
+  if (result.code == heif_error_Ok && nclx) {
+    view.colorPrimaries = nclx->color_primaries;
+    view.transferCharacteristics = nclx->transfer_characteristics;
+    view.matrixCoefficients = nclx->matrix_coefficients;
+    view.fullRange = nclx->full_range_flag;
+    heif_nclx_color_profile_free(nclx);
+  }
+
+  consumer(view);
+}
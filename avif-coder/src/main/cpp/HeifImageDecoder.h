@@ -36,6 +36,8 @@
 #include "Support.h"
 #include "SizeScaler.h"
 #include "ToneMapper.h"
+#include "YuvPlanes.h"
+#include <functional>
 
 struct HeifUniquePtrDeleter {
   void operator()(heif_context *v) const { heif_context_free(v); }
@@ -52,18 +54,52 @@ class HeifImageDecoder {
     }
   }
 
-  AvifImageFrame getFrame(std::vector<uint8_t> &srcBuffer,
+  /**
+   * Decodes primary image, when region is set only that rectangle is converted and then scaled.
+   * Small targets without region are decoded from embedded thumbnail when there is one big enough.
+   * PQ and HLG images are tone mapped with the given curve.
+   */
+  AvifImageFrame getFrame(const uint8_t *srcBuffer,
+                          size_t srcSize,
                           uint32_t scaledWidth,
                           uint32_t scaledHeight,
                           PreferredColorConfig javaColorSpace,
                           ScaleMode javaScaleMode,
-                          int scalingQuality);
+                          int scalingQuality,
+                          const ImageRegion *region = nullptr,
+                          CurveToneMapper toneMapper = REC2408);
 
-  static std::string getImageType(std::vector<uint8_t> &srcBuffer);
+  /**
+   * Decodes primary image in its native YCbCr layout and lends planes to consumer
+   */
+  void readYuvPlanes(const uint8_t *srcBuffer,
+                     size_t srcSize,
+                     const std::function<void(const YuvPlanesView &)> &consumer);
+
+  AvifImageSize getImageSize(const uint8_t *srcBuffer, size_t srcSize);
+
+  /**
+   * Keeps parsed container and decoded image between getFrame calls, so regions of one source
+   * are decoded only once. Grids decode only the items under each region and keep nothing.
+   * Source must stay alive and unchanged while decoder is used.
+   */
+  void setRetainDecodedImage(bool retain) {
+    retainDecodedImage = retain;
+  }
 
  private:
+  std::shared_ptr<heif_image_handle> openPrimaryImage(const uint8_t *srcBuffer, size_t srcSize);
+  std::shared_ptr<heif_image> decodeImage(const std::shared_ptr<heif_image_handle> &handle,
+                                          heif_colorspace colorspace,
+                                          heif_chroma chroma);
 
   std::unique_ptr<heif_context, HeifUniquePtrDeleter> ctx;
+  bool retainDecodedImage = false;
+  std::shared_ptr<heif_image_handle> primaryHandle;
+  std::shared_ptr<heif_image> decodedImage;
+  heif_item_id decodedItemId = 0;
+  heif_colorspace decodedColorspace = heif_colorspace_undefined;
+  heif_chroma decodedChroma = heif_chroma_undefined;
 };
 
 #endif //AVIF_CODER_SRC_MAIN_CPP_HEIFIMAGEDECODER_H_
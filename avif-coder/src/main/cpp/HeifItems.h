@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef AVIF_CODER_SRC_MAIN_CPP_HEIFITEMS_H_
+#define AVIF_CODER_SRC_MAIN_CPP_HEIFITEMS_H_
+
+#include "libheif/heif.h"
+
+/**
+ * Item level API of libheif 1.18 (heif_items.h, heif_properties.h), prebuilt library exports it
+ * but only heif.h is shipped with the sources
+ */
+extern "C" {
+
+typedef uint32_t heif_property_id;
+
+LIBHEIF_API
+uint32_t heif_item_get_item_type(const struct heif_context *ctx, heif_item_id item_id);
+
+LIBHEIF_API
+int heif_item_get_transformation_properties(const struct heif_context *context,
+                                            heif_item_id id,
+                                            heif_property_id *out_list,
+                                            int count);
+
+LIBHEIF_API
+size_t heif_context_get_item_references(const struct heif_context *ctx,
+                                        heif_item_id from_item_id,
+                                        int index,
+                                        uint32_t *out_reference_type_4cc,
+                                        heif_item_id **out_references_to);
+
+LIBHEIF_API
+void heif_release_item_references(const struct heif_context *ctx, heif_item_id **references);
+
+}
+
+#endif //AVIF_CODER_SRC_MAIN_CPP_HEIFITEMS_H_
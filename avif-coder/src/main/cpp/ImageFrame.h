@@ -30,13 +30,25 @@
 #define AVIF_CODER_SRC_MAIN_CPP_IMAGEFRAME_H_
 
 #include <cstdint>
+#include <functional>
 #include "definitions.h"
+#include "Support.h"
 
 struct AvifImageSize {
   uint32_t width;
   uint32_t height;
 };
 
+/**
+ * Rectangle in image pixel coordinates
+ */
+struct ImageRegion {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
 struct AvifImageFrame {
   aligned_uint8_vector store;
   uint32_t width;
@@ -44,6 +56,30 @@ struct AvifImageFrame {
   bool is16Bit;
   uint32_t bitDepth;
   bool hasAlpha;
+  /**
+   * Bitmap pixel format of the store when decoder already produced final pixels,
+   * Default when store holds unpremultiplied RGBA
+   */
+  PreferredColorConfig storeConfig = Default;
+  /**
+   * Final pixels were written into memory from FrameTargetProvider, store is empty
+   */
+  bool isInTarget = false;
 };
 
+/**
+ * Caller owned memory for final pixels of a frame
+ */
+struct FrameTarget {
+  uint8_t *data;
+  uint32_t stride;
+};
+
+/**
+ * Asked for memory once decoder knows size and bitmap format of the frame,
+ * returns target with null data when frame should go into its own store instead
+ */
+using FrameTargetProvider =
+    std::function<FrameTarget(uint32_t width, uint32_t height, PreferredColorConfig config)>;
+
 #endif //AVIF_CODER_SRC_MAIN_CPP_IMAGEFRAME_H_
@@ -0,0 +1,144 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "ImageTypeSniffer.h"
+#include <algorithm>
+
+static constexpr uint32_t FourCC(char a, char b, char c, char d) {
+  return (static_cast<uint32_t>(a) << 24) | (static_cast<uint32_t>(b) << 16)
+      | (static_cast<uint32_t>(c) << 8) | static_cast<uint32_t>(d);
+}
+
+static uint32_t ReadBE32(const uint8_t *data) {
+  return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16)
+      | (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+SniffedImageType SniffImageType(const uint8_t *data, size_t size) {
+  SniffedImageType type = {.brand = BRAND_UNKNOWN, .isSequence = false};
+  size_t available = std::min(size, kImageTypeSniffLength);
+  if (!data || available < 16) {
+    return type;
+  }
+
+  uint64_t boxSize = ReadBE32(data);
+  if (ReadBE32(data + 4) != FourCC('f', 't', 'y', 'p')) {
+    return type;
+  }
+
+  size_t headerSize = 8;
+  if (boxSize == 1) {
+    if (available < 24) {
+      return type;
+    }
+    boxSize = (static_cast<uint64_t>(ReadBE32(data + 8)) << 32) | ReadBE32(data + 12);
+    headerSize = 16;
+  } else if (boxSize == 0) {
+    // Box extends to the end of the file
+    boxSize = available;
+  }
+
+  if (boxSize < headerSize + 8) {
+    return type;
+  }
+
+  size_t boxEnd = static_cast<size_t>(std::min(boxSize, static_cast<uint64_t>(available)));
+
+  uint32_t majorBrand = ReadBE32(data + headerSize);
+
+  bool hasAvif = false, hasAvis = false, hasHeic = false, hasHeix = false;
+  bool hasMif1 = false, hasMsf1 = false, hasHevc = false, hasHevx = false;
+
+  auto markBrand = [&](uint32_t brand) {
+    switch (brand) {
+      case FourCC('a', 'v', 'i', 'f'): hasAvif = true;
+        break;
+      case FourCC('a', 'v', 'i', 's'): hasAvis = true;
+        break;
+      case FourCC('h', 'e', 'i', 'c'):
+      case FourCC('h', 'e', 'i', 'm'):
+      case FourCC('h', 'e', 'i', 's'): hasHeic = true;
+        break;
+      case FourCC('h', 'e', 'i', 'x'): hasHeix = true;
+        break;
+      case FourCC('h', 'e', 'v', 'c'):
+      case FourCC('h', 'e', 'v', 'm'):
+      case FourCC('h', 'e', 'v', 's'): hasHevc = true;
+        break;
+      case FourCC('h', 'e', 'v', 'x'): hasHevx = true;
+        break;
+      case FourCC('m', 'i', 'f', '1'): hasMif1 = true;
+        break;
+      case FourCC('m', 's', 'f', '1'): hasMsf1 = true;
+        break;
+      default: break;
+    }
+  };
+
+  markBrand(majorBrand);
+  // Skip major and minor version, the rest are compatible brands
+  for (size_t offset = headerSize + 8; offset + 4 <= boxEnd; offset += 4) {
+    markBrand(ReadBE32(data + offset));
+  }
+
+  type.isSequence = hasAvis || hasMsf1 || hasHevc || hasHevx;
+
+  // Major brand wins when it's specific enough, generic brands defer to compatible ones
+  switch (majorBrand) {
+    case FourCC('a', 'v', 'i', 'f'): type.brand = BRAND_AVIF;
+      return type;
+    case FourCC('a', 'v', 'i', 's'): type.brand = BRAND_AVIS;
+      return type;
+    case FourCC('h', 'e', 'i', 'c'):
+    case FourCC('h', 'e', 'i', 'm'):
+    case FourCC('h', 'e', 'i', 's'):
+    case FourCC('h', 'e', 'v', 'c'):
+    case FourCC('h', 'e', 'v', 'm'):
+    case FourCC('h', 'e', 'v', 's'): type.brand = BRAND_HEIC;
+      return type;
+    case FourCC('h', 'e', 'i', 'x'):
+    case FourCC('h', 'e', 'v', 'x'): type.brand = BRAND_HEIX;
+      return type;
+    default: break;
+  }
+
+  if (hasAvis) {
+    type.brand = BRAND_AVIS;
+  } else if (hasAvif) {
+    type.brand = BRAND_AVIF;
+  } else if (hasHeic || hasHevc) {
+    type.brand = BRAND_HEIC;
+  } else if (hasHeix || hasHevx) {
+    type.brand = BRAND_HEIX;
+  } else if (hasMif1) {
+    type.brand = BRAND_MIF1;
+  } else if (hasMsf1) {
+    type.brand = BRAND_MSF1;
+  }
+  return type;
+}
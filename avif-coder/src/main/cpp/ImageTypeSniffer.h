@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef AVIF_CODER_SRC_MAIN_CPP_IMAGETYPESNIFFER_H_
+#define AVIF_CODER_SRC_MAIN_CPP_IMAGETYPESNIFFER_H_
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Amount of leading bytes that is enough to read a complete 'ftyp' box of any real file
+ */
+static constexpr size_t kImageTypeSniffLength = 512;
+
+enum HeifBrand {
+  BRAND_UNKNOWN = 0,
+  BRAND_AVIF = 1,
+  BRAND_AVIS = 2,
+  BRAND_HEIC = 3,
+  BRAND_HEIX = 4,
+  BRAND_MIF1 = 5,
+  BRAND_MSF1 = 6,
+};
+
+struct SniffedImageType {
+  HeifBrand brand;
+  bool isSequence;
+
+  bool isAvif() const {
+    return brand == BRAND_AVIF || brand == BRAND_AVIS;
+  }
+
+  bool isHeif() const {
+    return brand == BRAND_HEIC || brand == BRAND_HEIX
+        || brand == BRAND_MIF1 || brand == BRAND_MSF1;
+  }
+
+  bool isSupported() const {
+    return brand != BRAND_UNKNOWN;
+  }
+
+  /**
+   * Packs the result for the JNI layer: brand in the low byte, sequence flag in bit 8
+   */
+  int32_t pack() const {
+    return static_cast<int32_t>(brand) | (isSequence ? 0x100 : 0);
+  }
+};
+
+/**
+ * Classifies ISOBMFF image by its 'ftyp' box, only first kImageTypeSniffLength bytes are ever read
+ */
+SniffedImageType SniffImageType(const uint8_t *data, size_t size);
+
+#endif //AVIF_CODER_SRC_MAIN_CPP_IMAGETYPESNIFFER_H_
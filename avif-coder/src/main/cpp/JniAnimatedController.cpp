@@ -32,6 +32,7 @@
 #include "aligned_allocator.h"
 #include "JniBitmap.h"
 #include "ReformatBitmap.h"
+#include "JniByteArray.h"
 
 extern "C"
 JNIEXPORT void JNICALL
@@ -48,10 +49,7 @@ Java_com_radzivon_bartoshyk_avif_coder_AvifAnimatedDecoder_createControllerFromB
                                                                                          jobject thiz,
                                                                                          jbyteArray byteArray) {
   try {
-    auto totalLength = env->GetArrayLength(byteArray);
-    aligned_uint8_vector srcBuffer(totalLength);
-    env->GetByteArrayRegion(byteArray, 0, totalLength,
-                            reinterpret_cast<jbyte *>(srcBuffer.data()));
+    JniByteArray srcBuffer(env, byteArray);
     auto controller = new AvifDecoderController(srcBuffer.data(), srcBuffer.size());
     return reinterpret_cast<jlong>(controller);
   } catch (std::bad_alloc &err) {
@@ -78,9 +76,7 @@ Java_com_radzivon_bartoshyk_avif_coder_AvifAnimatedDecoder_createControllerFromB
       throwException(env, errorString);
       return static_cast<jlong>(-1);
     }
-    aligned_uint8_vector srcBuffer(length);
-    std::copy(bufferAddress, bufferAddress + length, srcBuffer.begin());
-    auto controller = new AvifDecoderController(srcBuffer.data(), srcBuffer.size());
+    auto controller = new AvifDecoderController(bufferAddress, length);
     return reinterpret_cast<jlong>(controller);
   } catch (std::bad_alloc &err) {
     std::string exception = "Not enough memory to decode this image";
@@ -92,6 +88,27 @@ Java_com_radzivon_bartoshyk_avif_coder_AvifAnimatedDecoder_createControllerFromB
     return static_cast<jlong>(-1);
   }
 }
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifAnimatedDecoder_createControllerFromFd(JNIEnv *env,
+                                                                                  jobject thiz,
+                                                                                  jint fd) {
+  try {
+    auto mappedFile = std::make_shared<MappedFile>(fd);
+    auto controller = std::make_unique<AvifDecoderController>();
+    controller->attachFile(mappedFile);
+    return reinterpret_cast<jlong>(controller.release());
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jlong>(-1);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jlong>(-1);
+  }
+}
+
 extern "C"
 JNIEXPORT jint JNICALL
 Java_com_radzivon_bartoshyk_avif_coder_AvifAnimatedDecoder_getFramesCount(JNIEnv *env,
@@ -189,34 +206,20 @@ Java_com_radzivon_bartoshyk_avif_coder_AvifAnimatedDecoder_getFrameImpl(JNIEnv *
     }
 
     auto controller = reinterpret_cast<AvifDecoderController *>(ptr);
+    BitmapFrameTarget bitmapTarget(env);
     auto frame = controller->getFrame(frameIndex,
                                       scaledWidth,
                                       scaledHeight,
                                       preferredColorConfig,
                                       scaleMode,
-                                      scaleQuality);
-
-    int osVersion = androidOSVersion();
-
-    bool useBitmapHalf16Floats = false;
-
-    if (frame.is16Bit && osVersion >= 26) {
-      useBitmapHalf16Floats = true;
+                                      scaleQuality,
+                                      nullptr,
+                                      toneMapperFromJava(javaToneMapper),
+                                      bitmapTarget.provider());
+    if (frame.isInTarget) {
+      return bitmapTarget.release();
     }
-
-    std::string imageConfig = useBitmapHalf16Floats ? "RGBA_F16" : "ARGB_8888";
-
-    jobject hwBuffer = nullptr;
-
-    uint32_t stride = frame.width * 4 * (frame.is16Bit ? sizeof(uint16_t) : sizeof(uint8_t));
-
-    coder::ReformatColorConfig(env, ref(frame.store), ref(imageConfig), preferredColorConfig,
-                               frame.bitDepth, frame.width,
-                               frame.height, &stride, &useBitmapHalf16Floats, &hwBuffer,
-                               false, frame.hasAlpha);
-
-    return createBitmap(env, ref(frame.store), imageConfig, stride, frame.width, frame.height,
-                        useBitmapHalf16Floats, hwBuffer);
+    return createBitmapFromFrame(env, frame, preferredColorConfig);
   } catch (std::bad_alloc &err) {
     std::string exception = "Not enough memory to decode this image";
     throwException(env, exception);
@@ -32,6 +32,41 @@
 #include "JniException.h"
 #include <android/bitmap.h>
 #include "imagebits/CopyUnalignedRGBA.h"
+#include "ReformatBitmap.h"
+
+/**
+ * Creates empty Bitmap of Bitmap.Config with the given name
+ */
+static jobject allocateBitmap(JNIEnv *env, const std::string &colorConfig,
+                              uint32_t imageWidth, uint32_t imageHeight) {
+  jclass bitmapConfig = env->FindClass("android/graphics/Bitmap$Config");
+  jfieldID rgba8888FieldID = env->GetStaticFieldID(bitmapConfig, colorConfig.c_str(),
+                                                   "Landroid/graphics/Bitmap$Config;");
+  jobject rgba8888Obj = env->GetStaticObjectField(bitmapConfig, rgba8888FieldID);
+
+  jclass bitmapClass = env->FindClass("android/graphics/Bitmap");
+  jmethodID createBitmapMethodID = env->GetStaticMethodID(bitmapClass,
+                                                          "createBitmap",
+                                                          "(IILandroid/graphics/Bitmap$Config;)Landroid/graphics/Bitmap;");
+  return env->CallStaticObjectMethod(bitmapClass,
+                                     createBitmapMethodID,
+                                     static_cast<int>(imageWidth),
+                                     static_cast<int>(imageHeight),
+                                     rgba8888Obj);
+}
+
+/**
+ * Bitmap.Config name of the packed store config
+ */
+static std::string bitmapConfigName(PreferredColorConfig config) {
+  switch (config) {
+    case Rgba_8888: return "ARGB_8888";
+    case Rgba_F16: return "RGBA_F16";
+    case Rgb_565: return "RGB_565";
+    case Rgba_1010102: return "RGBA_1010102";
+    default: throw std::runtime_error("Frame store has unsupported color config");
+  }
+}
 
 jobject
 createBitmap(JNIEnv *env, aligned_uint8_vector &data, std::string &colorConfig, uint32_t stride,
@@ -46,20 +81,7 @@ createBitmap(JNIEnv *env, aligned_uint8_vector &data, std::string &colorConfig,
                                                     hwBuffer, emptyObject);
     return bitmapObj;
   }
-  jclass bitmapConfig = env->FindClass("android/graphics/Bitmap$Config");
-  jfieldID rgba8888FieldID = env->GetStaticFieldID(bitmapConfig, colorConfig.c_str(),
-                                                   "Landroid/graphics/Bitmap$Config;");
-  jobject rgba8888Obj = env->GetStaticObjectField(bitmapConfig, rgba8888FieldID);
-
-  jclass bitmapClass = env->FindClass("android/graphics/Bitmap");
-  jmethodID createBitmapMethodID = env->GetStaticMethodID(bitmapClass,
-                                                          "createBitmap",
-                                                          "(IILandroid/graphics/Bitmap$Config;)Landroid/graphics/Bitmap;");
-  jobject bitmapObj = env->CallStaticObjectMethod(bitmapClass,
-                                                  createBitmapMethodID,
-                                                  static_cast<int>(imageWidth),
-                                                  static_cast<int>(imageHeight),
-                                                  rgba8888Obj);
+  jobject bitmapObj = allocateBitmap(env, colorConfig, imageWidth, imageHeight);
 
   AndroidBitmapInfo info;
   if (AndroidBitmap_getInfo(env, bitmapObj, &info) < 0) {
@@ -107,4 +129,77 @@ createBitmap(JNIEnv *env, aligned_uint8_vector &data, std::string &colorConfig,
   }
 
   return bitmapObj;
-}
\ No newline at end of file
+}
+
+jobject createBitmapFromFrame(JNIEnv *env, AvifImageFrame &frame,
+                              PreferredColorConfig preferredColorConfig) {
+  if (frame.storeConfig != Default) {
+    std::string storeConfig = bitmapConfigName(frame.storeConfig);
+    uint32_t storeStride = coder::ColorConfigRowBytes(frame.storeConfig, frame.width);
+    return createBitmap(env, frame.store, storeConfig, storeStride, frame.width, frame.height,
+                        frame.storeConfig == Rgba_F16, nullptr);
+  }
+
+  int osVersion = androidOSVersion();
+
+  bool useBitmapHalf16Floats = false;
+
+  if (frame.is16Bit && osVersion >= 26) {
+    useBitmapHalf16Floats = true;
+  }
+
+  std::string imageConfig = useBitmapHalf16Floats ? "RGBA_F16" : "ARGB_8888";
+
+  jobject hwBuffer = nullptr;
+
+  uint32_t stride = frame.width * 4 * (frame.is16Bit ? sizeof(uint16_t) : sizeof(uint8_t));
+
+  coder::ReformatColorConfig(env, frame.store, imageConfig, preferredColorConfig,
+                             frame.bitDepth, frame.width,
+                             frame.height, &stride, &useBitmapHalf16Floats, &hwBuffer,
+                             false, frame.hasAlpha);
+
+  return createBitmap(env, frame.store, imageConfig, stride, frame.width, frame.height,
+                      useBitmapHalf16Floats, hwBuffer);
+}
+
+BitmapFrameTarget::~BitmapFrameTarget() {
+  if (isLocked) {
+    AndroidBitmap_unlockPixels(env, bitmap);
+  }
+}
+
+FrameTargetProvider BitmapFrameTarget::provider() {
+  return [this](uint32_t width, uint32_t height, PreferredColorConfig config) {
+    if (bitmap) {
+      return FrameTarget{nullptr, 0};
+    }
+    jobject created = allocateBitmap(env, bitmapConfigName(config), width, height);
+    if (!created || env->ExceptionCheck()) {
+      env->ExceptionClear();
+      throw std::runtime_error("Can't create bitmap for the decoded frame");
+    }
+    AndroidBitmapInfo info;
+    void *addr;
+    if (AndroidBitmap_getInfo(env, created, &info) < 0
+        || AndroidBitmap_lockPixels(env, created, &addr) != 0) {
+      env->DeleteLocalRef(created);
+      throw std::runtime_error("Can't lock pixels of the created bitmap");
+    }
+    bitmap = created;
+    isLocked = true;
+    return FrameTarget{reinterpret_cast<uint8_t *>(addr), info.stride};
+  };
+}
+
+jobject BitmapFrameTarget::release() {
+  if (isLocked) {
+    isLocked = false;
+    if (AndroidBitmap_unlockPixels(env, bitmap) != 0) {
+      throw std::runtime_error("Can't unlock pixels of the decoded bitmap");
+    }
+  }
+  jobject result = bitmap;
+  bitmap = nullptr;
+  return result;
+}
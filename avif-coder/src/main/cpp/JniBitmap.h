@@ -32,9 +32,42 @@
 #include <jni.h>
 #include <vector>
 #include "definitions.h"
+#include "ImageFrame.h"
+#include "Support.h"
 
 jobject
 createBitmap(JNIEnv *env, aligned_uint8_vector &data, std::string &colorConfig, uint32_t stride,
              uint32_t imageWidth, uint32_t imageHeight, bool use16Floats, jobject hwBuffer);
 
+/**
+ * Reformats decoded frame into preferred config and wraps it into a Bitmap
+ */
+jobject createBitmapFromFrame(JNIEnv *env, AvifImageFrame &frame,
+                              PreferredColorConfig preferredColorConfig);
+
+/**
+ * Lends pixels of a new Bitmap to the decoder, so final pixels are written straight into it.
+ * Bitmap is created in the frame's store config and stays locked until release.
+ */
+class BitmapFrameTarget {
+ public:
+  explicit BitmapFrameTarget(JNIEnv *env) : env(env) {}
+  ~BitmapFrameTarget();
+
+  BitmapFrameTarget(const BitmapFrameTarget &) = delete;
+  BitmapFrameTarget &operator=(const BitmapFrameTarget &) = delete;
+
+  FrameTargetProvider provider();
+
+  /**
+   * Unlocks and hands out the bitmap, null when decoder did not accept the target
+   */
+  jobject release();
+
+ private:
+  JNIEnv *env;
+  jobject bitmap = nullptr;
+  bool isLocked = false;
+};
+
 #endif //AVIF_JNIBITMAP_H
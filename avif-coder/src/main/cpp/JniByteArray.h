@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef AVIF_CODER_SRC_MAIN_CPP_JNIBYTEARRAY_H_
+#define AVIF_CODER_SRC_MAIN_CPP_JNIBYTEARRAY_H_
+
+#include <jni.h>
+#include <cstdint>
+#include <new>
+
+/**
+ * Borrows the contents of a Java byte array for the lifetime of the object.
+ *
+ * ART hands out large arrays in place without copying, so decoders may read the source
+ * directly instead of making a private copy first. The array is released with JNI_ABORT
+ * since it is never written.
+ */
+class JniByteArray {
+ public:
+  JniByteArray(JNIEnv *env, jbyteArray array) : env(env), array(array) {
+    length = static_cast<size_t>(env->GetArrayLength(array));
+    elements = env->GetByteArrayElements(array, nullptr);
+    if (!elements) {
+      throw std::bad_alloc();
+    }
+  }
+
+  JniByteArray(const JniByteArray &) = delete;
+  JniByteArray &operator=(const JniByteArray &) = delete;
+
+  ~JniByteArray() {
+    if (elements) {
+      env->ReleaseByteArrayElements(array, elements, JNI_ABORT);
+      elements = nullptr;
+    }
+  }
+
+  uint8_t *data() const {
+    return reinterpret_cast<uint8_t *>(elements);
+  }
+
+  size_t size() const {
+    return length;
+  }
+
+ private:
+  JNIEnv *env;
+  jbyteArray array;
+  jbyte *elements = nullptr;
+  size_t length = 0;
+};
+
+#endif //AVIF_CODER_SRC_MAIN_CPP_JNIBYTEARRAY_H_
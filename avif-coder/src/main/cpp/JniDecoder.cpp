@@ -18,14 +18,61 @@
 #include "AvifDecoderController.h"
 #include "ReformatBitmap.h"
 #include "JniBitmap.h"
+#include "JniByteArray.h"
+#include "MappedFile.h"
+#include "ImageTypeSniffer.h"
+#include "imagebits/CopyUnalignedRGBA.h"
 #include <dlfcn.h>
 
 using namespace std;
 
+static AvifImageFrame decodeFrameNative(const uint8_t *srcBuffer, size_t srcSize,
+                                        const std::shared_ptr<MappedFile> &mappedFile,
+                                        jint scaledWidth, jint scaledHeight,
+                                        PreferredColorConfig preferredColorConfig,
+                                        ScaleMode scaleMode, jint scalingQuality,
+                                        const ImageRegion *region = nullptr,
+                                        CurveToneMapper toneMapper = REC2408,
+                                        const FrameTargetProvider &target = {}) {
+  SniffedImageType imageType = SniffImageType(srcBuffer, srcSize);
+
+  // Unrecognized sources go to libavif, it reports a meaningful error
+  if (imageType.isAvif() || !imageType.isSupported()) {
+    AvifDecoderController avifController;
+    if (mappedFile) {
+      avifController.attachFile(mappedFile);
+    } else {
+      avifController.borrowBuffer(srcBuffer, srcSize);
+    }
+    return avifController.getFrame(0,
+                                   scaledWidth,
+                                   scaledHeight,
+                                   preferredColorConfig,
+                                   scaleMode,
+                                   scalingQuality,
+                                   region,
+                                   toneMapper,
+                                   target);
+  }
+
+  HeifImageDecoder heifDecoder;
+  return heifDecoder.getFrame(srcBuffer,
+                              srcSize,
+                              scaledWidth,
+                              scaledHeight,
+                              preferredColorConfig,
+                              scaleMode,
+                              scalingQuality,
+                              region,
+                              toneMapper);
+}
+
 jobject decodeImplementationNative(JNIEnv *env, jobject thiz,
-                                   std::vector<uint8_t> &srcBuffer, jint scaledWidth,
+                                   const uint8_t *srcBuffer, size_t srcSize,
+                                   const std::shared_ptr<MappedFile> &mappedFile,
+                                   jint scaledWidth,
                                    jint scaledHeight, jint javaColorSpace, jint javaScaleMode,
-                                   jint scalingQuality) {
+                                   jint scalingQuality, jint javaToneMapper = REC2408) {
   PreferredColorConfig preferredColorConfig;
   ScaleMode scaleMode;
 
@@ -37,50 +84,16 @@ jobject decodeImplementationNative(JNIEnv *env, jobject thiz,
   }
 
   try {
-
-    std::string mimeType = HeifImageDecoder::getImageType(srcBuffer);
-    AvifImageFrame frame;
-
-    if (mimeType == "image/avif" || mimeType == "image/avif-sequence") {
-      AvifDecoderController avifController;
-      avifController.attachBuffer(srcBuffer.data(), srcBuffer.size());
-      frame = avifController.getFrame(0,
-                                      scaledWidth,
-                                      scaledHeight,
-                                      preferredColorConfig,
-                                      scaleMode,
-                                      scalingQuality);
-    } else {
-      HeifImageDecoder heifDecoder;
-      frame = heifDecoder.getFrame(srcBuffer,
-                                   scaledWidth,
-                                   scaledHeight,
-                                   preferredColorConfig,
-                                   scaleMode,
-                                   scalingQuality);
+    BitmapFrameTarget bitmapTarget(env);
+    AvifImageFrame frame = decodeFrameNative(srcBuffer, srcSize, mappedFile,
+                                             scaledWidth, scaledHeight,
+                                             preferredColorConfig, scaleMode, scalingQuality,
+                                             nullptr, toneMapperFromJava(javaToneMapper),
+                                             bitmapTarget.provider());
+    if (frame.isInTarget) {
+      return bitmapTarget.release();
     }
-
-    int osVersion = androidOSVersion();
-
-    bool useBitmapHalf16Floats = false;
-
-    if (frame.is16Bit && osVersion >= 26) {
-      useBitmapHalf16Floats = true;
-    }
-
-    string imageConfig = useBitmapHalf16Floats ? "RGBA_F16" : "ARGB_8888";
-
-    jobject hwBuffer = nullptr;
-
-    uint32_t stride = frame.width * 4 * (frame.is16Bit ? sizeof(uint16_t) : sizeof(uint8_t));
-
-    coder::ReformatColorConfig(env, ref(frame.store), ref(imageConfig), preferredColorConfig,
-                               frame.bitDepth, frame.width,
-                               frame.height, &stride, &useBitmapHalf16Floats, &hwBuffer,
-                               false, frame.hasAlpha);
-
-    return createBitmap(env, ref(frame.store), imageConfig, stride, frame.width, frame.height,
-                        useBitmapHalf16Floats, hwBuffer);
+    return createBitmapFromFrame(env, frame, preferredColorConfig);
   } catch (std::runtime_error &err) {
     string exception(err.what());
     throwException(env, exception);
@@ -97,16 +110,14 @@ Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeImpl(JNIEnv *env,
                                                             jint scaledHeight,
                                                             jint javaColorspace,
                                                             jint scaleMode,
-                                                            jint scaleQuality) {
+                                                            jint scaleQuality,
+                                                            jint toneMapper) {
   try {
-    auto totalLength = env->GetArrayLength(byte_array);
-    std::vector<uint8_t> srcBuffer(totalLength);
-    env->GetByteArrayRegion(byte_array, 0, totalLength,
-                            reinterpret_cast<jbyte *>(srcBuffer.data()));
-    return decodeImplementationNative(env, thiz, srcBuffer,
-                                      scaledWidth, scaledHeight,
+    JniByteArray srcBuffer(env, byte_array);
+    return decodeImplementationNative(env, thiz, srcBuffer.data(), srcBuffer.size(),
+                                      nullptr, scaledWidth, scaledHeight,
                                       javaColorspace, scaleMode,
-                                      scaleQuality);
+                                      scaleQuality, toneMapper);
   } catch (std::bad_alloc &err) {
     std::string exception = "Not enough memory to decode this image";
     throwException(env, exception);
@@ -122,7 +133,8 @@ Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeByteBufferImpl(JNIEnv *en
                                                                       jint scaledHeight,
                                                                       jint clrConfig,
                                                                       jint scaleMode,
-                                                                      jint scalingQuality) {
+                                                                      jint scalingQuality,
+                                                                      jint toneMapper) {
   try {
     auto bufferAddress = reinterpret_cast<uint8_t *>(env->GetDirectBufferAddress(byteBuffer));
     int length = (int) env->GetDirectBufferCapacity(byteBuffer);
@@ -131,14 +143,478 @@ Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeByteBufferImpl(JNIEnv *en
       throwException(env, errorString);
       return nullptr;
     }
-    std::vector<uint8_t> srcBuffer(length);
-    std::copy(bufferAddress, bufferAddress + length, srcBuffer.begin());
-    return decodeImplementationNative(env, thiz, srcBuffer,
-                                      scaledWidth, scaledHeight,
-                                      clrConfig, scaleMode, scalingQuality);
+    return decodeImplementationNative(env, thiz, bufferAddress, static_cast<size_t>(length),
+                                      nullptr, scaledWidth, scaledHeight,
+                                      clrConfig, scaleMode, scalingQuality, toneMapper);
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  }
+}
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeFileImpl(JNIEnv *env,
+                                                                jobject thiz,
+                                                                jint fd,
+                                                                jint scaledWidth,
+                                                                jint scaledHeight,
+                                                                jint clrConfig,
+                                                                jint scaleMode,
+                                                                jint scalingQuality,
+                                                                jint toneMapper) {
+  try {
+    auto mappedFile = std::make_shared<MappedFile>(fd);
+    return decodeImplementationNative(env, thiz, mappedFile->data(), mappedFile->size(),
+                                      mappedFile, scaledWidth, scaledHeight,
+                                      clrConfig, scaleMode, scalingQuality, toneMapper);
   } catch (std::bad_alloc &err) {
     std::string exception = "Not enough memory to decode this image";
     throwException(env, exception);
     return static_cast<jobject>(nullptr);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
   }
-}
\ No newline at end of file
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeRegionImpl(JNIEnv *env,
+                                                                  jobject thiz,
+                                                                  jbyteArray byteArray,
+                                                                  jint left,
+                                                                  jint top,
+                                                                  jint width,
+                                                                  jint height,
+                                                                  jint scaledWidth,
+                                                                  jint scaledHeight,
+                                                                  jint javaColorSpace,
+                                                                  jint javaScaleMode,
+                                                                  jint scalingQuality,
+                                                                  jint toneMapper) {
+  try {
+    PreferredColorConfig preferredColorConfig;
+    ScaleMode scaleMode;
+    if (!checkDecodePreconditions(env, javaColorSpace, &preferredColorConfig, javaScaleMode,
+                                  &scaleMode)) {
+      string exception = "Can't retrieve basic values";
+      throwException(env, exception);
+      return static_cast<jobject>(nullptr);
+    }
+    if (left < 0 || top < 0 || width <= 0 || height <= 0) {
+      std::string exception = "Region must have non negative origin and positive size";
+      throwException(env, exception);
+      return static_cast<jobject>(nullptr);
+    }
+    ImageRegion region = {
+        .x = static_cast<uint32_t>(left),
+        .y = static_cast<uint32_t>(top),
+        .width = static_cast<uint32_t>(width),
+        .height = static_cast<uint32_t>(height),
+    };
+    JniByteArray srcBuffer(env, byteArray);
+    BitmapFrameTarget bitmapTarget(env);
+    AvifImageFrame frame = decodeFrameNative(srcBuffer.data(), srcBuffer.size(), nullptr,
+                                             scaledWidth, scaledHeight,
+                                             preferredColorConfig, scaleMode, scalingQuality,
+                                             &region, toneMapperFromJava(toneMapper),
+                                             bitmapTarget.provider());
+    if (frame.isInTarget) {
+      return bitmapTarget.release();
+    }
+    return createBitmapFromFrame(env, frame, preferredColorConfig);
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  }
+}
+
+/**
+ * Delivers a layer to the listener, returns false when listener asked to stop or has thrown
+ */
+static bool emitProgressiveLayer(JNIEnv *env, jobject listener, jmethodID onLayerMethod,
+                                 jobject bitmap, uint32_t layer, uint32_t layersCount) {
+  jboolean proceed = env->CallBooleanMethod(listener, onLayerMethod, bitmap,
+                                            static_cast<jint>(layer),
+                                            static_cast<jint>(layersCount));
+  if (env->ExceptionCheck()) {
+    return false;
+  }
+  return proceed == JNI_TRUE;
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeProgressiveImpl(JNIEnv *env,
+                                                                       jobject thiz,
+                                                                       jbyteArray byteArray,
+                                                                       jint scaledWidth,
+                                                                       jint scaledHeight,
+                                                                       jint javaColorSpace,
+                                                                       jint javaScaleMode,
+                                                                       jint scalingQuality,
+                                                                       jint toneMapper,
+                                                                       jobject listener) {
+  try {
+    jclass listenerClass = env->GetObjectClass(listener);
+    jmethodID onLayerMethod = env->GetMethodID(listenerClass, "onLayer",
+                                               "(Landroid/graphics/Bitmap;II)Z");
+    if (!onLayerMethod) {
+      return static_cast<jobject>(nullptr);
+    }
+
+    JniByteArray srcBuffer(env, byteArray);
+    SniffedImageType imageType = SniffImageType(srcBuffer.data(), srcBuffer.size());
+
+    if (imageType.isHeif()) {
+      // HEIF has no layers, whole image is a single final layer
+      jobject bitmap = decodeImplementationNative(env, thiz, srcBuffer.data(), srcBuffer.size(),
+                                                  nullptr, scaledWidth, scaledHeight,
+                                                  javaColorSpace, javaScaleMode, scalingQuality,
+                                                  toneMapper);
+      if (bitmap) {
+        emitProgressiveLayer(env, listener, onLayerMethod, bitmap, 0, 1);
+      }
+      return bitmap;
+    }
+
+    PreferredColorConfig preferredColorConfig;
+    ScaleMode scaleMode;
+    if (!checkDecodePreconditions(env, javaColorSpace, &preferredColorConfig, javaScaleMode,
+                                  &scaleMode)) {
+      string exception = "Can't retrieve basic values";
+      throwException(env, exception);
+      return static_cast<jobject>(nullptr);
+    }
+
+    AvifDecoderController avifController;
+    avifController.setAllowProgressive(true);
+    avifController.borrowBuffer(srcBuffer.data(), srcBuffer.size());
+
+    // Non progressive images and sequences are emitted as a single layer with the first frame
+    uint32_t layersCount = avifController.isProgressive() ? avifController.getFramesCount() : 1;
+
+    jobject lastBitmap = nullptr;
+    for (uint32_t layer = 0; layer < layersCount; ++layer) {
+      auto frame = avifController.getFrame(layer,
+                                           scaledWidth,
+                                           scaledHeight,
+                                           preferredColorConfig,
+                                           scaleMode,
+                                           scalingQuality,
+                                           nullptr,
+                                           toneMapperFromJava(toneMapper));
+      jobject bitmap = createBitmapFromFrame(env, frame, preferredColorConfig);
+      if (!bitmap || env->ExceptionCheck()) {
+        return static_cast<jobject>(nullptr);
+      }
+      if (lastBitmap) {
+        env->DeleteLocalRef(lastBitmap);
+      }
+      lastBitmap = bitmap;
+      if (!emitProgressiveLayer(env, listener, onLayerMethod, bitmap, layer, layersCount)) {
+        break;
+      }
+    }
+    return lastBitmap;
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  }
+}
+
+/**
+ * Decodes exactly into destination dimensions, only FILL and RESIZE guarantee that.
+ * Frames produced in destination format are written straight into dst,
+ * anything else is reformatted into it afterwards.
+ */
+static void decodeExactFrameInto(JNIEnv *env, jbyteArray byteArray,
+                                 uint32_t dstWidth, uint32_t dstHeight,
+                                 PreferredColorConfig dstConfig, ScaleMode scaleMode,
+                                 jint scalingQuality, CurveToneMapper toneMapper,
+                                 uint8_t *dst, uint32_t dstStride) {
+  if (scaleMode != Fill && scaleMode != Resize) {
+    throw std::runtime_error("Only FILL and RESIZE scale modes produce exact destination size");
+  }
+  FrameTargetProvider target = [&](uint32_t width, uint32_t height, PreferredColorConfig config) {
+    if (width != dstWidth || height != dstHeight || config != dstConfig) {
+      return FrameTarget{nullptr, 0};
+    }
+    return FrameTarget{dst, dstStride};
+  };
+  JniByteArray srcBuffer(env, byteArray);
+  AvifImageFrame frame = decodeFrameNative(srcBuffer.data(), srcBuffer.size(), nullptr,
+                                           static_cast<jint>(dstWidth),
+                                           static_cast<jint>(dstHeight),
+                                           dstConfig, scaleMode, scalingQuality,
+                                           nullptr, toneMapper, target);
+  if (frame.width != dstWidth || frame.height != dstHeight) {
+    std::string str = "Decoded frame " + std::to_string(frame.width) + "x"
+        + std::to_string(frame.height) + " doesn't match destination "
+        + std::to_string(dstWidth) + "x" + std::to_string(dstHeight);
+    throw std::runtime_error(str);
+  }
+  if (frame.isInTarget) {
+    return;
+  }
+  if (frame.storeConfig != Default) {
+    if (frame.storeConfig != dstConfig) {
+      throw std::runtime_error("Decoded frame config doesn't match destination");
+    }
+    uint32_t rowBytes = coder::ColorConfigRowBytes(frame.storeConfig, frame.width);
+    coder::CopyUnaligned(frame.store.data(), rowBytes, dst, dstStride, rowBytes, frame.height);
+    return;
+  }
+  uint32_t stride = frame.width * 4 * (frame.is16Bit ? sizeof(uint16_t) : sizeof(uint8_t));
+  coder::ReformatColorConfigInto(frame.store, stride, frame.is16Bit, dstConfig, frame.bitDepth,
+                                 frame.width, frame.height, dst, dstStride,
+                                 false, frame.hasAlpha);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeIntoBitmapImpl(JNIEnv *env,
+                                                                      jobject thiz,
+                                                                      jbyteArray byteArray,
+                                                                      jobject bitmap,
+                                                                      jint javaScaleMode,
+                                                                      jint scalingQuality,
+                                                                      jint toneMapper) {
+  try {
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, bitmap, &info) < 0) {
+      throwPixelsException(env);
+      return;
+    }
+    if (info.flags & ANDROID_BITMAP_FLAGS_IS_HARDWARE) {
+      std::string exception = "Hardware bitmaps can't be used as decoding destination";
+      throwException(env, exception);
+      return;
+    }
+
+    PreferredColorConfig dstConfig;
+    switch (info.format) {
+      case ANDROID_BITMAP_FORMAT_RGBA_8888: dstConfig = Rgba_8888;
+        break;
+      case ANDROID_BITMAP_FORMAT_RGBA_F16: dstConfig = Rgba_F16;
+        break;
+      case ANDROID_BITMAP_FORMAT_RGB_565: dstConfig = Rgb_565;
+        break;
+      case ANDROID_BITMAP_FORMAT_RGBA_1010102: dstConfig = Rgba_1010102;
+        break;
+      default: {
+        std::string exception = "Unsupported destination bitmap format: "
+            + std::to_string(info.format);
+        throwException(env, exception);
+        return;
+      }
+    }
+
+    // Pixels stay locked for the whole decode, so the frame is written straight into them
+    void *addr;
+    if (AndroidBitmap_lockPixels(env, bitmap, &addr) != 0) {
+      throwPixelsException(env);
+      return;
+    }
+    try {
+      decodeExactFrameInto(env, byteArray, info.width, info.height, dstConfig,
+                           static_cast<ScaleMode>(javaScaleMode), scalingQuality,
+                           toneMapperFromJava(toneMapper),
+                           reinterpret_cast<uint8_t *>(addr), info.stride);
+    } catch (...) {
+      AndroidBitmap_unlockPixels(env, bitmap);
+      throw;
+    }
+    if (AndroidBitmap_unlockPixels(env, bitmap) != 0) {
+      throwPixelsException(env);
+    }
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+  }
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeIntoBufferImpl(JNIEnv *env,
+                                                                      jobject thiz,
+                                                                      jbyteArray byteArray,
+                                                                      jobject byteBuffer,
+                                                                      jint width,
+                                                                      jint height,
+                                                                      jint stride,
+                                                                      jint javaColorSpace,
+                                                                      jint javaScaleMode,
+                                                                      jint scalingQuality,
+                                                                      jint toneMapper) {
+  try {
+    PreferredColorConfig dstConfig;
+    ScaleMode scaleMode;
+    if (!checkDecodePreconditions(env, javaColorSpace, &dstConfig, javaScaleMode,
+                                  &scaleMode)) {
+      return;
+    }
+    auto bufferAddress = reinterpret_cast<uint8_t *>(env->GetDirectBufferAddress(byteBuffer));
+    auto capacity = env->GetDirectBufferCapacity(byteBuffer);
+    if (!bufferAddress || capacity <= 0) {
+      std::string errorString = "Only direct byte buffers are supported";
+      throwException(env, errorString);
+      return;
+    }
+    if (width <= 0 || height <= 0) {
+      std::string errorString = "Destination dimensions must be positive";
+      throwException(env, errorString);
+      return;
+    }
+    uint32_t rowBytes = coder::ColorConfigRowBytes(dstConfig, static_cast<uint32_t>(width));
+    if (stride < 0 || static_cast<uint32_t>(stride) < rowBytes) {
+      std::string errorString = "Destination stride must be at least "
+          + std::to_string(rowBytes) + " bytes";
+      throwException(env, errorString);
+      return;
+    }
+    uint64_t requiredSize = static_cast<uint64_t>(stride) * (height - 1) + rowBytes;
+    if (requiredSize > static_cast<uint64_t>(capacity)) {
+      std::string errorString = "Destination buffer is too small, required "
+          + std::to_string(requiredSize) + " bytes";
+      throwException(env, errorString);
+      return;
+    }
+
+    decodeExactFrameInto(env, byteArray,
+                         static_cast<uint32_t>(width),
+                         static_cast<uint32_t>(height),
+                         dstConfig, scaleMode, scalingQuality, toneMapperFromJava(toneMapper),
+                         bufferAddress, static_cast<uint32_t>(stride));
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+  }
+}
+
+/**
+ * Layout of the metadata array shared with HeifYuvImage
+ */
+enum YuvMetadataIndex {
+  YUV_META_WIDTH = 0,
+  YUV_META_HEIGHT,
+  YUV_META_BIT_DEPTH,
+  YUV_META_SUBSAMPLING,
+  YUV_META_PLANES_COUNT,
+  YUV_META_CHROMA_WIDTH,
+  YUV_META_CHROMA_HEIGHT,
+  YUV_META_COLOR_PRIMARIES,
+  YUV_META_TRANSFER_CHARACTERISTICS,
+  YUV_META_MATRIX_COEFFICIENTS,
+  YUV_META_FULL_RANGE,
+  YUV_META_OFFSETS,
+  YUV_META_STRIDES = YUV_META_OFFSETS + 3,
+  YUV_META_SIZE = YUV_META_STRIDES + 3,
+};
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_decodeYuvImpl(JNIEnv *env,
+                                                               jobject thiz,
+                                                               jbyteArray byteArray,
+                                                               jint javaOutputLayout,
+                                                               jintArray metadata) {
+  try {
+    if (env->GetArrayLength(metadata) < YUV_META_SIZE) {
+      std::string exception = "Metadata array is too small";
+      throwException(env, exception);
+      return static_cast<jobject>(nullptr);
+    }
+    auto outputLayout = static_cast<YuvOutputLayout>(javaOutputLayout);
+    if (outputLayout != YUV_OUTPUT_PLANAR && outputLayout != YUV_OUTPUT_SEMI_PLANAR) {
+      std::string exception = "Invalid YUV layout was passed";
+      throwException(env, exception);
+      return static_cast<jobject>(nullptr);
+    }
+
+    JniByteArray srcBuffer(env, byteArray);
+    SniffedImageType imageType = SniffImageType(srcBuffer.data(), srcBuffer.size());
+
+    jobject outBuffer = nullptr;
+
+    // Planes are copied once, straight into the Java direct buffer
+    auto packPlanes = [&](const YuvPlanesView &view) {
+      YuvPackedLayout layout = ComputeYuvPackedLayout(view, outputLayout);
+      // Direct buffers are addressed by jint on the Java side
+      if (layout.size > static_cast<uint64_t>(std::numeric_limits<jint>::max())) {
+        throw std::runtime_error("YUV planes of " + std::to_string(layout.size)
+                                     + " bytes don't fit into a single ByteBuffer");
+      }
+
+      jclass byteBufferClass = env->FindClass("java/nio/ByteBuffer");
+      jmethodID allocateDirect = env->GetStaticMethodID(byteBufferClass, "allocateDirect",
+                                                        "(I)Ljava/nio/ByteBuffer;");
+      outBuffer = env->CallStaticObjectMethod(byteBufferClass, allocateDirect,
+                                              static_cast<jint>(layout.size));
+      if (!outBuffer || env->ExceptionCheck()) {
+        outBuffer = nullptr;
+        return;
+      }
+      auto dst = reinterpret_cast<uint8_t *>(env->GetDirectBufferAddress(outBuffer));
+      if (!dst) {
+        outBuffer = nullptr;
+        throw std::runtime_error("Can't access memory of the YUV output buffer");
+      }
+      PackYuvPlanes(view, outputLayout, layout, dst);
+
+      jint values[YUV_META_SIZE] = {0};
+      values[YUV_META_WIDTH] = static_cast<jint>(view.width);
+      values[YUV_META_HEIGHT] = static_cast<jint>(view.height);
+      values[YUV_META_BIT_DEPTH] = static_cast<jint>(view.bitDepth);
+      values[YUV_META_SUBSAMPLING] = static_cast<jint>(view.subsampling);
+      values[YUV_META_PLANES_COUNT] = static_cast<jint>(layout.planesCount);
+      values[YUV_META_CHROMA_WIDTH] = static_cast<jint>(layout.chromaWidth);
+      values[YUV_META_CHROMA_HEIGHT] = static_cast<jint>(layout.chromaHeight);
+      values[YUV_META_COLOR_PRIMARIES] = static_cast<jint>(view.colorPrimaries);
+      values[YUV_META_TRANSFER_CHARACTERISTICS] = static_cast<jint>(view.transferCharacteristics);
+      values[YUV_META_MATRIX_COEFFICIENTS] = static_cast<jint>(view.matrixCoefficients);
+      values[YUV_META_FULL_RANGE] = view.fullRange ? 1 : 0;
+      for (uint32_t plane = 0; plane < layout.planesCount; ++plane) {
+        values[YUV_META_OFFSETS + plane] = static_cast<jint>(layout.offsets[plane]);
+        values[YUV_META_STRIDES + plane] = static_cast<jint>(layout.strides[plane]);
+      }
+      env->SetIntArrayRegion(metadata, 0, YUV_META_SIZE, values);
+    };
+
+    if (imageType.isHeif()) {
+      HeifImageDecoder heifDecoder;
+      heifDecoder.readYuvPlanes(srcBuffer.data(), srcBuffer.size(), packPlanes);
+    } else {
+      AvifDecoderController avifController;
+      avifController.borrowBuffer(srcBuffer.data(), srcBuffer.size());
+      avifController.readYuvPlanes(0, packPlanes);
+    }
+    return outBuffer;
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  }
+}
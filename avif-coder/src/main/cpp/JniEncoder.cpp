@@ -51,6 +51,8 @@
 #include "avif/avif_cxx.h"
 #include <libyuv.h>
 #include "AvifDecoderController.h"
+#include "JniByteArray.h"
+#include "ImageTypeSniffer.h"
 #include "avifweaver.h"
 
 using namespace std;
@@ -773,70 +775,85 @@ Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_encodeHeicImpl(JNIEnv *env,
   }
 }
 
+/**
+ * Copies only a bounded prefix of the array, enough to read 'ftyp' box
+ */
+static SniffedImageType SniffByteArray(JNIEnv *env, jbyteArray byteArray) {
+  uint8_t prefix[kImageTypeSniffLength];
+  auto totalLength = static_cast<size_t>(env->GetArrayLength(byteArray));
+  auto prefixLength = std::min(totalLength, kImageTypeSniffLength);
+  env->GetByteArrayRegion(byteArray, 0, static_cast<jsize>(prefixLength),
+                          reinterpret_cast<jbyte *>(prefix));
+  return SniffImageType(prefix, prefixLength);
+}
+
 extern "C"
 JNIEXPORT jboolean JNICALL
 Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_isHeifImageImpl(JNIEnv *env, jobject thiz,
                                                                  jbyteArray byte_array) {
-  try {
-    auto totalLength = env->GetArrayLength(byte_array);
-    std::vector<uint8_t> srcBuffer(totalLength);
-    env->GetByteArrayRegion(byte_array, 0, totalLength,
-                            reinterpret_cast<jbyte *>(srcBuffer.data()));
-    auto cMime = heif_get_file_mime_type(reinterpret_cast<const uint8_t *>(srcBuffer.data()),
-                                         totalLength);
-    std::string mime(cMime);
-    return mime == "image/heic" || mime == "image/heif" ||
-        mime == "image/heic-sequence" || mime == "image/heif-sequence";
-  } catch (std::bad_alloc &err) {
-    std::string exception = "Not enough memory to check this image";
-    throwException(env, exception);
-    return false;
-  }
+  return SniffByteArray(env, byte_array).isHeif();
 }
 
 extern "C"
 JNIEXPORT jboolean JNICALL
 Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_isAvifImageImpl(JNIEnv *env, jobject thiz,
                                                                  jbyteArray byte_array) {
-  try {
-    auto totalLength = env->GetArrayLength(byte_array);
-    std::vector<uint8_t> srcBuffer(totalLength);
-    env->GetByteArrayRegion(byte_array, 0, totalLength,
-                            reinterpret_cast<jbyte *>(srcBuffer.data()));
-    auto cMime = heif_get_file_mime_type(reinterpret_cast<const uint8_t *>(srcBuffer.data()),
-                                         totalLength);
-    std::string mime(cMime);
-    return mime == "image/avif" || mime == "image/avif-sequence";
-  } catch (std::bad_alloc &err) {
-    std::string exception = "Not enough memory to check this image";
-    throwException(env, exception);
-    return false;
-  }
+  return SniffByteArray(env, byte_array).isAvif();
 }
 
 extern "C"
 JNIEXPORT jboolean JNICALL
 Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_isSupportedImageImpl(JNIEnv *env, jobject thiz,
                                                                       jbyteArray byte_array) {
-  try {
-    auto totalLength = env->GetArrayLength(byte_array);
-    std::vector<uint8_t> srcBuffer(totalLength);
-    env->GetByteArrayRegion(byte_array, 0, totalLength,
-                            reinterpret_cast<jbyte *>(srcBuffer.data()));
-    auto cMime = heif_get_file_mime_type(reinterpret_cast<const uint8_t *>(srcBuffer.data()),
-                                         totalLength);
-    if (!cMime) {
-      return false;
+  return SniffByteArray(env, byte_array).isSupported();
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_getImageTypeImpl(JNIEnv *env, jobject thiz,
+                                                                  jbyteArray byte_array) {
+  return SniffByteArray(env, byte_array).pack();
+}
+
+extern "C"
+JNIEXPORT jintArray JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_getImageTypesImpl(JNIEnv *env, jobject thiz,
+                                                                   jobjectArray byte_arrays) {
+  auto count = env->GetArrayLength(byte_arrays);
+  std::vector<jint> types(count);
+  for (jsize i = 0; i < count; ++i) {
+    auto byteArray = reinterpret_cast<jbyteArray>(env->GetObjectArrayElement(byte_arrays, i));
+    if (byteArray) {
+      types[i] = SniffByteArray(env, byteArray).pack();
+      env->DeleteLocalRef(byteArray);
+    } else {
+      types[i] = SniffedImageType{.brand = BRAND_UNKNOWN, .isSequence = false}.pack();
     }
-    std::string mime(cMime);
-    return mime == "image/heic" || mime == "image/heif" ||
-        mime == "image/heic-sequence" || mime == "image/heif-sequence" ||
-        mime == "image/avif" || mime == "image/avif-sequence";
-  } catch (std::bad_alloc &err) {
-    std::string exception = "Not enough memory to check this image";
+  }
+  jintArray result = env->NewIntArray(count);
+  if (!result) {
+    std::string exception = "Not enough memory to check this images";
     throwException(env, exception);
-    return false;
+    return static_cast<jintArray>(nullptr);
   }
+  env->SetIntArrayRegion(result, 0, count, types.data());
+  return result;
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_getIccTransformCacheStatsImpl(JNIEnv *env,
+                                                                               jobject thiz) {
+  FfiTransformCacheStats stats = icc_transform_cache_stats();
+  jlong counters[2] = {static_cast<jlong>(stats.hits), static_cast<jlong>(stats.misses)};
+  jlongArray result = env->NewLongArray(2);
+  if (!result) {
+    std::string exception = "Not enough memory to read cache stats";
+    throwException(env, exception);
+    return static_cast<jlongArray>(nullptr);
+  }
+  env->SetLongArrayRegion(result, 0, 2, counters);
+  return result;
 }
 
 extern "C"
@@ -851,20 +868,16 @@ Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_getSizeImpl(JNIEnv *env, jobjec
       throwException(env, exception);
       return static_cast<jobject>(nullptr);
     }
-    auto totalLength = env->GetArrayLength(byteArray);
-    std::vector<uint8_t> srcBuffer(totalLength);
-    env->GetByteArrayRegion(byteArray, 0, totalLength,
-                            reinterpret_cast<jbyte *>(srcBuffer.data()));
-
-    auto cMime = heif_get_file_mime_type(reinterpret_cast<const uint8_t *>(srcBuffer.data()),
-                                         totalLength);
-    if (!cMime) {
+    JniByteArray srcBuffer(env, byteArray);
+    auto totalLength = srcBuffer.size();
+
+    auto imageType = SniffImageType(srcBuffer.data(), totalLength);
+    if (!imageType.isSupported()) {
       std::string exception = "Acquiring an image from buffer has failed";
       throwException(env, exception);
       return static_cast<jobject>(nullptr);
     }
-    std::string mime(cMime);
-    if (mime == "image/avif" || mime == "image/avif-sequence") {
+    if (imageType.isAvif()) {
       AvifImageSize size = AvifDecoderController::getImageSize(srcBuffer.data(), srcBuffer.size());
       jclass sizeClass = env->FindClass("android/util/Size");
       jmethodID methodID = env->GetMethodID(sizeClass, "<init>", "(II)V");
@@ -917,29 +930,30 @@ Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_getSizeImpl(JNIEnv *env, jobjec
 }
 
 
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_getImageTypeImplBB(JNIEnv *env, jobject thiz,
+                                                                    jobject byteBuffer) {
+  auto bufferAddress = reinterpret_cast<uint8_t *>(env->GetDirectBufferAddress(byteBuffer));
+  auto length = env->GetDirectBufferCapacity(byteBuffer);
+  if (!bufferAddress || length <= 0) {
+    std::string errorString = "Only direct byte buffers are supported";
+    throwException(env, errorString);
+    return 0;
+  }
+  return SniffImageType(bufferAddress, static_cast<size_t>(length)).pack();
+}
+
 extern "C"
 JNIEXPORT jboolean JNICALL
 Java_com_radzivon_bartoshyk_avif_coder_HeifCoder_isSupportedImageImplBB(JNIEnv *env, jobject thiz,
                                                                         jobject byteBuffer) {
-  try {
-    auto bufferAddress = reinterpret_cast<uint8_t *>(env->GetDirectBufferAddress(byteBuffer));
-    int length = (int) env->GetDirectBufferCapacity(byteBuffer);
-    if (!bufferAddress || length <= 0) {
-      std::string errorString = "Only direct byte buffers are supported";
-      throwException(env, errorString);
-      return (jboolean) false;
-    }
-    std::vector<uint8_t> srcBuffer(length);
-    std::copy(bufferAddress, bufferAddress + length, srcBuffer.begin());
-    auto cMime = heif_get_file_mime_type(reinterpret_cast<const uint8_t *>(srcBuffer.data()),
-                                         (int) srcBuffer.size());
-    std::string mime(cMime);
-    return mime == "image/heic" || mime == "image/heif" ||
-        mime == "image/heic-sequence" || mime == "image/heif-sequence" ||
-        mime == "image/avif" || mime == "image/avif-sequence";
-  } catch (std::bad_alloc &err) {
-    std::string exception = "Not enough memory to check this image";
-    throwException(env, exception);
-    return false;
-  }
-}
\ No newline at end of file
+  auto bufferAddress = reinterpret_cast<uint8_t *>(env->GetDirectBufferAddress(byteBuffer));
+  auto length = env->GetDirectBufferCapacity(byteBuffer);
+  if (!bufferAddress || length <= 0) {
+    std::string errorString = "Only direct byte buffers are supported";
+    throwException(env, errorString);
+    return (jboolean) false;
+  }
+  return SniffImageType(bufferAddress, static_cast<size_t>(length)).isSupported();
+}
@@ -0,0 +1,168 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <jni.h>
+#include <algorithm>
+#include "RegionDecoderController.h"
+#include "JniException.h"
+#include "JniBitmap.h"
+#include "JniByteArray.h"
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifRegionDecoder_destroy(JNIEnv *env,
+                                                                 jobject thiz,
+                                                                 jlong ptr) {
+  auto controller = reinterpret_cast<RegionDecoderController *>(ptr);
+  delete controller;
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifRegionDecoder_createFromByteArray(JNIEnv *env,
+                                                                             jobject thiz,
+                                                                             jbyteArray byteArray,
+                                                                             jlong cacheBytes) {
+  try {
+    JniByteArray srcBuffer(env, byteArray);
+    auto controller = new RegionDecoderController(srcBuffer.data(), srcBuffer.size(),
+                                                  static_cast<size_t>(cacheBytes));
+    return reinterpret_cast<jlong>(controller);
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jlong>(-1);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jlong>(-1);
+  }
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifRegionDecoder_createFromFd(JNIEnv *env,
+                                                                      jobject thiz,
+                                                                      jint fd,
+                                                                      jlong cacheBytes) {
+  try {
+    auto mappedFile = std::make_shared<MappedFile>(fd);
+    auto controller = new RegionDecoderController(mappedFile, static_cast<size_t>(cacheBytes));
+    return reinterpret_cast<jlong>(controller);
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jlong>(-1);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jlong>(-1);
+  }
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifRegionDecoder_getSizeImpl(JNIEnv *env,
+                                                                     jobject thiz,
+                                                                     jlong ptr) {
+  try {
+    auto controller = reinterpret_cast<RegionDecoderController *>(ptr);
+    auto size = controller->getImageSize();
+    jclass sizeClass = env->FindClass("android/util/Size");
+    jmethodID methodID = env->GetMethodID(sizeClass, "<init>", "(II)V");
+    auto sizeObject = env->NewObject(sizeClass,
+                                     methodID,
+                                     static_cast<int>(size.width),
+                                     static_cast<int>(size.height));
+    return sizeObject;
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  }
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_HeifRegionDecoder_decodeRegionImpl(JNIEnv *env,
+                                                                          jobject thiz,
+                                                                          jlong ptr,
+                                                                          jint left,
+                                                                          jint top,
+                                                                          jint width,
+                                                                          jint height,
+                                                                          jint scaledWidth,
+                                                                          jint scaledHeight,
+                                                                          jint javaColorSpace,
+                                                                          jint javaScaleMode,
+                                                                          jint scaleQuality,
+                                                                          jint toneMapper) {
+  try {
+    PreferredColorConfig preferredColorConfig;
+    ScaleMode scaleMode;
+    if (!checkDecodePreconditions(env, javaColorSpace, &preferredColorConfig, javaScaleMode,
+                                  &scaleMode)) {
+      std::string exception = "Can't retrieve basic values";
+      throwException(env, exception);
+      return static_cast<jobject>(nullptr);
+    }
+    if (left < 0 || top < 0 || width <= 0 || height <= 0) {
+      std::string exception = "Region must have non negative origin and positive size";
+      throwException(env, exception);
+      return static_cast<jobject>(nullptr);
+    }
+
+    ImageRegion region = {
+        .x = static_cast<uint32_t>(left),
+        .y = static_cast<uint32_t>(top),
+        .width = static_cast<uint32_t>(width),
+        .height = static_cast<uint32_t>(height),
+    };
+    auto controller = reinterpret_cast<RegionDecoderController *>(ptr);
+    auto frame = controller->decodeRegion(region,
+                                          static_cast<uint32_t>(std::max(scaledWidth, 0)),
+                                          static_cast<uint32_t>(std::max(scaledHeight, 0)),
+                                          scaleMode,
+                                          scaleQuality,
+                                          toneMapperFromJava(toneMapper));
+
+    return createBitmapFromFrame(env, frame, preferredColorConfig);
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  }
+}
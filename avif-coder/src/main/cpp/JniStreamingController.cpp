@@ -0,0 +1,231 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <jni.h>
+#include "AvifStreamingController.h"
+#include "JniException.h"
+#include "JniBitmap.h"
+#include "JniByteArray.h"
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_createStreamingController(JNIEnv *env,
+                                                                                      jobject thiz,
+                                                                                      jlong expectedSize) {
+  try {
+    auto controller =
+        new AvifStreamingController(static_cast<uint64_t>(std::max(expectedSize, (jlong) 0)));
+    return reinterpret_cast<jlong>(controller);
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jlong>(-1);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jlong>(-1);
+  }
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_destroy(JNIEnv *env,
+                                                                    jobject thiz,
+                                                                    jlong ptr) {
+  auto controller = reinterpret_cast<AvifStreamingController *>(ptr);
+  delete controller;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_appendImpl(JNIEnv *env,
+                                                                       jobject thiz,
+                                                                       jlong ptr,
+                                                                       jbyteArray byteArray,
+                                                                       jint offset,
+                                                                       jint length) {
+  try {
+    auto controller = reinterpret_cast<AvifStreamingController *>(ptr);
+    JniByteArray srcBuffer(env, byteArray);
+    if (offset < 0 || length < 0 || static_cast<size_t>(offset) + length > srcBuffer.size()) {
+      std::string exception = "Chunk is out of array bounds";
+      throwException(env, exception);
+      return 0;
+    }
+    return static_cast<jint>(controller->append(srcBuffer.data() + offset,
+                                                static_cast<size_t>(length)));
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return 0;
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return 0;
+  }
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_appendBufferImpl(JNIEnv *env,
+                                                                             jobject thiz,
+                                                                             jlong ptr,
+                                                                             jobject byteBuffer,
+                                                                             jint position,
+                                                                             jint length) {
+  try {
+    auto controller = reinterpret_cast<AvifStreamingController *>(ptr);
+    auto bufferAddress = reinterpret_cast<uint8_t *>(env->GetDirectBufferAddress(byteBuffer));
+    auto capacity = env->GetDirectBufferCapacity(byteBuffer);
+    if (!bufferAddress || capacity <= 0) {
+      std::string errorString = "Only direct byte buffers are supported";
+      throwException(env, errorString);
+      return 0;
+    }
+    if (position < 0 || length < 0 || static_cast<jlong>(position) + length > capacity) {
+      std::string exception = "Chunk is out of buffer bounds";
+      throwException(env, exception);
+      return 0;
+    }
+    return static_cast<jint>(controller->append(bufferAddress + position,
+                                                static_cast<size_t>(length)));
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return 0;
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return 0;
+  }
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_finishImpl(JNIEnv *env,
+                                                                       jobject thiz,
+                                                                       jlong ptr) {
+  try {
+    auto controller = reinterpret_cast<AvifStreamingController *>(ptr);
+    return static_cast<jint>(controller->finish());
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return 0;
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return 0;
+  }
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_getDecodedRowsImpl(JNIEnv *env,
+                                                                               jobject thiz,
+                                                                               jlong ptr) {
+  auto controller = reinterpret_cast<AvifStreamingController *>(ptr);
+  return static_cast<jint>(controller->getDecodedRows());
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_isCompleteImpl(JNIEnv *env,
+                                                                           jobject thiz,
+                                                                           jlong ptr) {
+  auto controller = reinterpret_cast<AvifStreamingController *>(ptr);
+  return static_cast<jboolean>(controller->isComplete());
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_getSizeImpl(JNIEnv *env,
+                                                                        jobject thiz,
+                                                                        jlong ptr) {
+  try {
+    auto controller = reinterpret_cast<AvifStreamingController *>(ptr);
+    if (!controller->isHeaderParsed()) {
+      return static_cast<jobject>(nullptr);
+    }
+    auto size = controller->getImageSize();
+    jclass sizeClass = env->FindClass("android/util/Size");
+    jmethodID methodID = env->GetMethodID(sizeClass, "<init>", "(II)V");
+    auto sizeObject = env->NewObject(sizeClass,
+                                     methodID,
+                                     static_cast<int>(size.width),
+                                     static_cast<int>(size.height));
+    return sizeObject;
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  }
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_radzivon_bartoshyk_avif_coder_AvifStreamingDecoder_getFrameImpl(JNIEnv *env,
+                                                                         jobject thiz,
+                                                                         jlong ptr,
+                                                                         jint scaledWidth,
+                                                                         jint scaledHeight,
+                                                                         jint javaColorSpace,
+                                                                         jint javaScaleMode,
+                                                                         jint scaleQuality,
+                                                                         jint toneMapper) {
+  try {
+    PreferredColorConfig preferredColorConfig;
+    ScaleMode scaleMode;
+    if (!checkDecodePreconditions(env, javaColorSpace, &preferredColorConfig, javaScaleMode,
+                                  &scaleMode)) {
+      std::string exception = "Can't retrieve basic values";
+      throwException(env, exception);
+      return static_cast<jobject>(nullptr);
+    }
+
+    auto controller = reinterpret_cast<AvifStreamingController *>(ptr);
+    if (!controller->isHeaderParsed()) {
+      return static_cast<jobject>(nullptr);
+    }
+    auto frame = controller->getFrame(scaledWidth,
+                                      scaledHeight,
+                                      preferredColorConfig,
+                                      scaleMode,
+                                      scaleQuality,
+                                      toneMapperFromJava(toneMapper));
+    return createBitmapFromFrame(env, frame, preferredColorConfig);
+  } catch (std::bad_alloc &err) {
+    std::string exception = "Not enough memory to decode this image";
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  } catch (std::runtime_error &err) {
+    std::string exception(err.what());
+    throwException(env, exception);
+    return static_cast<jobject>(nullptr);
+  }
+}
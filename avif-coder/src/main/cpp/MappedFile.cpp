@@ -0,0 +1,76 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+MappedFile::MappedFile(int fd) {
+  struct stat fileStat = {};
+  if (fstat(fd, &fileStat) != 0) {
+    std::string str = "Can't stat file: " + std::string(strerror(errno));
+    throw std::runtime_error(str);
+  }
+  if (!S_ISREG(fileStat.st_mode)) {
+    throw std::runtime_error("Only regular files can be decoded from a file descriptor");
+  }
+  if (fileStat.st_size <= 0) {
+    throw std::runtime_error("File is empty");
+  }
+  length = static_cast<size_t>(fileStat.st_size);
+  void *ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (ptr == MAP_FAILED) {
+    length = 0;
+    std::string str = "Can't map file: " + std::string(strerror(errno));
+    throw std::runtime_error(str);
+  }
+  mapping = reinterpret_cast<uint8_t *>(ptr);
+}
+
+MappedFile::~MappedFile() {
+  if (mapping) {
+    munmap(mapping, length);
+    mapping = nullptr;
+  }
+}
+
+void MappedFile::willNeed(size_t offset, size_t size) const {
+  if (offset >= length || size == 0) {
+    return;
+  }
+  static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t end = std::min(offset + size, length);
+  size_t alignedStart = offset - offset % pageSize;
+  madvise(mapping + alignedStart, end - alignedStart, MADV_WILLNEED);
+}
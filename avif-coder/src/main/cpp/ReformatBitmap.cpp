@@ -259,4 +259,111 @@ ReformatColorConfig(JNIEnv *env, aligned_uint8_vector &imageData, string &imageC
       break;
   }
 }
-}
\ No newline at end of file
+
+uint32_t ColorConfigRowBytes(PreferredColorConfig config, uint32_t width) {
+  switch (config) {
+    case Rgba_8888:
+    case Rgba_1010102:
+      return width * 4;
+    case Rgba_F16:
+      return width * 4 * sizeof(uint16_t);
+    case Rgb_565:
+      return width * sizeof(uint16_t);
+    default:
+      throw std::runtime_error("Color config is not supported for writing into a buffer");
+  }
+}
+
+FrameTarget AcquireFrameTarget(const FrameTargetProvider &provider, AvifImageFrame &frame) {
+  if (provider) {
+    FrameTarget target = provider(frame.width, frame.height, frame.storeConfig);
+    if (target.data) {
+      frame.isInTarget = true;
+      return target;
+    }
+  }
+  uint32_t rowBytes = ColorConfigRowBytes(frame.storeConfig, frame.width);
+  frame.store.resize(rowBytes * frame.height);
+  return {frame.store.data(), rowBytes};
+}
+
+void
+ReformatColorConfigInto(aligned_uint8_vector &imageData, uint32_t stride, bool is16Bit,
+                        PreferredColorConfig dstConfig, uint32_t depth,
+                        uint32_t imageWidth, uint32_t imageHeight,
+                        uint8_t *dst, uint32_t dstStride,
+                        bool alphaPremultiplied, bool doesImageHasAlpha) {
+  if (!alphaPremultiplied && doesImageHasAlpha) {
+    if (!is16Bit) {
+      coder::AssociateAlphaRgba8(imageData.data(), stride,
+                                 imageData.data(), stride,
+                                 imageWidth,
+                                 imageHeight);
+    } else {
+      coder::AssociateAlphaRgba16(reinterpret_cast<uint16_t *>(imageData.data()), stride,
+                                  reinterpret_cast<uint16_t *>(imageData.data()), stride,
+                                  imageWidth,
+                                  imageHeight, depth);
+    }
+  }
+
+  switch (dstConfig) {
+    case Rgba_8888:
+      if (is16Bit) {
+        coder::Rgba16ToRgba8(reinterpret_cast<const uint16_t *>(imageData.data()),
+                             stride, dst, dstStride, imageWidth,
+                             imageHeight, depth);
+      } else {
+        coder::CopyUnaligned(reinterpret_cast<const uint8_t *>(imageData.data()), stride,
+                             dst, dstStride, imageWidth * 4, imageHeight);
+      }
+      break;
+    case Rgba_F16:
+      if (is16Bit) {
+        weave_cvt_rgba16_to_rgba_f16(reinterpret_cast<const uint16_t *>(imageData.data()),
+                                     stride,
+                                     depth,
+                                     reinterpret_cast<uint16_t *>(dst),
+                                     dstStride,
+                                     imageWidth, imageHeight);
+      } else {
+        weave_cvt_rgba8_to_rgba_f16(
+            imageData.data(), stride,
+            reinterpret_cast<uint16_t *>(dst), dstStride,
+            imageWidth, imageHeight);
+      }
+      break;
+    case Rgb_565:
+      if (is16Bit) {
+        coder::Rgba16To565(reinterpret_cast<const uint16_t *>(imageData.data()),
+                           stride,
+                           reinterpret_cast<uint16_t *>(dst), dstStride,
+                           imageWidth, imageHeight, depth);
+      } else {
+        coder::Rgba8To565(imageData.data(), stride,
+                          reinterpret_cast<uint16_t *>(dst), dstStride,
+                          imageWidth, imageHeight,
+                          !alphaPremultiplied);
+      }
+      break;
+    case Rgba_1010102:
+      if (is16Bit) {
+        weave_cvt_rgba16_to_ar30(reinterpret_cast<const uint16_t *>(imageData.data()),
+                                 stride,
+                                 depth,
+                                 dst,
+                                 dstStride,
+                                 imageWidth, imageHeight);
+      } else {
+        weave_cvt_rgba8_to_ar30(reinterpret_cast<const uint8_t *>(imageData.data()),
+                                stride,
+                                dst,
+                                dstStride,
+                                imageWidth, imageHeight);
+      }
+      break;
+    default:
+      throw std::runtime_error("Color config is not supported for writing into a buffer");
+  }
+}
+}
@@ -34,6 +34,7 @@
 #include <string>
 #include "Support.h"
 #include "definitions.h"
+#include "ImageFrame.h"
 
 namespace coder {
 void
@@ -41,6 +42,29 @@ ReformatColorConfig(JNIEnv *env, aligned_uint8_vector &imageData, std::string &i
                     PreferredColorConfig preferredColorConfig, uint32_t depth,
                     uint32_t imageWidth, uint32_t imageHeight, uint32_t *stride, bool *useFloats,
                     jobject *hwBuffer, bool alphaPremultiplied, bool doesImageHasAlpha);
+
+/**
+ * Same conversion as ReformatColorConfig, but final stage writes straight into caller memory
+ * instead of intermediate buffer. Hardware config is not supported here.
+ * Source data is premultiplied in place when required.
+ */
+void
+ReformatColorConfigInto(aligned_uint8_vector &imageData, uint32_t stride, bool is16Bit,
+                        PreferredColorConfig dstConfig, uint32_t depth,
+                        uint32_t imageWidth, uint32_t imageHeight,
+                        uint8_t *dst, uint32_t dstStride,
+                        bool alphaPremultiplied, bool doesImageHasAlpha);
+
+/**
+ * Row size in bytes of the image in the given config
+ */
+uint32_t ColorConfigRowBytes(PreferredColorConfig config, uint32_t width);
+
+/**
+ * Memory for final pixels of the frame in its storeConfig: from provider when it accepts the frame,
+ * otherwise frame store is allocated for them
+ */
+FrameTarget AcquireFrameTarget(const FrameTargetProvider &provider, AvifImageFrame &frame);
 }
 
 #endif //AVIF_REFORMATBITMAP_H
@@ -0,0 +1,273 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "RegionDecoderController.h"
+#include <algorithm>
+#include <string>
+#include "ImageTypeSniffer.h"
+#include "imagebits/CopyUnalignedRGBA.h"
+
+// Tile side in source pixels, every level renders the same source square at lower resolution
+static constexpr uint32_t kTileSize = 1024;
+// Coarsest level renders tile as 32x32
+static constexpr uint32_t kMaxLevel = 5;
+// Margin in level pixels tiles above level 0 are rendered with, Lanczos 3 reaches three of them
+static constexpr uint32_t kTileMargin = 4;
+
+static uint64_t TileKey(uint32_t level, int scalingQuality, CurveToneMapper toneMapper,
+                        uint32_t column, uint32_t row) {
+  return (static_cast<uint64_t>(level) << 56)
+      | (static_cast<uint64_t>(scalingQuality & 0xf) << 52)
+      | (static_cast<uint64_t>(toneMapper & 0xf) << 48)
+      | (static_cast<uint64_t>(column & 0xffffff) << 24)
+      | static_cast<uint64_t>(row & 0xffffff);
+}
+
+static uint32_t CeilShift(uint32_t value, uint32_t shift) {
+  return static_cast<uint32_t>((static_cast<uint64_t>(value) + (1u << shift) - 1) >> shift);
+}
+
+RegionDecoderController::RegionDecoderController(const uint8_t *data, size_t size,
+                                                 size_t cacheBytes) : cacheBytes(cacheBytes) {
+  this->buffer.resize(size);
+  std::copy(data, data + size, this->buffer.begin());
+  this->data = this->buffer.data();
+  this->size = this->buffer.size();
+  this->open();
+}
+
+RegionDecoderController::RegionDecoderController(std::shared_ptr<MappedFile> file,
+                                                 size_t cacheBytes)
+    : mappedFile(std::move(file)), cacheBytes(cacheBytes) {
+  this->data = this->mappedFile->data();
+  this->size = this->mappedFile->size();
+  this->open();
+}
+
+void RegionDecoderController::open() {
+  SniffedImageType imageType = SniffImageType(this->data, this->size);
+  if (imageType.isAvif() || !imageType.isSupported()) {
+    avifController = std::make_unique<AvifDecoderController>();
+    // Tiles are stitched and resampled after conversion, they have to stay in RGBA
+    avifController->setAllowFusedConversion(false);
+    if (mappedFile) {
+      avifController->attachFile(mappedFile);
+    } else {
+      avifController->borrowBuffer(this->data, static_cast<uint32_t>(this->size));
+    }
+    imageSize = avifController->getImageSize();
+  } else {
+    heifDecoder = std::make_unique<HeifImageDecoder>();
+    heifDecoder->setRetainDecodedImage(true);
+    imageSize = heifDecoder->getImageSize(this->data, this->size);
+  }
+  if (imageSize.width == 0 || imageSize.height == 0) {
+    throw std::runtime_error("Image has no pixels to decode");
+  }
+}
+
+AvifImageSize RegionDecoderController::getImageSize() {
+  std::lock_guard guard(this->mutex);
+  return imageSize;
+}
+
+AvifImageFrame RegionDecoderController::renderTile(const ImageRegion &tileRegion,
+                                                   uint32_t tileWidth,
+                                                   uint32_t tileHeight,
+                                                   int scalingQuality,
+                                                   CurveToneMapper toneMapper) {
+  if (avifController) {
+    return avifController->getFrame(0, tileWidth, tileHeight, Default, Resize,
+                                    scalingQuality, &tileRegion, toneMapper);
+  }
+  return heifDecoder->getFrame(this->data, this->size, tileWidth, tileHeight, Default, Resize,
+                               scalingQuality, &tileRegion, toneMapper);
+}
+
+const AvifImageFrame &RegionDecoderController::getTile(uint32_t level,
+                                                       uint32_t column,
+                                                       uint32_t row,
+                                                       int scalingQuality,
+                                                       CurveToneMapper toneMapper) {
+  uint64_t key = TileKey(level, scalingQuality, toneMapper, column, row);
+  auto cached = tilesIndex.find(key);
+  if (cached != tilesIndex.end()) {
+    tiles.splice(tiles.begin(), tiles, cached->second);
+    return tiles.front().frame;
+  }
+
+  ImageRegion tileRegion = {
+      .x = column * kTileSize,
+      .y = row * kTileSize,
+      .width = std::min(kTileSize, imageSize.width - column * kTileSize),
+      .height = std::min(kTileSize, imageSize.height - row * kTileSize),
+  };
+  uint32_t tileWidth = CeilShift(tileRegion.width, level);
+  uint32_t tileHeight = CeilShift(tileRegion.height, level);
+
+  // Above level 0 each tile is resampled on its own. It is rendered with a margin covering filter
+  // support that is cut off afterwards, so pixels along tile edges see their neighbours as they
+  // would in one image and stitched tiles show no seams. Margin keeps level pixels aligned.
+  uint32_t margin = level > 0 ? kTileMargin << level : 0;
+  ImageRegion renderRegion = {
+      .x = tileRegion.x - std::min(tileRegion.x, margin),
+      .y = tileRegion.y - std::min(tileRegion.y, margin),
+  };
+  renderRegion.width = std::min(tileRegion.x + tileRegion.width + margin, imageSize.width)
+      - renderRegion.x;
+  renderRegion.height = std::min(tileRegion.y + tileRegion.height + margin, imageSize.height)
+      - renderRegion.y;
+  uint32_t renderWidth = CeilShift(renderRegion.width, level);
+  uint32_t renderHeight = CeilShift(renderRegion.height, level);
+
+  AvifImageFrame frame = renderTile(renderRegion, renderWidth, renderHeight, scalingQuality,
+                                  toneMapper);
+  if (frame.width != renderWidth || frame.height != renderHeight
+      || frame.storeConfig != Default) {
+    throw std::runtime_error("Decoded tile doesn't match requested layout");
+  }
+  if (renderWidth != tileWidth || renderHeight != tileHeight) {
+    uint32_t pixelSize = 4 * (frame.is16Bit ? sizeof(uint16_t) : sizeof(uint8_t));
+    uint32_t renderStride = renderWidth * pixelSize;
+    uint32_t tileStride = tileWidth * pixelSize;
+    const uint8_t *origin = frame.store.data()
+        + ((tileRegion.y - renderRegion.y) >> level) * renderStride
+        + ((tileRegion.x - renderRegion.x) >> level) * pixelSize;
+    aligned_uint8_vector tileStore(tileStride * tileHeight);
+    coder::CopyUnaligned(origin, renderStride, tileStore.data(), tileStride,
+                         tileStride, tileHeight);
+    frame.store = std::move(tileStore);
+    frame.width = tileWidth;
+    frame.height = tileHeight;
+  }
+
+  cachedBytes += frame.store.size();
+  tiles.push_front({.key = key, .frame = std::move(frame)});
+  tilesIndex[key] = tiles.begin();
+
+  // Just rendered tile always survives, even when it alone exceeds the budget
+  while (cachedBytes > cacheBytes && tiles.size() > 1) {
+    auto &last = tiles.back();
+    cachedBytes -= last.frame.store.size();
+    tilesIndex.erase(last.key);
+    tiles.pop_back();
+  }
+  return tiles.front().frame;
+}
+
+AvifImageFrame RegionDecoderController::decodeRegion(const ImageRegion &region,
+                                                     uint32_t scaledWidth,
+                                                     uint32_t scaledHeight,
+                                                     ScaleMode scaleMode,
+                                                     int scalingQuality,
+                                                     CurveToneMapper toneMapper) {
+  std::lock_guard guard(this->mutex);
+  if (region.width == 0 || region.height == 0
+      || region.x >= imageSize.width || region.y >= imageSize.height
+      || region.width > imageSize.width - region.x
+      || region.height > imageSize.height - region.y) {
+    std::string str = "Region " + std::to_string(region.x) + "," + std::to_string(region.y)
+        + " " + std::to_string(region.width) + "x" + std::to_string(region.height)
+        + " is out of image bounds " + std::to_string(imageSize.width) + "x"
+        + std::to_string(imageSize.height);
+    throw std::runtime_error(str);
+  }
+
+  // The coarsest level still at least as big as the target, final resampler does the rest
+  ScaledGeometry geometry = ResolveScaledGeometry(region.width, region.height,
+                                                  scaledWidth, scaledHeight, scaleMode);
+  uint32_t level = 0;
+  while (level < kMaxLevel
+      && (region.width >> (level + 1)) >= geometry.resampledWidth
+      && (region.height >> (level + 1)) >= geometry.resampledHeight) {
+    ++level;
+  }
+
+  uint32_t levelTileSize = kTileSize >> level;
+  uint32_t left = region.x >> level;
+  uint32_t top = region.y >> level;
+  uint32_t right = CeilShift(region.x + region.width, level);
+  uint32_t bottom = CeilShift(region.y + region.height, level);
+  uint32_t stitchedWidth = right - left;
+  uint32_t stitchedHeight = bottom - top;
+
+  aligned_uint8_vector stitched;
+  uint32_t stitchedStride = 0;
+  uint32_t pixelSize = 0;
+  AvifImageFrame regionFrame = {};
+
+  for (uint32_t row = top / levelTileSize; row <= (bottom - 1) / levelTileSize; ++row) {
+    for (uint32_t column = left / levelTileSize; column <= (right - 1) / levelTileSize;
+         ++column) {
+      const AvifImageFrame &tile = getTile(level, column, row, scalingQuality,
+                                               toneMapper);
+      if (stitched.empty()) {
+        pixelSize = 4 * (tile.is16Bit ? sizeof(uint16_t) : sizeof(uint8_t));
+        stitchedStride = stitchedWidth * pixelSize;
+        stitched.resize(stitchedStride * stitchedHeight);
+        regionFrame.is16Bit = tile.is16Bit;
+        regionFrame.bitDepth = tile.bitDepth;
+        regionFrame.hasAlpha = tile.hasAlpha;
+      }
+
+      uint32_t tileLeft = column * levelTileSize;
+      uint32_t tileTop = row * levelTileSize;
+      uint32_t copyLeft = std::max(left, tileLeft);
+      uint32_t copyTop = std::max(top, tileTop);
+      uint32_t copyRight = std::min(right, tileLeft + tile.width);
+      uint32_t copyBottom = std::min(bottom, tileTop + tile.height);
+      if (copyRight <= copyLeft || copyBottom <= copyTop) {
+        continue;
+      }
+
+      uint32_t tileStride = tile.width * pixelSize;
+      const uint8_t *source = tile.store.data() + (copyTop - tileTop) * tileStride
+          + (copyLeft - tileLeft) * pixelSize;
+      uint8_t *destination = stitched.data() + (copyTop - top) * stitchedStride
+          + (copyLeft - left) * pixelSize;
+      coder::CopyUnaligned(source, tileStride, destination, stitchedStride,
+                           (copyRight - copyLeft) * pixelSize, copyBottom - copyTop);
+    }
+  }
+
+  uint32_t imageWidth = stitchedWidth;
+  uint32_t imageHeight = stitchedHeight;
+  ScaledGeometry stitchedGeometry = ResolveScaledGeometry(stitchedWidth, stitchedHeight,
+                                                          scaledWidth, scaledHeight, scaleMode);
+  if (stitchedGeometry.isCropped || stitchedGeometry.resampledWidth != stitchedWidth
+      || stitchedGeometry.resampledHeight != stitchedHeight) {
+    stitched = ApplyScaledGeometry(stitched.data(), &stitchedStride, regionFrame.bitDepth,
+                                   regionFrame.is16Bit, &imageWidth, &imageHeight,
+                                   stitchedGeometry, scalingQuality, regionFrame.hasAlpha);
+  }
+
+  regionFrame.store = std::move(stitched);
+  regionFrame.width = imageWidth;
+  regionFrame.height = imageHeight;
+  return regionFrame;
+}
@@ -0,0 +1,105 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef AVIF_CODER_SRC_MAIN_CPP_REGIONDECODERCONTROLLER_H_
+#define AVIF_CODER_SRC_MAIN_CPP_REGIONDECODERCONTROLLER_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "AvifDecoderController.h"
+#include "HeifImageDecoder.h"
+#include "ImageFrame.h"
+#include "MappedFile.h"
+#include "SizeScaler.h"
+#include "definitions.h"
+
+/**
+ * Decodes regions of a single AVIF or HEIC image, as BitmapRegionDecoder does.
+ *
+ * Container is parsed once. Grid images decode only the grid items under each tile, other
+ * images are decoded once and kept. Regions are assembled from square tiles converted to RGBA
+ * on demand; tiles live in LRU cache bounded by bytes, so panning converts only newly exposed tiles. Zoomed out regions use tiles of a coarser level,
+ * each level halves the resolution, so overview never converts the image at full size at once.
+ */
+class RegionDecoderController {
+ public:
+  RegionDecoderController(const uint8_t *data, size_t size, size_t cacheBytes);
+  /**
+   * File is memory mapped and kept alive by the controller
+   */
+  RegionDecoderController(std::shared_ptr<MappedFile> file, size_t cacheBytes);
+
+  AvifImageSize getImageSize();
+
+  /**
+   * Decodes region into unpremultiplied RGBA scaled the same way HeifCoder.decodeSampled does.
+   * Tiles are cached per tone mapper, so switching curves does not reuse stale tiles.
+   */
+  AvifImageFrame decodeRegion(const ImageRegion &region,
+                              uint32_t scaledWidth,
+                              uint32_t scaledHeight,
+                              ScaleMode scaleMode,
+                              int scalingQuality,
+                              CurveToneMapper toneMapper = REC2408);
+
+ private:
+  struct CachedTile {
+    uint64_t key;
+    AvifImageFrame frame;
+  };
+
+  void open();
+  const AvifImageFrame &getTile(uint32_t level, uint32_t column, uint32_t row,
+                                int scalingQuality, CurveToneMapper toneMapper);
+  AvifImageFrame renderTile(const ImageRegion &tileRegion,
+                            uint32_t tileWidth,
+                            uint32_t tileHeight,
+                            int scalingQuality,
+                            CurveToneMapper toneMapper);
+
+  aligned_uint8_vector buffer;
+  std::shared_ptr<MappedFile> mappedFile;
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+
+  std::unique_ptr<AvifDecoderController> avifController;
+  std::unique_ptr<HeifImageDecoder> heifDecoder;
+  AvifImageSize imageSize = {0, 0};
+
+  size_t cacheBytes;
+  size_t cachedBytes = 0;
+  // Most recently used tile goes first
+  std::list<CachedTile> tiles;
+  std::unordered_map<uint64_t, std::list<CachedTile>::iterator> tilesIndex;
+  std::mutex mutex;
+};
+
+#endif //AVIF_CODER_SRC_MAIN_CPP_REGIONDECODERCONTROLLER_H_
@@ -35,6 +35,258 @@
 #include "JniException.h"
 #include "definitions.h"
 #include "avifweaver.h"
+#include <libyuv.h>
+#include <algorithm>
+#include <numeric>
+#include "colorspace/VectorF32.h"
+
+/**
+ * Largest power of two box factor that keeps image at least as big as target,
+ * Lanczos keeps twice the target so the final filter still has something to work with.
+ * Below high quality an exact integer ratio is taken whole: box lands right on target
+ * and the cheaper result needs no resampling pass at all.
+ */
+uint32_t PreDecimationFactor(uint32_t width, uint32_t height,
+                             uint32_t dstWidth, uint32_t dstHeight,
+                             int scalingQuality) {
+  // Nearest neighbour touches only target pixels, box would only make it slower
+  if (scalingQuality == ScalingQualityFastest || dstWidth == 0 || dstHeight == 0) {
+    return 1;
+  }
+  if (scalingQuality != ScalingQualityHigh
+      && width % dstWidth == 0 && height % dstHeight == 0) {
+    uint32_t ratio = width / dstWidth;
+    if (ratio >= 2 && ratio <= 256 && height / dstHeight == ratio) {
+      return ratio;
+    }
+  }
+  uint32_t headroom = scalingQuality == ScalingQualityHigh ? 2 : 1;
+  uint32_t factor = 1;
+  while (factor < 256) {
+    uint32_t next = factor * 2;
+    uint32_t nextWidth = (width + next - 1) / next;
+    uint32_t nextHeight = (height + next - 1) / next;
+    if (nextWidth < dstWidth * headroom || nextHeight < dstHeight * headroom) {
+      break;
+    }
+    factor = next;
+  }
+  return factor;
+}
+
+/**
+ * Sums pixels [columnStart, columnEnd) of RGBA row into acc, colors weighted by alpha when asked,
+ * returns the sum of alpha
+ */
+template<typename T>
+static inline float AccumulateBlockRow(const T *srcRow, uint32_t columnStart, uint32_t columnEnd,
+                                       float *acc, bool weightByAlpha) {
+  float alphaSum = 0;
+#if HAVE_VECTOR_F32
+  using namespace coder::simd;
+  // A pixel is exactly one vector, so the whole block row stays in a register
+  F32x4 sum = Load(acc);
+  if (weightByAlpha) {
+    for (uint32_t column = columnStart; column < columnEnd; ++column) {
+      const T *px = srcRow + column * 4;
+      float alpha = px[3];
+      sum = MulAdd(Load(px), Splat(alpha), sum);
+      alphaSum += alpha;
+    }
+  } else {
+    for (uint32_t column = columnStart; column < columnEnd; ++column) {
+      const T *px = srcRow + column * 4;
+      sum = Add(sum, Load(px));
+      alphaSum += static_cast<float>(px[3]);
+    }
+  }
+  Store(acc, sum);
+#else
+  for (uint32_t column = columnStart; column < columnEnd; ++column) {
+    const T *px = srcRow + column * 4;
+    float alpha = px[3];
+    float weight = weightByAlpha ? alpha : 1.f;
+    acc[0] += static_cast<float>(px[0]) * weight;
+    acc[1] += static_cast<float>(px[1]) * weight;
+    acc[2] += static_cast<float>(px[2]) * weight;
+    alphaSum += alpha;
+  }
+#endif
+  return alphaSum;
+}
+
+/**
+ * Averages factor x factor blocks, blocks on the right and bottom edge may be partial.
+ * With alpha, colors are weighted by alpha as premultiplied averaging does and stored back
+ * unpremultiplied, so the following resampler sees the same image it would have otherwise.
+ * Sums are kept in float lanes, every source pixel is one vector multiply-add.
+ */
+template<typename T>
+static void BoxDecimateRgba(const T *src, uint32_t srcStride,
+                            uint32_t width, uint32_t height,
+                            T *dst, uint32_t dstStride,
+                            uint32_t factor, bool weightByAlpha) {
+  uint32_t dstWidth = (width + factor - 1) / factor;
+  uint32_t dstHeight = (height + factor - 1) / factor;
+  std::vector<float> accumulator(dstWidth * 4);
+  std::vector<float> alphaSums(dstWidth);
+
+  for (uint32_t y = 0; y < dstHeight; ++y) {
+    std::fill(accumulator.begin(), accumulator.end(), 0.f);
+    std::fill(alphaSums.begin(), alphaSums.end(), 0.f);
+    uint32_t rowStart = y * factor;
+    uint32_t rowEnd = std::min(rowStart + factor, height);
+    for (uint32_t row = rowStart; row < rowEnd; ++row) {
+      const T *srcRow = src + row * srcStride;
+      for (uint32_t x = 0; x < dstWidth; ++x) {
+        uint32_t columnStart = x * factor;
+        uint32_t columnEnd = std::min(columnStart + factor, width);
+        alphaSums[x] += AccumulateBlockRow(srcRow, columnStart, columnEnd,
+                                           accumulator.data() + x * 4, weightByAlpha);
+      }
+    }
+
+    T *dstRow = dst + y * dstStride;
+    uint32_t blockRows = rowEnd - rowStart;
+    for (uint32_t x = 0; x < dstWidth; ++x) {
+      const float *acc = accumulator.data() + x * 4;
+      uint32_t columns = std::min(x * factor + factor, width) - x * factor;
+      float count = static_cast<float>(columns * blockRows);
+      float alphaSum = alphaSums[x];
+      T *px = dstRow + x * 4;
+      px[3] = static_cast<T>(alphaSum / count + 0.5f);
+      float divisor = weightByAlpha ? alphaSum : count;
+      if (divisor == 0) {
+        // Fully transparent block, color doesn't matter
+        px[0] = px[1] = px[2] = 0;
+      } else {
+        float scale = 1.f / divisor;
+        px[0] = static_cast<T>(acc[0] * scale + 0.5f);
+        px[1] = static_cast<T>(acc[1] * scale + 0.5f);
+        px[2] = static_cast<T>(acc[2] * scale + 0.5f);
+      }
+    }
+  }
+}
+
+void BoxDecimateRgbaImage(const uint8_t *source, uint32_t sourceStride,
+                          uint32_t width, uint32_t height,
+                          uint8_t *destination, uint32_t dstStride,
+                          uint32_t factor, uint32_t bitDepth, bool isRgba) {
+  if (bitDepth == 8) {
+    BoxDecimateRgba(source, sourceStride, width, height, destination, dstStride, factor, isRgba);
+  } else {
+    BoxDecimateRgba(reinterpret_cast<const uint16_t *>(source),
+                    sourceStride / static_cast<uint32_t>(sizeof(uint16_t)),
+                    width, height,
+                    reinterpret_cast<uint16_t *>(destination),
+                    dstStride / static_cast<uint32_t>(sizeof(uint16_t)),
+                    factor, isRgba);
+  }
+}
+
+/**
+ * Method of weave_scale functions for ScalingQuality level, Lanczos 3 is method 3 there
+ */
+static uint32_t WeaveScaleMethod(int scalingQuality) {
+  switch (scalingQuality) {
+    case ScalingQualityFastest: return 1;
+    case ScalingQualityHigh: return 3;
+    default: return 0;
+  }
+}
+
+/**
+ * Box decimates RGBA by factor. libyuv box is taken for opaque 8-bit only when factor divides
+ * the size: otherwise it spreads the remainder over the whole image, and block averages would
+ * no longer be aligned to the image origin as parts of the image decimated alone expect.
+ */
+static void DecimateRgba(const uint8_t *source, uint32_t sourceStride,
+                         uint32_t width, uint32_t height,
+                         uint8_t *destination, uint32_t dstStride,
+                         uint32_t factor, uint32_t bitDepth, bool isRgba) {
+  if (bitDepth == 8 && !isRgba && width % factor == 0 && height % factor == 0) {
+    libyuv::ARGBScale(source, static_cast<int>(sourceStride),
+                      static_cast<int>(width), static_cast<int>(height),
+                      destination, static_cast<int>(dstStride),
+                      static_cast<int>(width / factor), static_cast<int>(height / factor),
+                      libyuv::kFilterBox);
+    return;
+  }
+  BoxDecimateRgbaImage(source, sourceStride, width, height,
+                       destination, dstStride, factor, bitDepth, isRgba);
+}
+
+/**
+ * Resamples RGBA into tightly packed destination with the filter of scaling quality
+ */
+static void ScaleRgba(const uint8_t *source, uint32_t sourceStride,
+                      uint32_t width, uint32_t height,
+                      uint8_t *destination, uint32_t dstWidth, uint32_t dstHeight,
+                      uint32_t bitDepth, int scalingQuality, bool isRgba) {
+  if (bitDepth == 8) {
+    weave_scale_u8(source,
+                   sourceStride,
+                   width,
+                   height,
+                   destination,
+                   dstWidth * 4,
+                   dstWidth,
+                   dstHeight,
+                   WeaveScaleMethod(scalingQuality),
+                   isRgba);
+  } else {
+    weave_scale_u16(reinterpret_cast<const uint16_t *>(source),
+                    sourceStride,
+                    width,
+                    height,
+                    reinterpret_cast<uint16_t *>(destination),
+                    dstWidth,
+                    dstHeight,
+                    bitDepth,
+                    WeaveScaleMethod(scalingQuality),
+                    isRgba);
+  }
+}
+
+/**
+ * Part of one axis taken for a crop: source pixels [start, end) resample exactly onto
+ * resampled pixels [outStart, outStart + outSize)
+ */
+struct AxisFootprint {
+  uint32_t start;
+  uint32_t end;
+  uint32_t outStart;
+  uint32_t outSize;
+};
+
+/**
+ * Smallest source range around the crop that resamples with the same ratio and the same sample
+ * positions as the whole axis does. It starts and ends where source and resampled pixel edges
+ * meet, that is on multiples of size / gcd, and keeps Lanczos 3 support around the crop,
+ * so cropped pixels never see the clamped edges of the range.
+ */
+static AxisFootprint ResolveAxisFootprint(uint32_t cropStart, uint32_t cropSize,
+                                          uint32_t source, uint32_t resampled) {
+  uint32_t divisor = std::gcd(source, resampled);
+  uint64_t sourcePeriod = source / divisor;
+  uint64_t resampledPeriod = resampled / divisor;
+  // Support widens by the ratio when downscaling
+  uint64_t margin = 3 * std::max<uint64_t>((source + resampled - 1) / resampled, 1) + 1;
+  uint64_t needStart = static_cast<uint64_t>(cropStart) * source / resampled;
+  uint64_t needEnd = ((static_cast<uint64_t>(cropStart) + cropSize) * source + resampled - 1)
+      / resampled;
+  needStart = needStart > margin ? needStart - margin : 0;
+  needEnd = std::min(needEnd + margin, static_cast<uint64_t>(source));
+  uint64_t firstPeriod = needStart / sourcePeriod;
+  uint64_t lastPeriod = (needEnd + sourcePeriod - 1) / sourcePeriod;
+  return {
+      .start = static_cast<uint32_t>(firstPeriod * sourcePeriod),
+      .end = static_cast<uint32_t>(lastPeriod * sourcePeriod),
+      .outStart = static_cast<uint32_t>(firstPeriod * resampledPeriod),
+      .outSize = static_cast<uint32_t>((lastPeriod - firstPeriod) * resampledPeriod),
+  };
+}
 
 bool RescaleImage(aligned_uint8_vector &initialData,
                   std::shared_ptr<heif_image_handle> &handle,
@@ -93,100 +345,28 @@ bool RescaleImage(aligned_uint8_vector &initialData,
       throw std::runtime_error(exception);
     }
 
-    aligned_uint8_vector outData;
+    bool isCropped = xTranslation > 0 || yTranslation > 0;
+    ScaledGeometry geometry = {
+        .resampledWidth = static_cast<uint32_t>(scaledWidth),
+        .resampledHeight = static_cast<uint32_t>(scaledHeight),
+        .isCropped = isCropped,
+        .cropX = static_cast<uint32_t>(xTranslation),
+        .cropY = static_cast<uint32_t>(yTranslation),
+        .cropWidth = static_cast<uint32_t>(isCropped ? canvasWidth : scaledWidth),
+        .cropHeight = static_cast<uint32_t>(isCropped ? canvasHeight : scaledHeight),
+    };
 
     auto bitDepth = heif_image_handle_get_chroma_bits_per_pixel(handle.get());
-    if (bitDepth == 8) {
-      outData.resize(scaledHeight * scaledWidth * 4);
-      weave_scale_u8(imagePlane,
-                     outStride,
-                     imageWidth,
-                     imageHeight,
-                     outData.data(),
-                     scaledWidth * 4,
-                     scaledWidth,
-                     scaledHeight,
-                     scalingQuality,
-                     isRgba
-      );
-    } else {
-      outData.resize(scaledHeight * scaledWidth * 4 * sizeof(uint16_t));
-      weave_scale_u16(reinterpret_cast<const uint16_t *>(imagePlane),
-                      outStride,
-                      imageWidth,
-                      imageHeight,
-                      reinterpret_cast<uint16_t *>(outData.data()),
-                      scaledWidth,
-                      scaledHeight,
-                      bitDepth,
-                      scalingQuality,
-                      isRgba);
-    }
-
-    auto data = outData.data();
-
-    *stride = static_cast<int >(scaledWidth) * 4
-        * static_cast<int>(useFloats ? sizeof(uint16_t) : sizeof(uint8_t));
-
-    imageWidth = scaledWidth;
-    imageHeight = scaledHeight;
-
-    if (xTranslation > 0 || yTranslation > 0) {
-
-      int left = std::max(xTranslation, 0);
-      int right = xTranslation + canvasWidth;
-      int top = std::max(yTranslation, 0);
-      int bottom = yTranslation + canvasHeight;
-
-      int croppedWidth = right - left;
-      int croppedHeight = bottom - top;
-      int newStride =
-          croppedWidth * 4 * (int) (useFloats ? sizeof(uint16_t) : sizeof(uint8_t));
-      int srcStride = *stride;
-
-      aligned_uint8_vector croppedImage(newStride * croppedHeight);
-
-      uint8_t *dstData = croppedImage.data();
-      auto srcData = reinterpret_cast<const uint8_t *>(data);
-
-      for (int y = top, yc = 0; y < bottom; ++y, ++yc) {
-        int x = 0;
-        int xc = 0;
-        auto srcRow = reinterpret_cast<const uint8_t *>(srcData + srcStride * y);
-        auto dstRow = reinterpret_cast<uint8_t *>(dstData + newStride * yc);
-        for (x = left, xc = 0; x < right; ++x, ++xc) {
-          if (useFloats) {
-            auto dst = reinterpret_cast<uint64_t *>(dstRow);
-            auto src = reinterpret_cast<const uint64_t *>(srcRow);
-            dst[xc] = src[x];
-          } else {
-            auto dst = reinterpret_cast<uint32_t *>(dstRow);
-            auto src = reinterpret_cast<const uint32_t *>(srcRow);
-            dst[xc] = src[x];
-          }
-        }
-      }
-
-      imageWidth = croppedWidth;
-      imageHeight = croppedHeight;
-
-      initialData = croppedImage;
-      *stride = newStride;
-
-    } else {
-      initialData.resize(*stride * imageHeight);
-      if (useFloats) {
-        coder::CopyUnaligned(reinterpret_cast<const uint16_t *>(data), *stride,
-                             reinterpret_cast<uint16_t *>(initialData.data()), *stride,
-                             imageWidth * 4,
-                             imageHeight);
-      } else {
-        coder::CopyUnaligned(reinterpret_cast<const uint8_t *>(data), *stride,
-                             reinterpret_cast<uint8_t *>(initialData.data()), *stride,
-                             imageWidth * 4,
-                             imageHeight);
-      }
-    }
+    uint32_t planeStride = static_cast<uint32_t>(outStride);
+    uint32_t planeWidth = static_cast<uint32_t>(imageWidth);
+    uint32_t planeHeight = static_cast<uint32_t>(imageHeight);
+    initialData = ApplyScaledGeometry(imagePlane, &planeStride,
+                                      static_cast<uint32_t>(bitDepth), useFloats,
+                                      &planeWidth, &planeHeight, geometry,
+                                      scalingQuality, isRgba);
+    *stride = static_cast<int>(planeStride);
+    imageWidth = static_cast<int>(planeWidth);
+    imageHeight = static_cast<int>(planeHeight);
 
     *imageWidthPtr = imageWidth;
     *imageHeightPtr = imageHeight;
@@ -225,6 +405,63 @@ bool RescaleImage(aligned_uint8_vector &initialData,
   return true;
 }
 
+ScaledGeometry ResolveScaledGeometry(uint32_t imageWidth,
+                                     uint32_t imageHeight,
+                                     uint32_t scaledWidth,
+                                     uint32_t scaledHeight,
+                                     ScaleMode scaleMode) {
+  ScaledGeometry geometry = {
+      .resampledWidth = imageWidth,
+      .resampledHeight = imageHeight,
+      .isCropped = false,
+      .cropX = 0,
+      .cropY = 0,
+      .cropWidth = imageWidth,
+      .cropHeight = imageHeight,
+  };
+  if (scaledWidth == 0 || scaledHeight == 0) {
+    return geometry;
+  }
+
+  int xTranslation = 0, yTranslation = 0;
+  uint32_t canvasWidth = scaledWidth;
+  uint32_t canvasHeight = scaledHeight;
+
+  if (scaleMode == Fit || scaleMode == Fill) {
+    std::pair<uint32_t, uint32_t> currentSize(imageWidth, imageHeight);
+    std::pair<uint32_t, uint32_t> canvasSize(scaledWidth, scaledHeight);
+    std::pair<uint32_t, uint32_t> dstSize;
+    float scale = 1;
+    if (scaleMode == Fill) {
+      dstSize = ResizeAspectFill(currentSize, canvasSize, &scale);
+    } else {
+      dstSize = ResizeAspectFit(currentSize, canvasSize, &scale);
+    }
+
+    xTranslation = std::max((int) (((float) dstSize.first - (float) canvasWidth) /
+        2.0f), 0);
+    yTranslation = std::max((int) (((float) dstSize.second - (float) canvasHeight) /
+        2.0f), 0);
+
+    scaledWidth = std::max(dstSize.first, static_cast<uint32_t>(1));
+    scaledHeight = std::max(dstSize.second, static_cast<uint32_t>(1));
+  }
+
+  geometry.resampledWidth = scaledWidth;
+  geometry.resampledHeight = scaledHeight;
+  geometry.cropWidth = scaledWidth;
+  geometry.cropHeight = scaledHeight;
+
+  if (xTranslation > 0 || yTranslation > 0) {
+    geometry.isCropped = true;
+    geometry.cropX = static_cast<uint32_t>(xTranslation);
+    geometry.cropY = static_cast<uint32_t>(yTranslation);
+    geometry.cropWidth = canvasWidth;
+    geometry.cropHeight = canvasHeight;
+  }
+  return geometry;
+}
+
 aligned_uint8_vector RescaleSourceImage(uint8_t *sourceData,
                                         uint32_t *stride,
                                         uint32_t bitDepth,
@@ -236,153 +473,113 @@ aligned_uint8_vector RescaleSourceImage(uint8_t *sourceData,
                                         ScaleMode scaleMode,
                                         int scalingQuality,
                                         bool isRgba) {
+  ScaledGeometry geometry = ResolveScaledGeometry(*imageWidthPtr, *imageHeightPtr,
+                                                  scaledWidth, scaledHeight, scaleMode);
+  return ApplyScaledGeometry(sourceData, stride, bitDepth, isImage64Bits,
+                             imageWidthPtr, imageHeightPtr, geometry,
+                             scalingQuality, isRgba);
+}
+
+aligned_uint8_vector ApplyScaledGeometry(const uint8_t *sourceData,
+                                         uint32_t *stride,
+                                         uint32_t bitDepth,
+                                         bool isImage64Bits,
+                                         uint32_t *imageWidthPtr,
+                                         uint32_t *imageHeightPtr,
+                                         const ScaledGeometry &geometry,
+                                         int scalingQuality,
+                                         bool isRgba) {
   uint32_t imageWidth = *imageWidthPtr;
   uint32_t imageHeight = *imageHeightPtr;
-  if ((scaledHeight != 0 || scaledWidth != 0) && (scaledWidth != 0 && scaledHeight != 0)) {
+  uint32_t pixelSize = 4 * (isImage64Bits ? sizeof(uint16_t) : sizeof(uint8_t));
+
+  uint32_t resampledWidth = std::max(geometry.resampledWidth, static_cast<uint32_t>(1));
+  uint32_t resampledHeight = std::max(geometry.resampledHeight, static_cast<uint32_t>(1));
+
+  uint32_t cropX = 0, cropY = 0;
+  uint32_t cropWidth = resampledWidth, cropHeight = resampledHeight;
+  if (geometry.isCropped) {
+    cropX = std::min(geometry.cropX, resampledWidth - 1);
+    cropY = std::min(geometry.cropY, resampledHeight - 1);
+    cropWidth = std::max(std::min(geometry.cropWidth, resampledWidth - cropX),
+                         static_cast<uint32_t>(1));
+    cropHeight = std::max(std::min(geometry.cropHeight, resampledHeight - cropY),
+                          static_cast<uint32_t>(1));
+  }
 
-    int xTranslation = 0, yTranslation = 0;
-    uint32_t canvasWidth = scaledWidth;
-    uint32_t canvasHeight = scaledHeight;
+  uint32_t newStride = cropWidth * pixelSize;
+  aligned_uint8_vector dataStore(newStride * cropHeight);
 
-    if (scaleMode == Fit || scaleMode == Fill) {
-      std::pair<uint32_t, uint32_t> currentSize(imageWidth, imageHeight);
-      if (scaledHeight > 0 && scaledWidth < 0) {
-        auto newBounds = ResizeAspectHeight(currentSize, scaledHeight,
-                                            scaledWidth == -2);
-        scaledWidth = std::max(newBounds.first, static_cast<uint32_t>(1));
-        scaledHeight = std::max(newBounds.second, static_cast<uint32_t>(1));
-      } else if (scaledHeight < 0) {
-        auto newBounds = ResizeAspectWidth(currentSize, scaledHeight,
-                                           scaledHeight == -2);
-        scaledWidth = std::max(newBounds.first, static_cast<uint32_t>(1));
-        scaledHeight = std::max(newBounds.second, static_cast<uint32_t>(1));
+  // Image may already come at resampled size, e.g. when planes were scaled before conversion,
+  // then only cropping is left
+  if (resampledWidth == imageWidth && resampledHeight == imageHeight) {
+    const uint8_t *origin = sourceData + cropY * (*stride) + cropX * pixelSize;
+    coder::CopyUnaligned(origin, *stride, dataStore.data(), newStride,
+                         cropWidth * pixelSize, cropHeight);
+  } else {
+    // Only canvas is resampled. Image is box decimated as the whole would be, then the crop is
+    // widened to a footprint on the same sample grid, so the canvas comes out exactly as
+    // resampling everything and cutting it out would give. Source outside is never touched.
+    uint32_t factor = PreDecimationFactor(imageWidth, imageHeight,
+                                          resampledWidth, resampledHeight, scalingQuality);
+    AxisFootprint columns = ResolveAxisFootprint(cropX, cropWidth,
+                                                 (imageWidth + factor - 1) / factor,
+                                                 resampledWidth);
+    AxisFootprint rows = ResolveAxisFootprint(cropY, cropHeight,
+                                              (imageHeight + factor - 1) / factor,
+                                              resampledHeight);
+    uint32_t footprintWidth = columns.end - columns.start;
+    uint32_t footprintHeight = rows.end - rows.start;
+    bool needsResampling = footprintWidth != columns.outSize || footprintHeight != rows.outSize;
+    bool isExactCrop = columns.outStart == cropX && columns.outSize == cropWidth
+        && rows.outStart == cropY && rows.outSize == cropHeight;
+
+    const uint8_t *footprint = sourceData + rows.start * factor * (*stride)
+        + columns.start * factor * pixelSize;
+    uint32_t footprintStride = *stride;
+    aligned_uint8_vector decimated;
+    if (factor > 1) {
+      uint32_t sourceWidth = std::min(columns.end * factor, imageWidth) - columns.start * factor;
+      uint32_t sourceHeight = std::min(rows.end * factor, imageHeight) - rows.start * factor;
+      if (isExactCrop && !needsResampling) {
+        // Box lands right on the canvas
+        DecimateRgba(footprint, *stride, sourceWidth, sourceHeight,
+                     dataStore.data(), newStride, factor, bitDepth, isRgba);
+        footprint = nullptr;
       } else {
-        std::pair<uint32_t, uint32_t> dstSize;
-        float scale = 1;
-        if (scaleMode == Fill) {
-          std::pair<uint32_t, uint32_t> canvasSize(scaledWidth, scaledHeight);
-          dstSize = ResizeAspectFill(currentSize, canvasSize, &scale);
-        } else {
-          std::pair<uint32_t, uint32_t> canvasSize(scaledWidth, scaledHeight);
-          dstSize = ResizeAspectFit(currentSize, canvasSize, &scale);
-        }
-
-        xTranslation = std::max((int) (((float) dstSize.first - (float) canvasWidth) /
-            2.0f), 0);
-        yTranslation = std::max((int) (((float) dstSize.second - (float) canvasHeight) /
-            2.0f), 0);
-
-        scaledWidth = std::max(dstSize.first, static_cast<uint32_t>(1));
-        scaledHeight = std::max(dstSize.second, static_cast<uint32_t>(1));
+        footprintStride = footprintWidth * pixelSize;
+        decimated.resize(footprintStride * footprintHeight);
+        DecimateRgba(footprint, *stride, sourceWidth, sourceHeight,
+                     decimated.data(), footprintStride, factor, bitDepth, isRgba);
+        footprint = decimated.data();
       }
     }
 
-    aligned_uint8_vector outData;
-
-    if (bitDepth == 8) {
-      outData.resize(scaledHeight * scaledWidth * 4);
-      weave_scale_u8(sourceData,
-                     *stride,
-                     imageWidth,
-                     imageHeight,
-                     outData.data(),
-                     scaledWidth * 4,
-                     scaledWidth,
-                     scaledHeight,
-                     scalingQuality,
-                     isRgba);
-    } else {
-      outData.resize(scaledHeight * scaledWidth * 4 * sizeof(uint16_t));
-      weave_scale_u16(reinterpret_cast<const uint16_t *>(sourceData),
-                      *stride,
-                      imageWidth,
-                      imageHeight,
-                      reinterpret_cast<uint16_t *>(outData.data()),
-                      scaledWidth,
-                      scaledHeight,
-                      bitDepth,
-                      scalingQuality,
-                      isRgba);
-    }
-
-    auto data = outData.data();
-
-    *stride = scaledWidth * 4 * (isImage64Bits ? sizeof(uint16_t) : sizeof(uint8_t));
-
-    imageWidth = scaledWidth;
-    imageHeight = scaledHeight;
-
-    *imageWidthPtr = imageWidth;
-    *imageHeightPtr = imageHeight;
-
-    if (xTranslation > 0 || yTranslation > 0) {
-      int left = std::max(xTranslation, 0);
-      int right = xTranslation + static_cast<int>(canvasWidth);
-      int top = std::max(yTranslation, 0);
-      int bottom = yTranslation + static_cast<int>(canvasHeight);
-
-      int croppedWidth = right - left;
-      int croppedHeight = bottom - top;
-      uint32_t newStride =
-          croppedWidth * 4 * (int) (isImage64Bits ? sizeof(uint16_t) : sizeof(uint8_t));
-      uint32_t srcStride = *stride;
-
-      aligned_uint8_vector croppedImage(newStride * croppedHeight);
-
-      uint8_t *dstData = croppedImage.data();
-      auto srcData = reinterpret_cast<const uint8_t *>(data);
-
-      for (int y = top, yc = 0; y < bottom; ++y, ++yc) {
-        int x = 0;
-        int xc = 0;
-        auto srcRow = reinterpret_cast<const uint8_t *>(srcData + srcStride * y);
-        auto dstRow = reinterpret_cast<uint8_t *>(dstData + newStride * yc);
-        for (x = left, xc = 0; x < right; ++x, ++xc) {
-          if (isImage64Bits) {
-            auto dst = reinterpret_cast<uint64_t *>(dstRow);
-            auto src = reinterpret_cast<const uint64_t *>(srcRow);
-            dst[xc] = src[x];
-          } else {
-            auto dst = reinterpret_cast<uint32_t *>(dstRow);
-            auto src = reinterpret_cast<const uint32_t *>(srcRow);
-            dst[xc] = src[x];
-          }
-        }
+    if (footprint != nullptr && needsResampling && isExactCrop) {
+      ScaleRgba(footprint, footprintStride, footprintWidth, footprintHeight,
+                dataStore.data(), cropWidth, cropHeight, bitDepth, scalingQuality, isRgba);
+    } else if (footprint != nullptr) {
+      aligned_uint8_vector scaled;
+      uint32_t scaledStride = footprintStride;
+      if (needsResampling) {
+        scaledStride = columns.outSize * pixelSize;
+        scaled.resize(scaledStride * rows.outSize);
+        ScaleRgba(footprint, footprintStride, footprintWidth, footprintHeight,
+                  scaled.data(), columns.outSize, rows.outSize,
+                  bitDepth, scalingQuality, isRgba);
+        footprint = scaled.data();
       }
-
-      imageWidth = croppedWidth;
-      imageHeight = croppedHeight;
-
-      *imageWidthPtr = imageWidth;
-      *imageHeightPtr = imageHeight;
-
-      *stride = newStride;
-      return croppedImage;
-    } else {
-      *imageWidthPtr = imageWidth;
-      *imageHeightPtr = imageHeight;
-      return outData;
+      const uint8_t *origin = footprint + (cropY - rows.outStart) * scaledStride
+          + (cropX - columns.outStart) * pixelSize;
+      coder::CopyUnaligned(origin, scaledStride, dataStore.data(), newStride,
+                           cropWidth * pixelSize, cropHeight);
     }
-  } else {
-    uint32_t newStride = imageWidth * 4 * (isImage64Bits ? sizeof(uint16_t) : sizeof(uint8_t));
-    aligned_uint8_vector dataStore(newStride * imageHeight);
-
-    if (isImage64Bits) {
-      coder::CopyUnaligned(reinterpret_cast<const uint16_t *>(sourceData), *stride,
-                           reinterpret_cast<uint16_t *>(dataStore.data()), newStride,
-                           imageWidth * 4,
-                           imageHeight);
-    } else {
-      coder::CopyUnaligned(reinterpret_cast<const uint8_t *>(sourceData), *stride,
-                           reinterpret_cast<uint8_t *>(dataStore.data()), newStride,
-                           imageWidth * 4,
-                           imageHeight);
-    }
-
-    *imageWidthPtr = imageWidth;
-    *imageHeightPtr = imageHeight;
-    return dataStore;
   }
+
+  *imageWidthPtr = cropWidth;
+  *imageHeightPtr = cropHeight;
+  *stride = newStride;
+  return dataStore;
 }
 
 std::pair<uint32_t, uint32_t>
@@ -40,6 +40,15 @@ enum ScaleMode {
   Resize = 3,
 };
 
+/**
+ * Levels of ScalingQuality from Java
+ */
+enum ScalingQualityLevel {
+  ScalingQualityDefault = 0,
+  ScalingQualityFastest = 1,
+  ScalingQualityHigh = 2,
+};
+
 bool RescaleImage(aligned_uint8_vector &initialData,
                   std::shared_ptr<heif_image_handle> &handle,
                   std::shared_ptr<heif_image> &img,
@@ -49,6 +58,26 @@ bool RescaleImage(aligned_uint8_vector &initialData,
                   int scaledWidth, int scaledHeight, ScaleMode scaleMode, int scalingQuality,
                   bool isRgba);
 
+/**
+ * Geometry RescaleSourceImage applies: image is resampled to the resampled size,
+ * then canvas is cut out of its center when it overflows, as Fill does
+ */
+struct ScaledGeometry {
+  uint32_t resampledWidth;
+  uint32_t resampledHeight;
+  bool isCropped;
+  uint32_t cropX;
+  uint32_t cropY;
+  uint32_t cropWidth;
+  uint32_t cropHeight;
+};
+
+ScaledGeometry ResolveScaledGeometry(uint32_t imageWidth,
+                                     uint32_t imageHeight,
+                                     uint32_t scaledWidth,
+                                     uint32_t scaledHeight,
+                                     ScaleMode scaleMode);
+
 aligned_uint8_vector RescaleSourceImage(uint8_t *data,
                                         uint32_t *stride,
                                         uint32_t bitDepth,
@@ -61,6 +90,37 @@ aligned_uint8_vector RescaleSourceImage(uint8_t *data,
                                         int scalingQuality,
                                         bool isRgba);
 
+/**
+ * Resamples and crops RGBA image by resolved geometry. Only a footprint around the canvas is
+ * resampled, on the same sample grid as the whole image, so the canvas matches resampling
+ * everything and cropping. Resampling is skipped when image already has the resampled size.
+ */
+aligned_uint8_vector ApplyScaledGeometry(const uint8_t *data,
+                                         uint32_t *stride,
+                                         uint32_t bitDepth,
+                                         bool isImage64Bits,
+                                         uint32_t *imageWidthPtr,
+                                         uint32_t *imageHeightPtr,
+                                         const ScaledGeometry &geometry,
+                                         int scalingQuality,
+                                         bool isRgba);
+
+/**
+ * Largest power of two box factor images are decimated by before resampling to the target
+ */
+uint32_t PreDecimationFactor(uint32_t width, uint32_t height,
+                             uint32_t dstWidth, uint32_t dstHeight,
+                             int scalingQuality);
+
+/**
+ * Averages factor x factor blocks of RGBA image, strides are in bytes. Blocks are aligned to
+ * image origin, so tiles aligned to the factor decimate to the same pixels as the whole image.
+ */
+void BoxDecimateRgbaImage(const uint8_t *source, uint32_t sourceStride,
+                          uint32_t width, uint32_t height,
+                          uint8_t *destination, uint32_t dstStride,
+                          uint32_t factor, uint32_t bitDepth, bool isRgba);
+
 std::pair<uint32_t, uint32_t>
 ResizeAspectFit(std::pair<uint32_t, uint32_t> sourceSize,
                 std::pair<uint32_t, uint32_t> dstSize,
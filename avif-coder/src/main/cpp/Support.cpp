@@ -77,4 +77,13 @@ bool checkDecodePreconditions(JNIEnv *env, jint javaColorspace, PreferredColorCo
   *scaleMode = mScaleMode;
   *config = preferredColorConfig;
   return true;
-}
\ No newline at end of file
+}
+
+CurveToneMapper toneMapperFromJava(jint javaToneMapper) {
+  switch (javaToneMapper) {
+    case LOGARITHMIC: return LOGARITHMIC;
+    case FILMIC: return FILMIC;
+    case ACES: return ACES;
+    default: return REC2408;
+  }
+}
@@ -45,4 +45,9 @@ enum PreferredColorConfig {
 bool checkDecodePreconditions(JNIEnv *env, jint javaColorspace, PreferredColorConfig *config,
                               jint javaScaleMode, ScaleMode *scaleMode);
 
+/**
+ * Maps ToneMapper value from Java, unknown values fall back to REC2408
+ */
+CurveToneMapper toneMapperFromJava(jint javaToneMapper);
+
 #endif //AVIF_SUPPORT_H
@@ -0,0 +1,239 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "YuvPlanes.h"
+#include <stdexcept>
+#include <libyuv.h>
+#include <algorithm>
+#include <type_traits>
+
+YuvPackedLayout ComputeYuvPackedLayout(const YuvPlanesView &view, YuvOutputLayout output) {
+  YuvPackedLayout layout = {0};
+  uint32_t sampleSize = view.bitDepth > 8 ? sizeof(uint16_t) : sizeof(uint8_t);
+
+  switch (view.subsampling) {
+    case YUV_SUBSAMPLING_420:
+      layout.chromaWidth = (view.width + 1) / 2;
+      layout.chromaHeight = (view.height + 1) / 2;
+      break;
+    case YUV_SUBSAMPLING_422:
+      layout.chromaWidth = (view.width + 1) / 2;
+      layout.chromaHeight = view.height;
+      break;
+    case YUV_SUBSAMPLING_444:
+      layout.chromaWidth = view.width;
+      layout.chromaHeight = view.height;
+      break;
+    case YUV_SUBSAMPLING_400:
+      layout.chromaWidth = 0;
+      layout.chromaHeight = 0;
+      break;
+  }
+
+  layout.strides[0] = view.width * sampleSize;
+  layout.offsets[0] = 0;
+  size_t lumaSize = static_cast<size_t>(layout.strides[0]) * view.height;
+
+  if (view.subsampling == YUV_SUBSAMPLING_400) {
+    layout.planesCount = 1;
+    layout.size = lumaSize;
+    return layout;
+  }
+
+  if (output == YUV_OUTPUT_SEMI_PLANAR) {
+    if (view.subsampling != YUV_SUBSAMPLING_420) {
+      throw std::runtime_error("Semi-planar output is available only for 4:2:0 images");
+    }
+    layout.planesCount = 2;
+    layout.strides[1] = layout.chromaWidth * 2 * sampleSize;
+    layout.offsets[1] = lumaSize;
+    layout.size = lumaSize + static_cast<size_t>(layout.strides[1]) * layout.chromaHeight;
+    return layout;
+  }
+
+  layout.planesCount = 3;
+  size_t chromaSize = static_cast<size_t>(layout.chromaWidth) * sampleSize * layout.chromaHeight;
+  layout.strides[1] = layout.chromaWidth * sampleSize;
+  layout.strides[2] = layout.chromaWidth * sampleSize;
+  layout.offsets[1] = lumaSize;
+  layout.offsets[2] = lumaSize + chromaSize;
+  layout.size = lumaSize + chromaSize * 2;
+  return layout;
+}
+
+void PackYuvPlanes(const YuvPlanesView &view, YuvOutputLayout output,
+                   const YuvPackedLayout &layout, uint8_t *dst) {
+  bool isHighBitDepth = view.bitDepth > 8;
+
+  if (isHighBitDepth) {
+    libyuv::CopyPlane_16(reinterpret_cast<const uint16_t *>(view.planes[0]),
+                         static_cast<int>(view.rowBytes[0] / sizeof(uint16_t)),
+                         reinterpret_cast<uint16_t *>(dst + layout.offsets[0]),
+                         static_cast<int>(layout.strides[0] / sizeof(uint16_t)),
+                         static_cast<int>(view.width), static_cast<int>(view.height));
+  } else {
+    libyuv::CopyPlane(view.planes[0], static_cast<int>(view.rowBytes[0]),
+                      dst + layout.offsets[0], static_cast<int>(layout.strides[0]),
+                      static_cast<int>(view.width), static_cast<int>(view.height));
+  }
+
+  if (layout.planesCount == 1) {
+    return;
+  }
+
+  auto chromaWidth = static_cast<int>(layout.chromaWidth);
+  auto chromaHeight = static_cast<int>(layout.chromaHeight);
+
+  if (output == YUV_OUTPUT_SEMI_PLANAR) {
+    if (isHighBitDepth) {
+      // P010 keeps significant bits in the high part of each sample
+      libyuv::MergeUVPlane_16(reinterpret_cast<const uint16_t *>(view.planes[1]),
+                              static_cast<int>(view.rowBytes[1] / sizeof(uint16_t)),
+                              reinterpret_cast<const uint16_t *>(view.planes[2]),
+                              static_cast<int>(view.rowBytes[2] / sizeof(uint16_t)),
+                              reinterpret_cast<uint16_t *>(dst + layout.offsets[1]),
+                              static_cast<int>(layout.strides[1] / sizeof(uint16_t)),
+                              chromaWidth, chromaHeight, static_cast<int>(view.bitDepth));
+    } else {
+      libyuv::MergeUVPlane(view.planes[1], static_cast<int>(view.rowBytes[1]),
+                           view.planes[2], static_cast<int>(view.rowBytes[2]),
+                           dst + layout.offsets[1], static_cast<int>(layout.strides[1]),
+                           chromaWidth, chromaHeight);
+    }
+    return;
+  }
+
+  for (int plane = 1; plane < 3; ++plane) {
+    if (isHighBitDepth) {
+      libyuv::CopyPlane_16(reinterpret_cast<const uint16_t *>(view.planes[plane]),
+                           static_cast<int>(view.rowBytes[plane] / sizeof(uint16_t)),
+                           reinterpret_cast<uint16_t *>(dst + layout.offsets[plane]),
+                           static_cast<int>(layout.strides[plane] / sizeof(uint16_t)),
+                           chromaWidth, chromaHeight);
+    } else {
+      libyuv::CopyPlane(view.planes[plane], static_cast<int>(view.rowBytes[plane]),
+                        dst + layout.offsets[plane], static_cast<int>(layout.strides[plane]),
+                        chromaWidth, chromaHeight);
+    }
+  }
+}
+
+bool IsChromaNativeScale(uint32_t width, uint32_t height,
+                         uint32_t resampledWidth, uint32_t resampledHeight) {
+  return width >= 2 && height >= 2
+      && resampledWidth * 2 <= width && resampledHeight * 2 <= height;
+}
+
+template<typename T>
+static void DecimateLumaWithAlpha(const T *luma, uint32_t lumaStride,
+                                  const T *alpha, uint32_t alphaStride,
+                                  T *dstLuma, uint32_t dstLumaStride,
+                                  T *dstAlpha, uint32_t dstAlphaStride,
+                                  uint32_t width, uint32_t height) {
+  using Accumulator = std::conditional_t<sizeof(T) == 1, uint32_t, uint64_t>;
+  uint32_t dstWidth = (width + 1) / 2;
+  uint32_t dstHeight = (height + 1) / 2;
+  for (uint32_t y = 0; y < dstHeight; ++y) {
+    uint32_t y0 = y * 2;
+    uint32_t y1 = std::min(y0 + 1, height - 1);
+    const T *lumaRow0 = luma + y0 * lumaStride;
+    const T *lumaRow1 = luma + y1 * lumaStride;
+    const T *alphaRow0 = alpha + y0 * alphaStride;
+    const T *alphaRow1 = alpha + y1 * alphaStride;
+    T *dstLumaRow = dstLuma + y * dstLumaStride;
+    T *dstAlphaRow = dstAlpha + y * dstAlphaStride;
+    for (uint32_t x = 0; x < dstWidth; ++x) {
+      uint32_t x0 = x * 2;
+      uint32_t x1 = std::min(x0 + 1, width - 1);
+      Accumulator a00 = alphaRow0[x0], a01 = alphaRow0[x1];
+      Accumulator a10 = alphaRow1[x0], a11 = alphaRow1[x1];
+      Accumulator alphaSum = a00 + a01 + a10 + a11;
+      dstAlphaRow[x] = static_cast<T>((alphaSum + 2) >> 2);
+      if (alphaSum == 0) {
+        // Fully transparent block, color doesn't matter
+        dstLumaRow[x] = static_cast<T>((static_cast<Accumulator>(lumaRow0[x0]) + lumaRow0[x1]
+            + lumaRow1[x0] + lumaRow1[x1] + 2) >> 2);
+      } else {
+        Accumulator weighted = lumaRow0[x0] * a00 + lumaRow0[x1] * a01
+            + lumaRow1[x0] * a10 + lumaRow1[x1] * a11;
+        dstLumaRow[x] = static_cast<T>((weighted + alphaSum / 2) / alphaSum);
+      }
+    }
+  }
+}
+
+void DecimateLumaToChroma(const uint8_t *luma, uint32_t lumaRowBytes,
+                          const uint8_t *alpha, uint32_t alphaRowBytes,
+                          uint8_t *dstLuma, uint32_t dstLumaRowBytes,
+                          uint8_t *dstAlpha, uint32_t dstAlphaRowBytes,
+                          uint32_t width, uint32_t height, uint32_t bitDepth) {
+  bool isHighBitDepth = bitDepth > 8;
+  int dstWidth = static_cast<int>((width + 1) / 2);
+  int dstHeight = static_cast<int>((height + 1) / 2);
+
+  if (alpha) {
+    if (!dstAlpha) {
+      throw std::runtime_error("Alpha destination is required to decimate image with alpha");
+    }
+    if (isHighBitDepth) {
+      DecimateLumaWithAlpha(reinterpret_cast<const uint16_t *>(luma),
+                            lumaRowBytes / static_cast<uint32_t>(sizeof(uint16_t)),
+                            reinterpret_cast<const uint16_t *>(alpha),
+                            alphaRowBytes / static_cast<uint32_t>(sizeof(uint16_t)),
+                            reinterpret_cast<uint16_t *>(dstLuma),
+                            dstLumaRowBytes / static_cast<uint32_t>(sizeof(uint16_t)),
+                            reinterpret_cast<uint16_t *>(dstAlpha),
+                            dstAlphaRowBytes / static_cast<uint32_t>(sizeof(uint16_t)),
+                            width, height);
+    } else {
+      DecimateLumaWithAlpha(luma, lumaRowBytes, alpha, alphaRowBytes,
+                            dstLuma, dstLumaRowBytes, dstAlpha, dstAlphaRowBytes,
+                            width, height);
+    }
+    return;
+  }
+
+  // Exact 2:1 box, libyuv has vectorized kernels for it
+  int result;
+  if (isHighBitDepth) {
+    result = libyuv::ScalePlane_16(reinterpret_cast<const uint16_t *>(luma),
+                                   static_cast<int>(lumaRowBytes / sizeof(uint16_t)),
+                                   static_cast<int>(width), static_cast<int>(height),
+                                   reinterpret_cast<uint16_t *>(dstLuma),
+                                   static_cast<int>(dstLumaRowBytes / sizeof(uint16_t)),
+                                   dstWidth, dstHeight, libyuv::kFilterBox);
+  } else {
+    result = libyuv::ScalePlane(luma, static_cast<int>(lumaRowBytes),
+                                static_cast<int>(width), static_cast<int>(height),
+                                dstLuma, static_cast<int>(dstLumaRowBytes),
+                                dstWidth, dstHeight, libyuv::kFilterBox);
+  }
+  if (result != 0) {
+    throw std::runtime_error("Can't decimate luma plane");
+  }
+}
@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef AVIF_CODER_SRC_MAIN_CPP_YUVPLANES_H_
+#define AVIF_CODER_SRC_MAIN_CPP_YUVPLANES_H_
+
+#include <cstdint>
+#include <cstddef>
+
+enum YuvSubsampling {
+  YUV_SUBSAMPLING_420 = 0,
+  YUV_SUBSAMPLING_422 = 1,
+  YUV_SUBSAMPLING_444 = 2,
+  YUV_SUBSAMPLING_400 = 3,
+};
+
+enum YuvOutputLayout {
+  /**
+   * Separate Y, U, V planes: I420, I422, I444, I400 and their high bit depth variants
+   */
+  YUV_OUTPUT_PLANAR = 1,
+  /**
+   * Y plane and interleaved UV plane, NV12 for 8 bit and P010/P016 for deeper 4:2:0 images
+   */
+  YUV_OUTPUT_SEMI_PLANAR = 2,
+};
+
+/**
+ * Borrowed view of decoded planes, samples deeper than 8 bit are stored in 16 bit little endian
+ */
+struct YuvPlanesView {
+  const uint8_t *planes[3];
+  uint32_t rowBytes[3];
+  uint32_t width;
+  uint32_t height;
+  uint32_t bitDepth;
+  YuvSubsampling subsampling;
+  uint32_t colorPrimaries;
+  uint32_t transferCharacteristics;
+  uint32_t matrixCoefficients;
+  bool fullRange;
+};
+
+struct YuvPackedLayout {
+  uint32_t planesCount;
+  size_t offsets[3];
+  uint32_t strides[3];
+  uint32_t chromaWidth;
+  uint32_t chromaHeight;
+  size_t size;
+};
+
+/**
+ * Tightly packed layout of the planes in requested output
+ */
+YuvPackedLayout ComputeYuvPackedLayout(const YuvPlanesView &view, YuvOutputLayout output);
+
+/**
+ * Copies planes into destination described by layout, interleaving chroma for semi-planar output
+ */
+void PackYuvPlanes(const YuvPlanesView &view, YuvOutputLayout output,
+                   const YuvPackedLayout &layout, uint8_t *dst);
+
+/**
+ * Whether 4:2:0 image of the given size resampled down to the resampled size
+ * loses nothing when decoded at chroma resolution
+ */
+bool IsChromaNativeScale(uint32_t width, uint32_t height,
+                         uint32_t resampledWidth, uint32_t resampledHeight);
+
+/**
+ * Averages 2x2 luma blocks so luma matches 4:2:0 chroma and image can be converted
+ * as 4:4:4 at chroma resolution without any chroma upsampling.
+ * When alpha is given, luma is weighted by alpha as resampling premultiplied RGB would do,
+ * and alpha is averaged into dstAlpha. Destination is ((width + 1) / 2, (height + 1) / 2).
+ */
+void DecimateLumaToChroma(const uint8_t *luma, uint32_t lumaRowBytes,
+                          const uint8_t *alpha, uint32_t alphaRowBytes,
+                          uint8_t *dstLuma, uint32_t dstLumaRowBytes,
+                          uint8_t *dstAlpha, uint32_t dstAlphaRowBytes,
+                          uint32_t width, uint32_t height, uint32_t bitDepth);
+
+#endif //AVIF_CODER_SRC_MAIN_CPP_YUVPLANES_H_
@@ -1234,6 +1234,19 @@ typedef struct avifDecoder
     // Strict flags. Defaults to AVIF_STRICT_ENABLED. See avifStrictFlag definitions above.
     avifStrictFlags strictFlags;
 
+    // Part of the image the caller is going to read. When its width and height are nonzero and the color or alpha
+    // image is a grid, the cells that do not intersect it are not decoded and their pixels in decoder->image are left
+    // unspecified. avifDecoderNthImage() decodes the frame again when a region needs cells skipped before.
+    // Ignored when allowIncremental is set. Defaults to all zero, the whole image.
+    avifCropRect regionOfInterest;
+
+    // Smallest size of the still image the caller is going to read. When both are nonzero, avifDecoderReset() picks the
+    // smallest 'thmb' item of the primary item that is at least this large, has the primary item's aspect ratio up to
+    // rounding and has alpha exactly when the primary item has, and decodes it in place of the primary item. Exif and
+    // XMP still come from the primary item. Defaults to zero, the primary item.
+    uint32_t thumbnailMinWidth;
+    uint32_t thumbnailMinHeight;
+
     // --------------------------------------------------------------------------------------------
     // Outputs
 
@@ -11,6 +11,14 @@
 #include <stdio.h>
 #include <string.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#define AVIF_GRID_THREADS 1
+#endif
+
+// Upper bound on the number of codec instances decoding the cells of one grid in parallel.
+#define AVIF_GRID_CODEC_POOL_MAX 8
+
 #define AUXTYPE_SIZE 64
 #define CONTENTTYPE_SIZE 64
 
@@ -840,6 +848,9 @@ typedef struct avifTileInfo
     unsigned int tileCount;
     unsigned int decodedTileCount;
     unsigned int firstTileIndex; // Within avifDecoderData.tiles.
+    // First cell decoded for the current frame, relative to firstTileIndex. Other cells are checked against it. Nonzero
+    // only when leading cells lie outside of avifDecoder::regionOfInterest.
+    unsigned int firstDecodedTileIndex;
     avifImageGrid grid;
 } avifTileInfo;
 
@@ -864,6 +875,15 @@ typedef struct avifDecoderData
     //   decoder instance (same as above).
     avifCodec * codec;
     avifCodec * codecAlpha;
+    // For still grid images decoded with a single codec instance, |gridCodecs| is a pool of instances that decode the grid
+    // cells in parallel. gridCodecs[0] is |codec|; the others are owned by the pool. gridCodecCount is 0 when unused.
+    avifCodec * gridCodecs[AVIF_GRID_CODEC_POOL_MAX];
+    unsigned int gridCodecCount;
+    // Number of item categories (color, alpha, ...) whose samples are decoded concurrently, each with its own codec
+    // instances. 0 when categories are decoded one after another.
+    unsigned int concurrentCategoryCount;
+    // avifDecoder::regionOfInterest the current frame was decoded with. All zero when no grid cell was skipped.
+    avifCropRect decodedRegion;
     uint8_t majorBrand[4];                     // From the file's ftyp, used by AVIF_DECODER_SOURCE_AUTO
     avifBrandArray compatibleBrands;           // From the file's ftyp
     avifDiagnostics * diag;                    // Shallow copy; owned by avifDecoder
@@ -927,6 +947,12 @@ static void avifDecoderDataResetCodec(avifDecoderData * data)
         avifCodecDestroy(data->codecAlpha);
         data->codecAlpha = NULL;
     }
+    for (unsigned int i = 1; i < data->gridCodecCount; ++i) {
+        avifCodecDestroy(data->gridCodecs[i]);
+    }
+    memset(data->gridCodecs, 0, sizeof(data->gridCodecs));
+    data->gridCodecCount = 0;
+    data->concurrentCategoryCount = 0;
 }
 
 static avifTile * avifDecoderDataCreateTile(avifDecoderData * data, avifCodecType codecType, uint32_t width, uint32_t height, uint8_t operatingPoint)
@@ -1544,7 +1570,7 @@ static avifResult avifDecoderGenerateImageGridTiles(avifDecoder * decoder,
 // Allocates the dstImage. Also verifies some spec compliance rules for grids, if relevant.
 static avifResult avifDecoderDataAllocateImagePlanes(avifDecoderData * data, const avifTileInfo * info, avifImage * dstImage)
 {
-    const avifTile * tile = &data->tiles.tile[info->firstTileIndex];
+    const avifTile * tile = &data->tiles.tile[info->firstTileIndex + info->firstDecodedTileIndex];
     uint32_t dstWidth;
     uint32_t dstHeight;
 
@@ -1631,13 +1657,15 @@ static avifResult avifDecoderDataAllocateImagePlanes(avifDecoderData * data, con
 
 // Copies over the pixels from the tile into dstImage.
 // Verifies that the relevant properties of the tile match those of the first tile in case of a grid.
+// Errors are reported to diag, which must be owned by the calling thread.
 static avifResult avifDecoderDataCopyTileToImage(avifDecoderData * data,
                                                  const avifTileInfo * info,
                                                  avifImage * dstImage,
                                                  const avifTile * tile,
-                                                 unsigned int tileIndex)
+                                                 unsigned int tileIndex,
+                                                 avifDiagnostics * diag)
 {
-    const avifTile * firstTile = &data->tiles.tile[info->firstTileIndex];
+    const avifTile * firstTile = &data->tiles.tile[info->firstTileIndex + info->firstDecodedTileIndex];
     if (tile != firstTile) {
         // Check for tile consistency. All tiles in a grid image should match the first tile in the properties checked below.
         if ((tile->image->width != firstTile->image->width) || (tile->image->height != firstTile->image->height) ||
@@ -1645,7 +1673,7 @@ static avifResult avifDecoderDataCopyTileToImage(avifDecoderData * data,
             (tile->image->yuvRange != firstTile->image->yuvRange) || (tile->image->colorPrimaries != firstTile->image->colorPrimaries) ||
             (tile->image->transferCharacteristics != firstTile->image->transferCharacteristics) ||
             (tile->image->matrixCoefficients != firstTile->image->matrixCoefficients)) {
-            avifDiagnosticsPrintf(data->diag, "Grid image contains mismatched tiles");
+            avifDiagnosticsPrintf(diag, "Grid image contains mismatched tiles");
             return AVIF_RESULT_INVALID_IMAGE_GRID;
         }
     }
@@ -4969,6 +4997,21 @@ static avifBool avifTilesCanBeDecodedWithSameCodecInstance(avifDecoderData * dat
     return AVIF_TRUE;
 }
 
+#if defined(AVIF_GRID_THREADS)
+// Returns AVIF_TRUE if every tile is decoded by a codec instance that no other tile uses.
+static avifBool avifTilesHaveOwnCodecs(const avifDecoderData * data)
+{
+    for (unsigned int i = 0; i < data->tiles.count; ++i) {
+        for (unsigned int j = i + 1; j < data->tiles.count; ++j) {
+            if (data->tiles.tile[i].codec == data->tiles.tile[j].codec) {
+                return AVIF_FALSE;
+            }
+        }
+    }
+    return AVIF_TRUE;
+}
+#endif
+
 static avifResult avifDecoderCreateCodecs(avifDecoder * decoder)
 {
     avifDecoderData * data = decoder->data;
@@ -5002,6 +5045,35 @@ static avifResult avifDecoderCreateCodecs(avifDecoder * decoder)
             for (unsigned int i = 0; i < decoder->data->tiles.count; ++i) {
                 decoder->data->tiles.tile[i].codec = data->codec;
             }
+#if defined(AVIF_GRID_THREADS)
+            // Still grids that are fully available up front get extra codec instances so that the cells after the first
+            // one can be decoded in parallel (see avifDecoderDecodeGridTilesInParallel()).
+            if (!decoder->allowIncremental && decoder->imageCount == 1 && decoder->maxThreads > 1) {
+                unsigned int maxTileCount = 0;
+                for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
+                    if (data->tileInfos[c].tileCount > maxTileCount) {
+                        maxTileCount = data->tileInfos[c].tileCount;
+                    }
+                }
+                unsigned int poolSize = AVIF_MIN((unsigned int)decoder->maxThreads, AVIF_GRID_CODEC_POOL_MAX);
+                if (maxTileCount > 1) {
+                    poolSize = AVIF_MIN(poolSize, maxTileCount - 1);
+                } else {
+                    poolSize = 0;
+                }
+                if (poolSize > 1) {
+                    data->gridCodecs[0] = data->codec;
+                    data->gridCodecCount = 1;
+                    for (unsigned int i = 1; i < poolSize; ++i) {
+                        AVIF_CHECKRES(avifCodecCreateInternal(decoder->codecChoice,
+                                                              &decoder->data->tiles.tile[0],
+                                                              &decoder->diag,
+                                                              &data->gridCodecs[i]));
+                        ++data->gridCodecCount;
+                    }
+                }
+            }
+#endif
         } else {
             for (unsigned int i = 0; i < decoder->data->tiles.count; ++i) {
                 avifTile * tile = &decoder->data->tiles.tile[i];
@@ -5009,6 +5081,21 @@ static avifResult avifDecoderCreateCodecs(avifDecoder * decoder)
             }
         }
     }
+#if defined(AVIF_GRID_THREADS)
+    // Color and alpha (and gain map) are independent bitstreams. When no codec instance is shared between tiles, they are
+    // decoded concurrently (see avifDecoderDecodeCategorySamplesInParallel()).
+    if (!decoder->allowIncremental && decoder->maxThreads > 1 && avifTilesHaveOwnCodecs(data)) {
+        unsigned int categoryCount = 0;
+        for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
+            if (data->tileInfos[c].tileCount > 0) {
+                ++categoryCount;
+            }
+        }
+        if (categoryCount > 1) {
+            data->concurrentCategoryCount = categoryCount;
+        }
+    }
+#endif
     return AVIF_RESULT_OK;
 }
 
@@ -5037,6 +5124,85 @@ static avifBool avifDecoderItemIsAlphaAux(const avifDecoderItem * item, uint32_t
     return auxCProp && isAlphaURN(auxCProp->u.auxC.auxType);
 }
 
+// Returns AVIF_TRUE if item has an alpha auxiliary item, either for itself or, when it is a grid, for its cells.
+static avifBool avifMetaItemHasAlpha(const avifMeta * meta, const avifDecoderItem * item)
+{
+    for (uint32_t auxIndex = 0; auxIndex < meta->items.count; ++auxIndex) {
+        const avifDecoderItem * auxItem = meta->items.item[auxIndex];
+        if (auxItem->auxForID == 0 || !avifDecoderItemIsAlphaAux(auxItem, auxItem->auxForID)) {
+            continue;
+        }
+        if (auxItem->auxForID == item->id) {
+            return AVIF_TRUE;
+        }
+        for (uint32_t cellIndex = 0; cellIndex < meta->items.count; ++cellIndex) {
+            const avifDecoderItem * cell = meta->items.item[cellIndex];
+            if ((cell->id == auxItem->auxForID) && (cell->dimgForID == item->id)) {
+                return AVIF_TRUE;
+            }
+        }
+    }
+    return AVIF_FALSE;
+}
+
+// Returns the smallest 'thmb' item of colorItem that is at least minWidth x minHeight, has the aspect ratio of colorItem up to
+// rounding of its size and has alpha exactly when colorItem has, or NULL. The ispe of thumbnails is not harvested by
+// avifDecoderParse(), the picked item gets its width and height here.
+static avifDecoderItem * avifMetaFindThumbnailItem(avifDecoder * decoder,
+                                                   avifMeta * meta,
+                                                   const avifDecoderItem * colorItem,
+                                                   uint32_t minWidth,
+                                                   uint32_t minHeight)
+{
+    if ((colorItem->width == 0) || (colorItem->height == 0)) {
+        return NULL;
+    }
+    const avifBool colorHasAlpha = avifMetaItemHasAlpha(meta, colorItem);
+    avifDecoderItem * picked = NULL;
+    uint64_t pickedArea = 0;
+    uint32_t pickedWidth = 0;
+    uint32_t pickedHeight = 0;
+    for (uint32_t itemIndex = 0; itemIndex < meta->items.count; ++itemIndex) {
+        avifDecoderItem * item = meta->items.item[itemIndex];
+        if ((item->thumbnailForID != colorItem->id) || !item->size || item->hasUnsupportedEssentialProperty ||
+            ((avifGetCodecType(item->type) == AVIF_CODEC_TYPE_UNKNOWN) && memcmp(item->type, "grid", 4))) {
+            continue;
+        }
+        const avifProperty * ispeProp = avifPropertyArrayFind(&item->properties, "ispe");
+        if (!ispeProp) {
+            continue;
+        }
+        const uint32_t width = ispeProp->u.ispe.width;
+        const uint32_t height = ispeProp->u.ispe.height;
+        if ((width < minWidth) || (height < minHeight) ||
+            avifDimensionsTooLarge(width, height, decoder->imageSizeLimit, decoder->imageDimensionLimit)) {
+            continue;
+        }
+        // Previews cut to another shape are skipped
+        const uint64_t crossWidth = (uint64_t)width * colorItem->height;
+        const uint64_t crossHeight = (uint64_t)height * colorItem->width;
+        const uint64_t aspectError = (crossWidth > crossHeight) ? (crossWidth - crossHeight) : (crossHeight - crossWidth);
+        if (aspectError > AVIF_MAX(colorItem->width, colorItem->height)) {
+            continue;
+        }
+        if (avifMetaItemHasAlpha(meta, item) != colorHasAlpha) {
+            continue;
+        }
+        const uint64_t area = (uint64_t)width * height;
+        if (!picked || (area < pickedArea)) {
+            picked = item;
+            pickedArea = area;
+            pickedWidth = width;
+            pickedHeight = height;
+        }
+    }
+    if (picked) {
+        picked->width = pickedWidth;
+        picked->height = pickedHeight;
+    }
+    return picked;
+}
+
 // Finds the alpha item whose parent item is colorItem and sets it in the alphaItem output parameter. Returns AVIF_RESULT_OK on
 // success. Note that *alphaItem can be NULL even if the return value is AVIF_RESULT_OK. If the colorItem is a grid and the alpha
 // item is represented as a set of auxl items to each color tile, then a fake item will be created and *isAlphaItemInInput will be
@@ -5686,11 +5852,20 @@ avifResult avifDecoderReset(avifDecoder * decoder)
         }
 
         // Mandatory primary color item
-        mainItems[AVIF_ITEM_COLOR] = avifMetaFindColorItem(data->meta);
-        if (!mainItems[AVIF_ITEM_COLOR]) {
+        avifDecoderItem * primaryItem = avifMetaFindColorItem(data->meta);
+        mainItems[AVIF_ITEM_COLOR] = primaryItem;
+        if (!primaryItem) {
             avifDiagnosticsPrintf(&decoder->diag, "Primary item not found");
             return AVIF_RESULT_MISSING_IMAGE_ITEM;
         }
+        // Small targets are served from a thumbnail, which then stands in for the primary item everywhere but metadata
+        if ((decoder->thumbnailMinWidth > 0) && (decoder->thumbnailMinHeight > 0)) {
+            avifDecoderItem * thumbnailItem =
+                avifMetaFindThumbnailItem(decoder, data->meta, primaryItem, decoder->thumbnailMinWidth, decoder->thumbnailMinHeight);
+            if (thumbnailItem) {
+                mainItems[AVIF_ITEM_COLOR] = thumbnailItem;
+            }
+        }
         AVIF_CHECKRES(avifDecoderItemReadAndParse(decoder,
                                                   mainItems[AVIF_ITEM_COLOR],
                                                   /*isItemInInput=*/AVIF_TRUE,
@@ -5844,7 +6019,7 @@ avifResult avifDecoderReset(avifDecoder * decoder)
 #endif // AVIF_ENABLE_EXPERIMENTAL_SAMPLE_TRANSFORM
 
         // Find Exif and/or XMP metadata, if any
-        AVIF_CHECKRES(avifDecoderFindMetadata(decoder, data->meta, decoder->image, mainItems[AVIF_ITEM_COLOR]->id));
+        AVIF_CHECKRES(avifDecoderFindMetadata(decoder, data->meta, decoder->image, primaryItem->id));
 
         // Set all counts and timing to safe-but-uninteresting values
         decoder->imageIndex = -1;
@@ -6098,10 +6273,327 @@ static avifResult avifGetErrorForItemCategory(avifItemCategory itemCategory)
     return avifIsAlpha(itemCategory) ? AVIF_RESULT_DECODE_ALPHA_FAILED : AVIF_RESULT_DECODE_COLOR_FAILED;
 }
 
-static avifResult avifDecoderDecodeTiles(avifDecoder * decoder, uint32_t nextImageIndex, avifTileInfo * info)
+// Returns AVIF_TRUE if the cell tileIndex of a color or alpha grid lies outside of data->decodedRegion and is not decoded.
+static avifBool avifDecoderIsCellSkipped(const avifDecoder * decoder, const avifTileInfo * info, unsigned int tileIndex)
+{
+    const avifCropRect * region = &decoder->data->decodedRegion;
+    if ((region->width == 0) || (region->height == 0) || (info->grid.rows == 0) || (info->grid.columns == 0)) {
+        return AVIF_FALSE;
+    }
+    const avifTile * tile = &decoder->data->tiles.tile[info->firstTileIndex];
+    if ((tile->input->itemCategory != AVIF_ITEM_COLOR) && (tile->input->itemCategory != AVIF_ITEM_ALPHA)) {
+        return AVIF_FALSE;
+    }
+    const uint64_t cellX = (uint64_t)(tileIndex % info->grid.columns) * tile->width;
+    const uint64_t cellY = (uint64_t)(tileIndex / info->grid.columns) * tile->height;
+    return (cellX >= (uint64_t)region->x + region->width) || (cellX + tile->width <= region->x) ||
+           (cellY >= (uint64_t)region->y + region->height) || (cellY + tile->height <= region->y);
+}
+
+// Takes decoder->regionOfInterest for the frame about to be decoded and finds the first cell of each grid to decode.
+// Cells are only skipped when the whole frame is decoded at once and the region lies on the image.
+static void avifDecoderResolveDecodedRegion(avifDecoder * decoder)
+{
+    avifDecoderData * data = decoder->data;
+    const avifCropRect * region = &decoder->regionOfInterest;
+    memset(&data->decodedRegion, 0, sizeof(data->decodedRegion));
+    if (!decoder->allowIncremental && (region->width > 0) && (region->height > 0) && (region->x < decoder->image->width) &&
+        (region->y < decoder->image->height)) {
+        data->decodedRegion = *region;
+    }
+    avifBool anyCellSkipped = AVIF_FALSE;
+    for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
+        avifTileInfo * info = &data->tileInfos[c];
+        info->firstDecodedTileIndex = 0;
+        while ((info->firstDecodedTileIndex + 1 < info->tileCount) &&
+               avifDecoderIsCellSkipped(decoder, info, info->firstDecodedTileIndex)) {
+            ++info->firstDecodedTileIndex;
+        }
+        for (unsigned int tileIndex = 0; tileIndex < info->tileCount; ++tileIndex) {
+            if (avifDecoderIsCellSkipped(decoder, info, tileIndex)) {
+                anyCellSkipped = AVIF_TRUE;
+                break;
+            }
+        }
+    }
+    if (!anyCellSkipped) {
+        memset(&data->decodedRegion, 0, sizeof(data->decodedRegion));
+    }
+}
+
+// Returns AVIF_TRUE if no cell needed for decoder->regionOfInterest was skipped when the current frame was decoded.
+static avifBool avifDecoderDecodedRegionCovers(const avifDecoder * decoder)
+{
+    const avifCropRect * decoded = &decoder->data->decodedRegion;
+    const avifCropRect * requested = &decoder->regionOfInterest;
+    if ((decoded->width == 0) || (decoded->height == 0)) {
+        return AVIF_TRUE;
+    }
+    if ((requested->width == 0) || (requested->height == 0)) {
+        return AVIF_FALSE;
+    }
+    return (requested->x >= decoded->x) && (requested->y >= decoded->y) &&
+           ((uint64_t)requested->x + requested->width <= (uint64_t)decoded->x + decoded->width) &&
+           ((uint64_t)requested->y + requested->height <= (uint64_t)decoded->y + decoded->height);
+}
+
+// Returns the number of threads each codec instance may use. When grid cells are decoded by a pool of codec instances,
+// or item categories are decoded concurrently, decoder->maxThreads is shared between them.
+static int avifDecoderCodecThreads(const avifDecoder * decoder)
+{
+    const unsigned int poolSize = decoder->data->gridCodecCount;
+    if (poolSize > 1) {
+        return AVIF_MAX(1, decoder->maxThreads / (int)poolSize);
+    }
+    const unsigned int categoryCount = decoder->data->concurrentCategoryCount;
+    if (categoryCount > 1) {
+        return AVIF_MAX(1, decoder->maxThreads / (int)categoryCount);
+    }
+    return decoder->maxThreads;
+}
+
+// Decodes the sample of a tile with the given codec instance into tile->image, then brings it to the tile's output
+// dimensions and alpha range. Errors are reported to diag.
+static avifResult avifDecoderDecodeTileSample(avifDecoder * decoder,
+                                              avifCodec * codec,
+                                              avifTile * tile,
+                                              const avifDecodeSample * sample,
+                                              avifDiagnostics * diag)
+{
+    avifBool isLimitedRangeAlpha = AVIF_FALSE;
+    codec->maxThreads = avifDecoderCodecThreads(decoder);
+    codec->imageSizeLimit = decoder->imageSizeLimit;
+    if (!codec->getNextImage(codec, sample, avifIsAlpha(tile->input->itemCategory), &isLimitedRangeAlpha, tile->image)) {
+        avifDiagnosticsPrintf(diag, "tile->codec->getNextImage() failed");
+        return avifGetErrorForItemCategory(tile->input->itemCategory);
+    }
+
+    // Section 2.3.4 of AV1 Codec ISO Media File Format Binding v1.2.0 says:
+    //   the full_range_flag in the colr box shall match the color_range
+    //   flag in the Sequence Header OBU.
+    // See https://aomediacodec.github.io/av1-isobmff/v1.2.0.html#av1codecconfigurationbox-semantics.
+    // If a 'colr' box of colour_type 'nclx' was parsed, a mismatch between
+    // the 'colr' decoder->image->yuvRange and the AV1 OBU
+    // tile->image->yuvRange should be treated as an error.
+    // However codec_svt.c was not encoding the color_range field for
+    // multiple years, so there probably are files in the wild that will
+    // fail decoding if this is enforced. Thus this pattern is allowed.
+    // Section 12.1.5.1 of ISO 14496-12 (ISOBMFF) says:
+    //   If colour information is supplied in both this [colr] box, and also
+    //   in the video bitstream, this box takes precedence, and over-rides
+    //   the information in the bitstream.
+    // So decoder->image->yuvRange is kept because it was either the 'colr'
+    // value set when the 'colr' box was parsed, or it was the AV1 OBU value
+    // extracted from the sequence header OBU of the first tile of the first
+    // frame (if no 'colr' box of colour_type 'nclx' was found).
+
+    // Alpha plane with limited range is not allowed by the latest revision
+    // of the specification. However, it was allowed in version 1.0.0 of the
+    // specification. To allow such files, simply convert the alpha plane to
+    // full range.
+    if (avifIsAlpha(tile->input->itemCategory) && isLimitedRangeAlpha) {
+        avifResult result = avifImageLimitedToFullAlpha(tile->image);
+        if (result != AVIF_RESULT_OK) {
+            avifDiagnosticsPrintf(diag, "avifImageLimitedToFullAlpha failed");
+            return result;
+        }
+    }
+
+    // Scale the decoded image so that it corresponds to this tile's output dimensions
+    if ((tile->width != tile->image->width) || (tile->height != tile->image->height)) {
+        if (avifImageScaleWithLimit(tile->image,
+                                    tile->width,
+                                    tile->height,
+                                    decoder->imageSizeLimit,
+                                    decoder->imageDimensionLimit,
+                                    diag) != AVIF_RESULT_OK) {
+            return avifGetErrorForItemCategory(tile->input->itemCategory);
+        }
+    }
+    return AVIF_RESULT_OK;
+}
+
+#if defined(AVIF_GRID_THREADS)
+typedef struct avifGridDecodeWorker
+{
+    avifDecoder * decoder;
+    avifCodec * codec;
+    const avifTileInfo * info;
+    avifImage * dstImage;
+    uint32_t nextImageIndex;
+    unsigned int firstCellIndex; // Cells firstCellIndex, firstCellIndex + stride, ... are decoded by this worker.
+    unsigned int stride;
+    avifResult result;
+    avifDiagnostics diag;
+} avifGridDecodeWorker;
+
+static void * avifGridDecodeWorkerRun(void * arg)
+{
+    avifGridDecodeWorker * worker = (avifGridDecodeWorker *)arg;
+    avifDecoderData * data = worker->decoder->data;
+    const avifTileInfo * info = worker->info;
+    worker->result = AVIF_RESULT_OK;
+    // The codec instance belongs to this worker only, its errors go to the worker's diagnostics until the join.
+    avifDiagnostics * codecDiag = worker->codec->diag;
+    worker->codec->diag = &worker->diag;
+    for (unsigned int tileIndex = worker->firstCellIndex; tileIndex < info->tileCount; tileIndex += worker->stride) {
+        if (avifDecoderIsCellSkipped(worker->decoder, info, tileIndex)) {
+            continue;
+        }
+        avifTile * tile = &data->tiles.tile[info->firstTileIndex + tileIndex];
+        const avifDecodeSample * sample = &tile->input->samples.sample[worker->nextImageIndex];
+        worker->result = avifDecoderDecodeTileSample(worker->decoder, worker->codec, tile, sample, &worker->diag);
+        if (worker->result != AVIF_RESULT_OK) {
+            break;
+        }
+        // Each cell is copied into its own rectangle of dstImage, and before the codec instance decodes the next cell
+        // since tile->image points into the codec's buffers. Cells stay in YUV; the RGB conversion runs on the whole
+        // image after all workers are joined.
+        worker->result = avifDecoderDataCopyTileToImage(data, info, worker->dstImage, tile, tileIndex, &worker->diag);
+        if (worker->result != AVIF_RESULT_OK) {
+            break;
+        }
+    }
+    worker->codec->diag = codecDiag;
+    return NULL;
+}
+
+// Decodes the remaining cells of a grid once the first one (info->firstDecodedTileIndex) has been decoded and dstImage has
+// been allocated. The cells are distributed over the codec instances of data->gridCodecs, one thread per instance.
+static avifResult avifDecoderDecodeGridTilesInParallel(avifDecoder * decoder, uint32_t nextImageIndex, avifTileInfo * info, avifImage * dstImage)
+{
+    avifDecoderData * data = decoder->data;
+    const unsigned int workerCount = AVIF_MIN(data->gridCodecCount, info->tileCount - info->firstDecodedTileIndex - 1);
+    avifGridDecodeWorker workers[AVIF_GRID_CODEC_POOL_MAX];
+    pthread_t threads[AVIF_GRID_CODEC_POOL_MAX];
+    avifBool started[AVIF_GRID_CODEC_POOL_MAX];
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        avifGridDecodeWorker * worker = &workers[i];
+        worker->decoder = decoder;
+        worker->codec = data->gridCodecs[i];
+        worker->info = info;
+        worker->dstImage = dstImage;
+        worker->nextImageIndex = nextImageIndex;
+        worker->firstCellIndex = info->firstDecodedTileIndex + 1 + i;
+        worker->stride = workerCount;
+        worker->result = AVIF_RESULT_OK;
+        avifDiagnosticsClearError(&worker->diag);
+        // The last worker runs on the calling thread; it also covers any worker that could not be started.
+        started[i] = (i + 1 < workerCount) && (pthread_create(&threads[i], NULL, avifGridDecodeWorkerRun, worker) == 0);
+        if (!started[i]) {
+            avifGridDecodeWorkerRun(worker);
+        }
+    }
+    avifResult result = AVIF_RESULT_OK;
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        if (result == AVIF_RESULT_OK && workers[i].result != AVIF_RESULT_OK) {
+            result = workers[i].result;
+            if (workers[i].diag.error[0] != '\0') {
+                avifDiagnosticsPrintf(&decoder->diag, "%s", workers[i].diag.error);
+            }
+        }
+    }
+    AVIF_CHECKRES(result);
+    info->decodedTileCount = info->tileCount;
+    return AVIF_RESULT_OK;
+}
+
+typedef struct avifCategoryDecodeWorker
+{
+    avifDecoder * decoder;
+    const avifTileInfo * info;
+    uint32_t nextImageIndex;
+    avifResult result;
+    avifDiagnostics diag;
+} avifCategoryDecodeWorker;
+
+static void * avifCategoryDecodeWorkerRun(void * arg)
+{
+    avifCategoryDecodeWorker * worker = (avifCategoryDecodeWorker *)arg;
+    const avifTileInfo * info = worker->info;
+    worker->result = AVIF_RESULT_OK;
+    for (unsigned int tileIndex = 0; tileIndex < info->tileCount; ++tileIndex) {
+        if (avifDecoderIsCellSkipped(worker->decoder, info, tileIndex)) {
+            continue;
+        }
+        avifTile * tile = &worker->decoder->data->tiles.tile[info->firstTileIndex + tileIndex];
+        const avifDecodeSample * sample = &tile->input->samples.sample[worker->nextImageIndex];
+        if (sample->data.size < sample->size) {
+            worker->result = AVIF_RESULT_TRUNCATED_DATA;
+            break;
+        }
+        // Codecs of a category are not shared with other categories, so they may report to the worker's diagnostics.
+        avifDiagnostics * codecDiag = tile->codec->diag;
+        tile->codec->diag = &worker->diag;
+        worker->result = avifDecoderDecodeTileSample(worker->decoder, tile->codec, tile, sample, &worker->diag);
+        tile->codec->diag = codecDiag;
+        if (worker->result != AVIF_RESULT_OK) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Decodes the samples of every item category concurrently, one thread per category, into tile->image. Moving them into
+// decoder->image is left to avifDecoderDecodeTiles() which is then called with samplesDecoded set.
+static avifResult avifDecoderDecodeCategorySamplesInParallel(avifDecoder * decoder, uint32_t nextImageIndex)
+{
+    avifCategoryDecodeWorker workers[AVIF_ITEM_CATEGORY_COUNT];
+    pthread_t threads[AVIF_ITEM_CATEGORY_COUNT];
+    avifBool started[AVIF_ITEM_CATEGORY_COUNT];
+    int lastCategory = -1;
+    for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
+        if (decoder->data->tileInfos[c].tileCount > 0) {
+            lastCategory = c;
+        }
+    }
+    for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
+        avifCategoryDecodeWorker * worker = &workers[c];
+        worker->decoder = decoder;
+        worker->info = &decoder->data->tileInfos[c];
+        worker->nextImageIndex = nextImageIndex;
+        worker->result = AVIF_RESULT_OK;
+        avifDiagnosticsClearError(&worker->diag);
+        started[c] = AVIF_FALSE;
+        if (worker->info->tileCount == 0) {
+            continue;
+        }
+        // The last category runs on the calling thread; it also covers any category that could not be started.
+        started[c] = (c != lastCategory) && (pthread_create(&threads[c], NULL, avifCategoryDecodeWorkerRun, worker) == 0);
+        if (!started[c]) {
+            avifCategoryDecodeWorkerRun(worker);
+        }
+    }
+    avifResult result = AVIF_RESULT_OK;
+    for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
+        if (started[c]) {
+            pthread_join(threads[c], NULL);
+        }
+        if (result == AVIF_RESULT_OK && workers[c].result != AVIF_RESULT_OK) {
+            result = workers[c].result;
+            if (workers[c].diag.error[0] != '\0') {
+                avifDiagnosticsPrintf(&decoder->diag, "%s", workers[c].diag.error);
+            }
+        }
+    }
+    return result;
+}
+#endif
+
+// Decodes the tiles of info and moves them into decoder->image. If samplesDecoded is AVIF_TRUE, the samples of all the
+// tiles were already decoded into tile->image by avifDecoderDecodeCategorySamplesInParallel().
+static avifResult avifDecoderDecodeTiles(avifDecoder * decoder, uint32_t nextImageIndex, avifTileInfo * info, avifBool samplesDecoded)
 {
     const unsigned int oldDecodedTileCount = info->decodedTileCount;
     for (unsigned int tileIndex = oldDecodedTileCount; tileIndex < info->tileCount; ++tileIndex) {
+        if (avifDecoderIsCellSkipped(decoder, info, tileIndex)) {
+            // Outside of decoder->regionOfInterest, this cell's rectangle of decoder->image is left unspecified.
+            ++info->decodedTileCount;
+            continue;
+        }
         avifTile * tile = &decoder->data->tiles.tile[info->firstTileIndex + tileIndex];
 
         const avifDecodeSample * sample = &tile->input->samples.sample[nextImageIndex];
@@ -6111,55 +6603,8 @@ static avifResult avifDecoderDecodeTiles(avifDecoder * decoder, uint32_t nextIma
             return AVIF_RESULT_OK;
         }
 
-        avifBool isLimitedRangeAlpha = AVIF_FALSE;
-        tile->codec->maxThreads = decoder->maxThreads;
-        tile->codec->imageSizeLimit = decoder->imageSizeLimit;
-        if (!tile->codec->getNextImage(tile->codec, sample, avifIsAlpha(tile->input->itemCategory), &isLimitedRangeAlpha, tile->image)) {
-            avifDiagnosticsPrintf(&decoder->diag, "tile->codec->getNextImage() failed");
-            return avifGetErrorForItemCategory(tile->input->itemCategory);
-        }
-
-        // Section 2.3.4 of AV1 Codec ISO Media File Format Binding v1.2.0 says:
-        //   the full_range_flag in the colr box shall match the color_range
-        //   flag in the Sequence Header OBU.
-        // See https://aomediacodec.github.io/av1-isobmff/v1.2.0.html#av1codecconfigurationbox-semantics.
-        // If a 'colr' box of colour_type 'nclx' was parsed, a mismatch between
-        // the 'colr' decoder->image->yuvRange and the AV1 OBU
-        // tile->image->yuvRange should be treated as an error.
-        // However codec_svt.c was not encoding the color_range field for
-        // multiple years, so there probably are files in the wild that will
-        // fail decoding if this is enforced. Thus this pattern is allowed.
-        // Section 12.1.5.1 of ISO 14496-12 (ISOBMFF) says:
-        //   If colour information is supplied in both this [colr] box, and also
-        //   in the video bitstream, this box takes precedence, and over-rides
-        //   the information in the bitstream.
-        // So decoder->image->yuvRange is kept because it was either the 'colr'
-        // value set when the 'colr' box was parsed, or it was the AV1 OBU value
-        // extracted from the sequence header OBU of the first tile of the first
-        // frame (if no 'colr' box of colour_type 'nclx' was found).
-
-        // Alpha plane with limited range is not allowed by the latest revision
-        // of the specification. However, it was allowed in version 1.0.0 of the
-        // specification. To allow such files, simply convert the alpha plane to
-        // full range.
-        if (avifIsAlpha(tile->input->itemCategory) && isLimitedRangeAlpha) {
-            avifResult result = avifImageLimitedToFullAlpha(tile->image);
-            if (result != AVIF_RESULT_OK) {
-                avifDiagnosticsPrintf(&decoder->diag, "avifImageLimitedToFullAlpha failed");
-                return result;
-            }
-        }
-
-        // Scale the decoded image so that it corresponds to this tile's output dimensions
-        if ((tile->width != tile->image->width) || (tile->height != tile->image->height)) {
-            if (avifImageScaleWithLimit(tile->image,
-                                        tile->width,
-                                        tile->height,
-                                        decoder->imageSizeLimit,
-                                        decoder->imageDimensionLimit,
-                                        &decoder->diag) != AVIF_RESULT_OK) {
-                return avifGetErrorForItemCategory(tile->input->itemCategory);
-            }
+        if (!samplesDecoded) {
+            AVIF_CHECKRES(avifDecoderDecodeTileSample(decoder, tile->codec, tile, sample, &decoder->diag));
         }
 
         ++info->decodedTileCount;
@@ -6187,10 +6632,16 @@ static avifResult avifDecoderDecodeTiles(avifDecoder * decoder, uint32_t nextIma
                 dstImage = dstImage->gainMap->image;
             }
 #endif
-            if (tileIndex == 0) {
+            if (tileIndex == info->firstDecodedTileIndex) {
                 AVIF_CHECKRES(avifDecoderDataAllocateImagePlanes(decoder->data, info, dstImage));
             }
-            AVIF_CHECKRES(avifDecoderDataCopyTileToImage(decoder->data, info, dstImage, tile, tileIndex));
+            AVIF_CHECKRES(avifDecoderDataCopyTileToImage(decoder->data, info, dstImage, tile, tileIndex, decoder->data->diag));
+#if defined(AVIF_GRID_THREADS)
+            if (!samplesDecoded && tileIndex == info->firstDecodedTileIndex && isGrid && decoder->data->gridCodecCount > 1 &&
+                info->tileCount > tileIndex + 2) {
+                return avifDecoderDecodeGridTilesInParallel(decoder, nextImageIndex, info, dstImage);
+            }
+#endif
         } else {
             AVIF_ASSERT_OR_RETURN(info->tileCount == 1);
             AVIF_ASSERT_OR_RETURN(tileIndex == 0);
@@ -6324,6 +6775,15 @@ avifResult avifDecoderNextImage(avifDecoder * decoder)
             decoder->data->tileInfos[c].decodedTileCount = 0;
         }
     }
+    avifBool frameStarts = AVIF_TRUE;
+    for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
+        if (decoder->data->tileInfos[c].decodedTileCount != 0) {
+            frameStarts = AVIF_FALSE;
+        }
+    }
+    if (frameStarts) {
+        avifDecoderResolveDecodedRegion(decoder);
+    }
 
     AVIF_ASSERT_OR_RETURN(decoder->data->tiles.count == (decoder->data->tileInfos[AVIF_ITEM_CATEGORY_COUNT - 1].firstTileIndex +
                                                          decoder->data->tileInfos[AVIF_ITEM_CATEGORY_COUNT - 1].tileCount));
@@ -6350,8 +6810,23 @@ avifResult avifDecoderNextImage(avifDecoder * decoder)
     // encoder's choice, and decoding as many as possible of each category in parallel is beneficial
     // for incremental decoding, as pixel rows need all channels to be decoded before being
     // accessible to the user.
+    avifBool samplesDecoded = AVIF_FALSE;
+#if defined(AVIF_GRID_THREADS)
+    if (decoder->data->concurrentCategoryCount > 1 && !decoder->allowIncremental) {
+        avifBool nothingDecoded = AVIF_TRUE;
+        for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
+            if (decoder->data->tileInfos[c].decodedTileCount != 0) {
+                nothingDecoded = AVIF_FALSE;
+            }
+        }
+        if (nothingDecoded) {
+            AVIF_CHECKRES(avifDecoderDecodeCategorySamplesInParallel(decoder, nextImageIndex));
+            samplesDecoded = AVIF_TRUE;
+        }
+    }
+#endif
     for (int c = 0; c < AVIF_ITEM_CATEGORY_COUNT; ++c) {
-        AVIF_CHECKRES(avifDecoderDecodeTiles(decoder, nextImageIndex, &decoder->data->tileInfos[c]));
+        AVIF_CHECKRES(avifDecoderDecodeTiles(decoder, nextImageIndex, &decoder->data->tileInfos[c], samplesDecoded));
     }
 
     if (!avifDecoderDataFrameFullyDecoded(decoder->data)) {
@@ -6454,12 +6929,13 @@ avifResult avifDecoderNthImage(avifDecoder * decoder, uint32_t frameIndex)
     }
 
     if (requestedIndex == decoder->imageIndex) {
-        if (avifDecoderDataFrameFullyDecoded(decoder->data)) {
+        if (avifDecoderDataFrameFullyDecoded(decoder->data) && avifDecoderDecodedRegionCovers(decoder)) {
             // The current fully decoded image (decoder->imageIndex) is requested, nothing to do
             return AVIF_RESULT_OK;
         }
         // The next image (decoder->imageIndex + 1) is partially decoded but
-        // the previous image (decoder->imageIndex) is requested.
+        // the previous image (decoder->imageIndex) is requested, or grid cells
+        // decoder->regionOfInterest needs were skipped.
         // Fall through to resetting the decoder data and start decoding from
         // the nearest key frame.
     }
@@ -86,6 +86,11 @@ struct FfiProfileData {
   uintptr_t capacity;
 };
 
+struct FfiTransformCacheStats {
+  uint64_t hits;
+  uint64_t misses;
+};
+
 extern "C" {
 
 void weave_yuv8_to_rgba8(const uint8_t *y_plane,
@@ -316,6 +321,23 @@ void apply_icc_rgba16(const uint16_t *src_image,
                       const uint8_t *icc_profile,
                       uint32_t icc_profile_stride);
 
+void apply_icc_in_place_rgba8(uint8_t *image,
+                              uint32_t stride,
+                              uint32_t width,
+                              uint32_t height,
+                              const uint8_t *icc_profile,
+                              uint32_t icc_profile_stride,
+                              uint32_t threads);
+
+void apply_icc_in_place_rgba16(uint16_t *image,
+                               uint32_t stride,
+                               uint32_t bit_depth,
+                               uint32_t width,
+                               uint32_t height,
+                               const uint8_t *icc_profile,
+                               uint32_t icc_profile_stride,
+                               uint32_t threads);
+
 void free_profile(FfiProfileData wrapper);
 
 FfiProfileData new_dci_p3_profile();
@@ -353,7 +375,8 @@ void apply_tone_mapping_rgba8(uint8_t *image,
                               const float *white_point,
                               FfiTrc trc,
                               ToneMapping mapping,
-                              float brightness);
+                              float brightness,
+                              uint32_t threads);
 
 void apply_tone_mapping_rgba16(uint16_t *image,
                                uint32_t stride,
@@ -364,6 +387,12 @@ void apply_tone_mapping_rgba16(uint16_t *image,
                                const float *white_point,
                                FfiTrc trc,
                                ToneMapping mapping,
-                               float brightness);
+                               float brightness,
+                               uint32_t threads);
+
+/// Whether ICC profile converts to sRGB as identity, so colour management may be skipped
+bool icc_profile_is_srgb(const uint8_t *icc_profile, uint32_t icc_profile_size);
+
+FfiTransformCacheStats icc_transform_cache_stats();
 
 }  // extern "C"
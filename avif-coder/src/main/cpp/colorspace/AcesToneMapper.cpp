@@ -27,40 +27,52 @@
  */
 
 #include "AcesToneMapper.h"
-#include "Oklab.hpp"
+#include "VectorF32.h"
 #include <algorithm>
 
-void AcesToneMapper::transferTone(float *inPlace, uint32_t width) {
-  float *targetPlace = inPlace;
+/** Fitted RRT + ODT, applied between ACES input and output matrices */
+static inline float AcesFit(float v) {
+  return (v * (v + 0.0245786f) - 0.000090537f) / (v * (0.983729f * v + 0.4329510f) + 0.238081f);
+}
 
-  for (uint32_t x = 0; x < width; ++x) {
-    float r = targetPlace[0];
-    float g = targetPlace[1];
-    float b = targetPlace[2];
+void AcesToneMapper::transferTone(float *r, float *g, float *b, uint32_t width) {
+  uint32_t x = 0;
 
-    auto mulInput = [](const coder::Rgb &color) {
-      float a = 0.59719f * color.r + 0.35458f * color.g + 0.04823f * color.b,
-          b = 0.07600f * color.r + 0.90834f * color.g + 0.01566f * color.b,
-          c = 0.02840f * color.r + 0.13383f * color.g + 0.83777f * color.b;
-      return coder::Rgb(a, b, c);
-    };
-
-    auto mulOutput = [](const coder::Rgb &color) {
-      float a = 1.60475f * color.r - 0.53108f * color.g - 0.07367f * color.b,
-          b = -0.10208f * color.r + 1.10813f * color.g - 0.00605f * color.b,
-          c = -0.00327f * color.r - 0.07276f * color.g + 1.07602f * color.b;
-      return coder::Rgb(a, b, c);
-    };
-
-    auto colorIn = mulInput(coder::Rgb(r, g, b));
-    auto ca = colorIn * (colorIn + 0.0245786f) - 0.000090537f;
-    auto cb = colorIn * (0.983729f * colorIn + 0.4329510f) + 0.238081f;
-    auto cOut = mulOutput(ca / cb);
-
-    targetPlace[0] = std::min(cOut.r, 1.f);
-    targetPlace[1] = std::min(cOut.g, 1.f);
-    targetPlace[2] = std::min(cOut.b, 1.f);
+#if HAVE_VECTOR_F32
+  using namespace coder::simd;
+  const F32x4 vOne = Splat(1.f);
+  const F32x4 vFitA = Splat(0.0245786f);
+  const F32x4 vFitB = Splat(0.000090537f);
+  const F32x4 vFitC = Splat(0.983729f);
+  const F32x4 vFitD = Splat(0.4329510f);
+  const F32x4 vFitE = Splat(0.238081f);
+  auto fit = [&](F32x4 v) {
+    F32x4 numerator = Sub(Mul(v, Add(v, vFitA)), vFitB);
+    F32x4 denominator = MulAdd(v, MulAdd(vFitC, v, vFitD), vFitE);
+    return Div(numerator, denominator);
+  };
+  for (; x + 4 <= width; x += 4) {
+    F32x4 vr = Load(r + x);
+    F32x4 vg = Load(g + x);
+    F32x4 vb = Load(b + x);
+    F32x4 a = fit(MulAdd(vb, Splat(0.04823f), MulAdd(vg, Splat(0.35458f), Mul(vr, Splat(0.59719f)))));
+    F32x4 c = fit(MulAdd(vb, Splat(0.01566f), MulAdd(vg, Splat(0.90834f), Mul(vr, Splat(0.07600f)))));
+    F32x4 d = fit(MulAdd(vb, Splat(0.83777f), MulAdd(vg, Splat(0.13383f), Mul(vr, Splat(0.02840f)))));
+    Store(r + x, Min(MulAdd(d, Splat(-0.07367f),
+                            MulAdd(c, Splat(-0.53108f), Mul(a, Splat(1.60475f)))), vOne));
+    Store(g + x, Min(MulAdd(d, Splat(-0.00605f),
+                            MulAdd(c, Splat(1.10813f), Mul(a, Splat(-0.10208f)))), vOne));
+    Store(b + x, Min(MulAdd(d, Splat(1.07602f),
+                            MulAdd(c, Splat(-0.07276f), Mul(a, Splat(-0.00327f)))), vOne));
+  }
+#endif
 
-    targetPlace += 3;
+  for (; x < width; ++x) {
+    float a = AcesFit(0.59719f * r[x] + 0.35458f * g[x] + 0.04823f * b[x]);
+    float c = AcesFit(0.07600f * r[x] + 0.90834f * g[x] + 0.01566f * b[x]);
+    float d = AcesFit(0.02840f * r[x] + 0.13383f * g[x] + 0.83777f * b[x]);
+    r[x] = std::min(1.60475f * a - 0.53108f * c - 0.07367f * d, 1.f);
+    g[x] = std::min(-0.10208f * a + 1.10813f * c - 0.00605f * d, 1.f);
+    b[x] = std::min(-0.00327f * a - 0.07276f * c + 1.07602f * d, 1.f);
   }
-}
\ No newline at end of file
+}
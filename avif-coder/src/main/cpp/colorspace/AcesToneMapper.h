@@ -37,7 +37,7 @@ class AcesToneMapper {
 
   }
 
-  static void transferTone(float *inPlace, uint32_t width);
+  static void transferTone(float *r, float *g, float *b, uint32_t width);
 
  private:
 
@@ -27,13 +27,151 @@
  */
 
 #include "ColorMatrix.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
 #include "concurrency.hpp"
 #include "definitions.h"
 #include "Rec2408ToneMapper.h"
 #include "LogarithmicToneMapper.h"
 #include "FilmicToneMapper.h"
 #include "AcesToneMapper.h"
-#include "ITUR.h"
+#include "ColorSpaceProfile.h"
+#include "VectorF32.h"
+
+/** Rows a worker gets at least, shorter runs do not pay for a thread */
+static constexpr uint32_t kMinRowsPerWorker = 16;
+/** Linear values are encoded through a table of this many intervals with interpolation */
+static constexpr uint32_t kGammaTableSteps = 4096;
+
+static void applyMatrixPlanar(float *r, float *g, float *b, uint32_t width, const float *m) {
+  uint32_t x = 0;
+
+#if HAVE_VECTOR_F32
+  using namespace coder::simd;
+  const F32x4 c0 = Splat(m[0]), c1 = Splat(m[1]), c2 = Splat(m[2]);
+  const F32x4 c3 = Splat(m[3]), c4 = Splat(m[4]), c5 = Splat(m[5]);
+  const F32x4 c6 = Splat(m[6]), c7 = Splat(m[7]), c8 = Splat(m[8]);
+  for (; x + 4 <= width; x += 4) {
+    F32x4 vr = Load(r + x);
+    F32x4 vg = Load(g + x);
+    F32x4 vb = Load(b + x);
+    Store(r + x, MulAdd(vb, c2, MulAdd(vg, c1, Mul(vr, c0))));
+    Store(g + x, MulAdd(vb, c5, MulAdd(vg, c4, Mul(vr, c3))));
+    Store(b + x, MulAdd(vb, c8, MulAdd(vg, c7, Mul(vr, c6))));
+  }
+#endif
+
+  for (; x < width; ++x) {
+    float newR = r[x] * m[0] + g[x] * m[1] + b[x] * m[2];
+    float newG = r[x] * m[3] + g[x] * m[4] + b[x] * m[5];
+    float newB = r[x] * m[6] + g[x] * m[7] + b[x] * m[8];
+    r[x] = newR;
+    g[x] = newG;
+    b[x] = newB;
+  }
+}
+
+template<typename T>
+static void toneMapImage(T *inPlace,
+                         uint32_t stride,
+                         uint32_t width,
+                         uint32_t height,
+                         uint32_t bitDepth,
+                         const float *matrix,
+                         TransferFunction intoLinear,
+                         TransferFunction intoGamma,
+                         CurveToneMapper toneMapper,
+                         ITURColorCoefficients coeffs,
+                         float intensityTarget,
+                         uint32_t threads) {
+  const uint32_t maxCode = (1u << bitDepth) - 1;
+  const float maxValue = static_cast<float>(maxCode);
+
+  const float mCoeffs[3] = {coeffs.kr, coeffs.kg, coeffs.kb};
+  const Rec2408ToneMapper rec2408(intensityTarget, 250.f, 203.f, mCoeffs);
+  const LogarithmicToneMapper logarithmic(mCoeffs);
+  const FilmicToneMapper filmic;
+
+  // Filmic acts on every channel alone, for 8/10-bit it is folded into the linearization table.
+  // Rec2408 and ACES curves take a mix of channels, no per-code table holds them, and their
+  // rational curves on four lanes cost less than gathering from a luminance table would
+  const bool isFilmicFused = toneMapper == CurveToneMapper::FILMIC && bitDepth <= 10;
+
+  aligned_float_vector linearizeMap(maxCode + 1);
+  for (uint32_t j = 0; j <= maxCode; ++j) {
+    float linear = toLinear(static_cast<float>(j) / maxValue, intoLinear);
+    linearizeMap[j] = isFilmicFused ? filmic.map(linear) : linear;
+  }
+
+  // One extra entry lets interpolation at 1.0 read in bounds
+  aligned_float_vector gammaMap(kGammaTableSteps + 2);
+  for (uint32_t j = 0; j <= kGammaTableSteps; ++j) {
+    gammaMap[j] = toGamma(static_cast<float>(j) / static_cast<float>(kGammaTableSteps),
+                          intoGamma) * maxValue;
+  }
+  gammaMap[kGammaTableSteps + 1] = gammaMap[kGammaTableSteps];
+
+  auto encode = [&](float linear) -> T {
+    // fmax drops NaN from degenerate curves
+    float position = std::fmin(std::fmax(linear, 0.f), 1.f) * static_cast<float>(kGammaTableSteps);
+    auto index = static_cast<uint32_t>(position);
+    float fraction = position - static_cast<float>(index);
+    float value = gammaMap[index] + (gammaMap[index + 1] - gammaMap[index]) * fraction;
+    return static_cast<T>(std::clamp(std::roundf(value), 0.f, maxValue));
+  };
+
+  uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  if (threads != 0) {
+    hardwareThreads = std::min(hardwareThreads, threads);
+  }
+  const uint32_t threadCount = std::clamp(height / kMinRowsPerWorker, 1u, hardwareThreads);
+  // One planar row per worker instead of an allocation for every row
+  std::vector<aligned_float_vector> rowBuffers(threadCount,
+                                               aligned_float_vector(static_cast<size_t>(width) * 3));
+
+  concurrency::parallel_for_with_thread_id(
+      static_cast<int>(threadCount), static_cast<int>(height), [&](int threadId, int y) {
+        float *r = rowBuffers[threadId].data();
+        float *g = r + width;
+        float *b = g + width;
+        auto row = reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(inPlace)
+            + static_cast<size_t>(y) * stride);
+
+        for (uint32_t x = 0; x < width; ++x) {
+          r[x] = linearizeMap[std::min<uint32_t>(row[x * 4], maxCode)];
+          g[x] = linearizeMap[std::min<uint32_t>(row[x * 4 + 1], maxCode)];
+          b[x] = linearizeMap[std::min<uint32_t>(row[x * 4 + 2], maxCode)];
+        }
+
+        switch (toneMapper) {
+          case CurveToneMapper::REC2408:
+            rec2408.transferTone(r, g, b, width);
+            break;
+          case CurveToneMapper::LOGARITHMIC:
+            logarithmic.transferTone(r, g, b, width);
+            break;
+          case CurveToneMapper::FILMIC:
+            if (!isFilmicFused) {
+              filmic.transferTone(r, g, b, width);
+            }
+            break;
+          case CurveToneMapper::ACES:
+            AcesToneMapper::transferTone(r, g, b, width);
+            break;
+          default:
+            break;
+        }
+
+        applyMatrixPlanar(r, g, b, width, matrix);
+
+        for (uint32_t x = 0; x < width; ++x) {
+          row[x * 4] = encode(r[x]);
+          row[x * 4 + 1] = encode(g[x]);
+          row[x * 4 + 2] = encode(b[x]);
+        }
+      });
+}
 
 void applyColorMatrix(uint8_t *inPlace,
                       uint32_t stride,
@@ -44,95 +182,10 @@ void applyColorMatrix(uint8_t *inPlace,
                       TransferFunction intoGamma,
                       CurveToneMapper toneMapper,
                       ITURColorCoefficients coeffs,
-                      float intensityTarget) {
-  float c0 = matrix[0];
-  float c1 = matrix[1];
-  float c2 = matrix[2];
-  float c3 = matrix[3];
-  float c4 = matrix[4];
-  float c5 = matrix[5];
-  float c6 = matrix[6];
-  float c7 = matrix[7];
-  float c8 = matrix[8];
-
-  float linearizeMap[256] = {0};
-  for (uint32_t j = 0; j < 256; ++j) {
-    linearizeMap[j] = toLinear(static_cast<float>(j) * (1.f / 255.f), intoLinear);
-  }
-
-  uint8_t gammaMap[2049] = {0};
-  for (uint32_t j = 0; j < 2049; ++j) {
-    gammaMap[j] = static_cast<uint8_t >(std::clamp(
-        std::roundf(toGamma(static_cast<float>(j) * (1.f / 2048.f), intoGamma) * 255.f),
-        0.f,
-        255.f));
-  }
-
-  concurrency::parallel_for(6, height, [&](uint32_t y) {
-    aligned_float_vector rowVector(width * 3);
-    uint8_t *sourceRow = inPlace + y * stride;
-
-    float *rowData = rowVector.data();
-
-    for (uint32_t x = 0; x < width; ++x) {
-      rowData[0] = linearizeMap[sourceRow[0]];
-      rowData[1] = linearizeMap[sourceRow[1]];
-      rowData[2] = linearizeMap[sourceRow[2]];
-      rowData += 3;
-      sourceRow += 4;
-    }
-
-    float mCoeffs[3] = {coeffs.kr, coeffs.kg, coeffs.kb};
-    if (toneMapper == CurveToneMapper::REC2408) {
-      Rec2408ToneMapper mToneMapper(intensityTarget, 250.f, 203.f, mCoeffs);
-      mToneMapper.transferTone(rowVector.data(), width);
-    } else if (toneMapper == CurveToneMapper::LOGARITHMIC) {
-      LogarithmicToneMapper mToneMapper(mCoeffs);
-      mToneMapper.transferTone(rowVector.data(), width);
-    } else if (toneMapper == CurveToneMapper::FILMIC) {
-      FilmicToneMapper mToneMapper;
-      mToneMapper.transferTone(rowVector.data(), width);
-    } else if (toneMapper == CurveToneMapper::ACES) {
-      AcesToneMapper::transferTone(rowVector.data(), width);
-    }
-
-    float *iter = rowVector.data();
-
-    for (uint32_t x = 0; x < width; ++x) {
-      float r = iter[0];
-      float g = iter[1];
-      float b = iter[2];
-
-      float newR = r * c0 + g * c1 + b * c2;
-      float newG = r * c3 + g * c4 + b * c5;
-      float newB = r * c6 + g * c7 + b * c8;
-
-      iter[0] = newR;
-      iter[1] = newG;
-      iter[2] = newB;
-      iter += 3;
-    }
-
-    sourceRow = inPlace + y * stride;
-    iter = rowVector.data();
-
-    for (uint32_t x = 0; x < width; ++x) {
-      uint16_t scaledValue0 = std::min(
-          static_cast<uint16_t >(std::clamp(iter[0], 0.f, 1.0f) * 2048.f),
-          static_cast<uint16_t>(2048));
-      uint16_t scaledValue1 = std::min(
-          static_cast<uint16_t >(std::clamp(iter[1], 0.f, 1.0f) * 2048.f),
-          static_cast<uint16_t>(2048));
-      uint16_t scaledValue2 = std::min(
-          static_cast<uint16_t >(std::clamp(iter[2], 0.f, 1.0f) * 2048.f),
-          static_cast<uint16_t>(2048));
-      sourceRow[0] = gammaMap[scaledValue0];
-      sourceRow[1] = gammaMap[scaledValue1];
-      sourceRow[2] = gammaMap[scaledValue2];
-      sourceRow += 4;
-      iter += 3;
-    }
-  });
+                      float intensityTarget,
+                      uint32_t threads) {
+  toneMapImage(inPlace, stride, width, height, 8, matrix, intoLinear, intoGamma,
+               toneMapper, coeffs, intensityTarget, threads);
 }
 
 void applyColorMatrix16Bit(uint16_t *inPlace,
@@ -145,101 +198,50 @@ void applyColorMatrix16Bit(uint16_t *inPlace,
                            TransferFunction intoGamma,
                            CurveToneMapper toneMapper,
                            ITURColorCoefficients coeffs,
-                           float intensityTarget) {
-
-  float c0 = matrix[0];
-  float c1 = matrix[1];
-  float c2 = matrix[2];
-  float c3 = matrix[3];
-  float c4 = matrix[4];
-  float c5 = matrix[5];
-  float c6 = matrix[6];
-  float c7 = matrix[7];
-  float c8 = matrix[8];
-
-  uint32_t maxColors = 1 << bitDepth;
-  uint16_t iCutOff = maxColors - 1;
-  float cutOffColors = static_cast<float>(maxColors) - 1;
-  float scaleCutOff = 1.f / cutOffColors;
-
-  aligned_float_vector linearizeMap(maxColors);
-  for (uint32_t j = 0; j < maxColors; ++j) {
-    linearizeMap[j] = toLinear(static_cast<float>(j) * scaleCutOff, intoLinear);
-  }
-
-  aligned_uint16_vector gammaMap(maxColors);
-  for (uint32_t j = 0; j < maxColors; ++j) {
-    gammaMap[j] = static_cast<uint16_t >(std::clamp(
-        std::roundf(toGamma(static_cast<float>(j) * scaleCutOff, intoGamma) * cutOffColors),
-        0.f,
-        cutOffColors));
-  }
-
-  concurrency::parallel_for(6, height, [&](uint32_t y) {
-    aligned_float_vector rowVector(width * 3);
-    auto sourceRow =
-        reinterpret_cast<uint16_t *>(reinterpret_cast<uint8_t * >(inPlace) + y * stride);
-
-    float *rowData = rowVector.data();
-
-    for (uint32_t x = 0; x < width; ++x) {
-      rowData[0] = linearizeMap[std::min(sourceRow[0], iCutOff)];
-      rowData[1] = linearizeMap[std::min(sourceRow[1], iCutOff)];
-      rowData[2] = linearizeMap[std::min(sourceRow[2], iCutOff)];
-      rowData += 3;
-      sourceRow += 4;
-    }
+                           float intensityTarget,
+                           uint32_t threads) {
+  toneMapImage(inPlace, stride, width, height, bitDepth, matrix, intoLinear, intoGamma,
+               toneMapper, coeffs, intensityTarget, threads);
+}
 
-    float mCoeffs[3] = {coeffs.kr, coeffs.kg, coeffs.kb};
-    if (toneMapper == CurveToneMapper::REC2408) {
-      Rec2408ToneMapper mToneMapper(intensityTarget, 250.f, 203.f, mCoeffs);
-      mToneMapper.transferTone(rowVector.data(), width);
-    } else if (toneMapper == CurveToneMapper::LOGARITHMIC) {
-      LogarithmicToneMapper mToneMapper(mCoeffs);
-      mToneMapper.transferTone(rowVector.data(), width);
-    } else if (toneMapper == CurveToneMapper::FILMIC) {
-      FilmicToneMapper mToneMapper;
-      mToneMapper.transferTone(rowVector.data(), width);
-    } else if (toneMapper == CurveToneMapper::ACES) {
-      AcesToneMapper::transferTone(rowVector.data(), width);
+void toneMapWithCurve(uint8_t *data,
+                      uint32_t stride,
+                      uint32_t width,
+                      uint32_t height,
+                      bool is16Bit,
+                      uint32_t bitDepth,
+                      const float primaries[6],
+                      const float whitePoint[2],
+                      TransferFunction intoLinear,
+                      CurveToneMapper toneMapper,
+                      float intensityTarget,
+                      uint32_t threads) {
+  Eigen::Matrix<float, 3, 2> sourcePrimaries;
+  sourcePrimaries << primaries[0], primaries[1],
+      primaries[2], primaries[3],
+      primaries[4], primaries[5];
+  Eigen::Vector2f sourceWhitePoint;
+  sourceWhitePoint << whitePoint[0], whitePoint[1];
+
+  Eigen::Matrix3f destinationProfile = GamutRgbToXYZ(getSRGBPrimaries(), getIlluminantD65());
+  Eigen::Matrix3f sourceProfile = GamutRgbToXYZ(sourcePrimaries, sourceWhitePoint);
+  Eigen::Matrix3f conversion = destinationProfile.inverse() * sourceProfile;
+
+  float matrix[9];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      matrix[i * 3 + j] = conversion(i, j);
     }
+  }
 
-    float *iter = rowVector.data();
-
-    for (uint32_t x = 0; x < width; ++x) {
-      float r = iter[0];
-      float g = iter[1];
-      float b = iter[2];
-
-      float newR = r * c0 + g * c1 + b * c2;
-      float newG = r * c3 + g * c4 + b * c5;
-      float newB = r * c6 + g * c7 + b * c8;
-
-      iter[0] = newR;
-      iter[1] = newG;
-      iter[2] = newB;
-      iter += 3;
-    }
+  ITURColorCoefficients coeffs = colorPrimariesComputeYCoeffs(sourcePrimaries, sourceWhitePoint);
 
-    sourceRow = reinterpret_cast<uint16_t *>(reinterpret_cast<uint8_t * >(inPlace) + y * stride);
-    iter = rowVector.data();
-
-    for (uint32_t x = 0; x < width; ++x) {
-      uint16_t scaledValue0 = std::min(
-          static_cast<uint16_t >(std::clamp(iter[0], 0.f, 1.0f) * cutOffColors),
-          static_cast<uint16_t>(cutOffColors));
-      uint16_t scaledValue1 = std::min(
-          static_cast<uint16_t >(std::clamp(iter[1], 0.f, 1.0f) * cutOffColors),
-          static_cast<uint16_t>(cutOffColors));
-      uint16_t scaledValue2 = std::min(
-          static_cast<uint16_t >(std::clamp(iter[2], 0.f, 1.0f) * cutOffColors),
-          static_cast<uint16_t>(cutOffColors));
-
-      sourceRow[0] = gammaMap[scaledValue0];
-      sourceRow[1] = gammaMap[scaledValue1];
-      sourceRow[2] = gammaMap[scaledValue2];
-      sourceRow += 4;
-      iter += 3;
-    }
-  });
-}
\ No newline at end of file
+  if (is16Bit) {
+    applyColorMatrix16Bit(reinterpret_cast<uint16_t *>(data), stride, width, height,
+                          static_cast<uint8_t>(bitDepth), matrix, intoLinear,
+                          TransferFunction::Srgb, toneMapper, coeffs, intensityTarget, threads);
+  } else {
+    applyColorMatrix(data, stride, width, height, matrix, intoLinear,
+                     TransferFunction::Srgb, toneMapper, coeffs, intensityTarget, threads);
+  }
+}
@@ -35,6 +35,11 @@
 #include "ToneMapper.h"
 #include "ITUR.h"
 
+/**
+ * Tone maps RGBA image in place: linearizes with intoLinear, applies the curve,
+ * converts gamut with row-major 3x3 matrix and encodes with intoGamma, alpha is kept.
+ * At most threads workers are used, 0 lets it use every core
+ */
 void applyColorMatrix(uint8_t *inPlace,
                       uint32_t stride,
                       uint32_t width,
@@ -44,7 +49,8 @@ void applyColorMatrix(uint8_t *inPlace,
                       TransferFunction intoGamma,
                       CurveToneMapper toneMapper,
                       ITURColorCoefficients coeffs,
-                      float intensityTarget);
+                      float intensityTarget,
+                      uint32_t threads = 0);
 
 void applyColorMatrix16Bit(uint16_t *inPlace,
                            uint32_t stride,
@@ -55,6 +61,24 @@ void applyColorMatrix16Bit(uint16_t *inPlace,
                            TransferFunction intoLinear,
                            TransferFunction intoGamma,
                            CurveToneMapper toneMapper,
-                           ITURColorCoefficients coeffs, float intensityTarget);
+                           ITURColorCoefficients coeffs, float intensityTarget,
+                           uint32_t threads = 0);
+
+/**
+ * Brings PQ or HLG RGBA image with the given xy primaries and white point into sRGB
+ * using one of the curves from ToneMapper.h
+ */
+void toneMapWithCurve(uint8_t *data,
+                      uint32_t stride,
+                      uint32_t width,
+                      uint32_t height,
+                      bool is16Bit,
+                      uint32_t bitDepth,
+                      const float primaries[6],
+                      const float whitePoint[2],
+                      TransferFunction intoLinear,
+                      CurveToneMapper toneMapper,
+                      float intensityTarget,
+                      uint32_t threads = 0);
 
 #endif //AVIF_COLORMATRIX_H
@@ -28,19 +28,38 @@
 
 
 #include "FilmicToneMapper.h"
-#include "Oklab.hpp"
+#include "VectorF32.h"
 
-void FilmicToneMapper::transferTone(float *inPlace, uint32_t width) {
-  float *targetPlace = inPlace;
+void FilmicToneMapper::transferChannel(float *channel, uint32_t width) const {
+  uint32_t x = 0;
 
-  for (uint32_t x = 0; x < width; ++x) {
-    float r = targetPlace[0];
-    float g = targetPlace[1];
-    float b = targetPlace[2];
+#if HAVE_VECTOR_F32
+  using namespace coder::simd;
+  const F32x4 vA = Splat(A);
+  const F32x4 vCB = Splat(C * B);
+  const F32x4 vB = Splat(B);
+  const F32x4 vDE = Splat(D * E);
+  const F32x4 vDF = Splat(D * F);
+  const F32x4 vEF = Splat(E / F);
+  const F32x4 vExposure = Splat(exposure_bias);
+  const F32x4 vWhiteScale = Splat(whiteScale);
+  const F32x4 vOne = Splat(1.f);
+  for (; x + 4 <= width; x += 4) {
+    F32x4 v = Mul(Load(channel + x), vExposure);
+    F32x4 numerator = MulAdd(v, MulAdd(vA, v, vCB), vDE);
+    F32x4 denominator = MulAdd(v, MulAdd(vA, v, vB), vDF);
+    F32x4 partial = Sub(Div(numerator, denominator), vEF);
+    Store(channel + x, Min(Mul(partial, vWhiteScale), vOne));
+  }
+#endif
 
-    targetPlace[0] = std::min(FilmicToneMapper::uncharted2_filmic(r), 1.f);
-    targetPlace[1] = std::min(FilmicToneMapper::uncharted2_filmic(g), 1.f);
-    targetPlace[2] = std::min(FilmicToneMapper::uncharted2_filmic(b), 1.f);
-    targetPlace += 3;
+  for (; x < width; ++x) {
+    channel[x] = map(channel[x]);
   }
-}
\ No newline at end of file
+}
+
+void FilmicToneMapper::transferTone(float *r, float *g, float *b, uint32_t width) const {
+  transferChannel(r, width);
+  transferChannel(g, width);
+  transferChannel(b, width);
+}
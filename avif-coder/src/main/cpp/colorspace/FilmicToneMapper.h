@@ -29,36 +29,41 @@
 #ifndef AVIF_FILMIC_TONEMAPPER_H_
 #define AVIF_FILMIC_TONEMAPPER_H_
 
-#include <vector>
+#include <algorithm>
+#include <cstdint>
 
 class FilmicToneMapper {
  public:
   FilmicToneMapper() {
+    whiteScale = 1.0f / uncharted2_tonemap_partial(W);
   }
 
-  void transferTone(float *inPlace, uint32_t width);
+  /**
+   * Curve works on every channel alone, so it may be folded into a per-channel table
+   */
+  float map(float v) const {
+    return std::min(uncharted2_tonemap_partial(v * exposure_bias) * whiteScale, 1.f);
+  }
 
- private:
+  void transferTone(float *r, float *g, float *b, uint32_t width) const;
 
-  float uncharted2_tonemap_partial(float x) {
-    float A = 0.15f;
-    float B = 0.50f;
-    float C = 0.10f;
-    float D = 0.20f;
-    float E = 0.02f;
-    float F = 0.30f;
-    return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
-  }
+ private:
+  static constexpr float A = 0.15f;
+  static constexpr float B = 0.50f;
+  static constexpr float C = 0.10f;
+  static constexpr float D = 0.20f;
+  static constexpr float E = 0.02f;
+  static constexpr float F = 0.30f;
+  static constexpr float W = 11.2f;
+  static constexpr float exposure_bias = 2.0f;
 
-  float uncharted2_filmic(float v) {
-    float exposure_bias = 2.0f;
-    float curr = uncharted2_tonemap_partial(v * exposure_bias);
+  float whiteScale = 1.f;
 
-    float W = 11.2f;
-    float white_scale = 1.0f / uncharted2_tonemap_partial(W);
-    return curr * white_scale;
+  static float uncharted2_tonemap_partial(float x) {
+    return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
   }
 
+  void transferChannel(float *channel, uint32_t width) const;
 };
 
 #endif //AVIF_FILMIC_TONEMAPPER_H_
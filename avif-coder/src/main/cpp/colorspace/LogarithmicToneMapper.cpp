@@ -29,26 +29,17 @@
 #include "LogarithmicToneMapper.h"
 #include "Oklab.hpp"
 
-void LogarithmicToneMapper::transferTone(float *inPlace, uint32_t width) {
-  float *targetPlace = inPlace;
-
-  const float vDen = this->den;
-
+void LogarithmicToneMapper::transferTone(float *r, float *g, float *b, uint32_t width) const {
+  // Oklab round trip needs cbrt, it stays scalar, the log curve comes from the response table
   for (uint32_t x = 0; x < width; ++x) {
-    float r = targetPlace[0];
-    float g = targetPlace[1];
-    float b = targetPlace[2];
-    coder::Oklab oklab = coder::Oklab::fromLinearRGB(r, g, b);
+    coder::Oklab oklab = coder::Oklab::fromLinearRGB(r[x], g[x], b[x]);
     if (oklab.L == 0) {
       continue;
     }
-    float Lout = std::logf(std::abs(1.f + oklab.L)) * vDen;
-    float shScale = Lout / oklab.L;
-    oklab.L = oklab.L * shScale;
+    oklab.L = oklab.L * responseAt(oklab.L);
     coder::Rgb linearRgb = oklab.toLinearRGB();
-    targetPlace[0] = std::min(linearRgb.r, 1.f);
-    targetPlace[1] = std::min(linearRgb.g, 1.f);
-    targetPlace[2] = std::min(linearRgb.b, 1.f);
-    targetPlace += 3;
+    r[x] = std::min(linearRgb.r, 1.f);
+    g[x] = std::min(linearRgb.g, 1.f);
+    b[x] = std::min(linearRgb.b, 1.f);
   }
-}
\ No newline at end of file
+}
@@ -29,7 +29,9 @@
 #ifndef AVIF_LOGARITHMICTONEMAPPER_H
 #define AVIF_LOGARITHMICTONEMAPPER_H
 
-#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 
 class LogarithmicToneMapper {
 public:
@@ -39,13 +41,41 @@ public:
         float Lmax = 1;
         float exposure = 1.f;
         den = static_cast<float>(1) / log(static_cast<float>(1 + Lmax * exposure));
+
+        for (uint32_t i = 0; i < kResponseSize; ++i) {
+            float L = static_cast<float>(i) * (kResponseRange / static_cast<float>(kResponseSize - 1));
+            response[i] = exactResponse(L);
+        }
     }
 
-    void transferTone(float *inPlace, uint32_t width);
+    void transferTone(float *r, float *g, float *b, uint32_t width) const;
 
 private:
+    /** Oklab L of PQ content reaches ~3.7, HLG ~1.7, anything above falls back to logf */
+    static constexpr uint32_t kResponseSize = 1024;
+    static constexpr float kResponseRange = 4.f;
+
     float lumaPrimaries[3] = {0};
     float den;
+    /** Lout / L sampled over [0, kResponseRange] */
+    float response[kResponseSize] = {0};
+
+    float exactResponse(float L) const {
+        if (L == 0) {
+            return den;
+        }
+        return std::log(std::abs(1.f + L)) * den / L;
+    }
+
+    float responseAt(float L) const {
+        if (L < 0 || L >= kResponseRange) {
+            return exactResponse(L);
+        }
+        float position = L * (static_cast<float>(kResponseSize - 1) / kResponseRange);
+        auto index = std::min(static_cast<uint32_t>(position), kResponseSize - 2);
+        float fraction = position - static_cast<float>(index);
+        return response[index] + (response[index + 1] - response[index]) * fraction;
+    }
 };
 
 
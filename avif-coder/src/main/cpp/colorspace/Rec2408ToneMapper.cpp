@@ -29,6 +29,8 @@
 #include "Rec2408ToneMapper.h"
 #include "Trc.h"
 #include "Oklab.hpp"
+#include "VectorF32.h"
+#include <algorithm>
 
 float rec2408_pq(float intensity, const float intensity_target) {
   // Lb, Lw, Lmin, Lmax
@@ -78,25 +80,37 @@ float rec2408_pq(float intensity, const float intensity_target) {
   return normalized_target_pq_sample * source_pq_diff + luminances[0];
 }
 
-void Rec2408ToneMapper::transferTone(float *inPlace, uint32_t width) {
-  float *targetPlace = inPlace;
+void Rec2408ToneMapper::transferTone(float *r, float *g, float *b, uint32_t width) const {
+  const float kr = lumaPrimaries[0];
+  const float kg = lumaPrimaries[1];
+  const float kb = lumaPrimaries[2];
+  uint32_t x = 0;
 
-  const float vWeightA = this->weightA;
-  const float vWeightB = this->weightB;
+#if HAVE_VECTOR_F32
+  using namespace coder::simd;
+  const F32x4 vKr = Splat(kr);
+  const F32x4 vKg = Splat(kg);
+  const F32x4 vKb = Splat(kb);
+  const F32x4 vWeightA = Splat(weightA);
+  const F32x4 vWeightB = Splat(weightB);
+  const F32x4 vOne = Splat(1.f);
+  for (; x + 4 <= width; x += 4) {
+    F32x4 vr = Load(r + x);
+    F32x4 vg = Load(g + x);
+    F32x4 vb = Load(b + x);
+    F32x4 inLight = MulAdd(vb, vKb, MulAdd(vg, vKg, Mul(vr, vKr)));
+    F32x4 scale = Div(MulAdd(vWeightA, inLight, vOne), MulAdd(vWeightB, inLight, vOne));
+    Store(r + x, Min(Mul(vr, scale), vOne));
+    Store(g + x, Min(Mul(vg, scale), vOne));
+    Store(b + x, Min(Mul(vb, scale), vOne));
+  }
+#endif
 
-  for (uint32_t x = 0; x < width; ++x) {
-    float r = targetPlace[0];
-    float g = targetPlace[1];
-    float b = targetPlace[2];
-    float inLight = 0.2627f * static_cast<float>(r) + 0.6780f * static_cast<float>(g)
-        + 0.0593f * static_cast<float>(b);
-    if (inLight == 0) {
-      continue;
-    }
-    float scale = (1.f + vWeightA * inLight) / (1.f + vWeightB * inLight);
-    targetPlace[0] = std::min(r * scale, 1.f);
-    targetPlace[1] = std::min(g * scale, 1.f);
-    targetPlace[2] = std::min(b * scale, 1.f);
-    targetPlace += 3;
+  for (; x < width; ++x) {
+    float inLight = kr * r[x] + kg * g[x] + kb * b[x];
+    float scale = (1.f + weightA * inLight) / (1.f + weightB * inLight);
+    r[x] = std::min(r[x] * scale, 1.f);
+    g[x] = std::min(g[x] * scale, 1.f);
+    b[x] = std::min(b[x] * scale, 1.f);
   }
-}
\ No newline at end of file
+}
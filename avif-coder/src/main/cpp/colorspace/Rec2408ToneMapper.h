@@ -44,7 +44,10 @@ public:
         this->weightB = 1.0f / (displayMaxBrightness / whitePoint);
     }
 
-    void transferTone(float *inPlace, uint32_t width);
+    /**
+     * Scales linear planar row by its luminance response, luma weights are the ones from constructor
+     */
+    void transferTone(float *r, float *g, float *b, uint32_t width) const;
 
 private:
     float lumaPrimaries[3] = {0};
@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef AVIF_VECTORF32_H_
+#define AVIF_VECTORF32_H_
+
+#if HAVE_NEON
+#include <arm_neon.h>
+#define HAVE_VECTOR_F32 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_VECTOR_F32 1
+#endif
+
+#if HAVE_VECTOR_F32
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Four float lanes over NEON or SSE2, the baselines of arm64 and x86 Android ABIs.
+ * AVX2 is not guaranteed on Android x86_64, so wider vectors would need runtime dispatch
+ */
+namespace coder::simd {
+
+#if HAVE_NEON
+typedef float32x4_t F32x4;
+
+static inline F32x4 Load(const float *src) { return vld1q_f32(src); }
+/** Widens four 8-bit lanes */
+static inline F32x4 Load(const uint8_t *src) {
+  uint32_t packed;
+  memcpy(&packed, src, sizeof(packed));
+  uint16x8_t words = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(packed)));
+  return vcvtq_f32_u32(vmovl_u16(vget_low_u16(words)));
+}
+/** Widens four 16-bit lanes */
+static inline F32x4 Load(const uint16_t *src) { return vcvtq_f32_u32(vmovl_u16(vld1_u16(src))); }
+static inline void Store(float *dst, F32x4 v) { vst1q_f32(dst, v); }
+static inline F32x4 Splat(float v) { return vdupq_n_f32(v); }
+static inline F32x4 Add(F32x4 a, F32x4 b) { return vaddq_f32(a, b); }
+static inline F32x4 Sub(F32x4 a, F32x4 b) { return vsubq_f32(a, b); }
+static inline F32x4 Mul(F32x4 a, F32x4 b) { return vmulq_f32(a, b); }
+static inline F32x4 Div(F32x4 a, F32x4 b) { return vdivq_f32(a, b); }
+static inline F32x4 Min(F32x4 a, F32x4 b) { return vminq_f32(a, b); }
+static inline F32x4 Max(F32x4 a, F32x4 b) { return vmaxq_f32(a, b); }
+/** a * b + c */
+static inline F32x4 MulAdd(F32x4 a, F32x4 b, F32x4 c) { return vfmaq_f32(c, a, b); }
+#else
+typedef __m128 F32x4;
+
+static inline F32x4 Load(const float *src) { return _mm_loadu_ps(src); }
+/** Widens four 8-bit lanes */
+static inline F32x4 Load(const uint8_t *src) {
+  int32_t packed;
+  memcpy(&packed, src, sizeof(packed));
+  __m128i zero = _mm_setzero_si128();
+  __m128i bytes = _mm_cvtsi32_si128(packed);
+  return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+/** Widens four 16-bit lanes */
+static inline F32x4 Load(const uint16_t *src) {
+  __m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+  return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, _mm_setzero_si128()));
+}
+static inline void Store(float *dst, F32x4 v) { _mm_storeu_ps(dst, v); }
+static inline F32x4 Splat(float v) { return _mm_set1_ps(v); }
+static inline F32x4 Add(F32x4 a, F32x4 b) { return _mm_add_ps(a, b); }
+static inline F32x4 Sub(F32x4 a, F32x4 b) { return _mm_sub_ps(a, b); }
+static inline F32x4 Mul(F32x4 a, F32x4 b) { return _mm_mul_ps(a, b); }
+static inline F32x4 Div(F32x4 a, F32x4 b) { return _mm_div_ps(a, b); }
+static inline F32x4 Min(F32x4 a, F32x4 b) { return _mm_min_ps(a, b); }
+static inline F32x4 Max(F32x4 a, F32x4 b) { return _mm_max_ps(a, b); }
+/** a * b + c */
+static inline F32x4 MulAdd(F32x4 a, F32x4 b, F32x4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#endif
+
+}
+
+#endif
+
+#endif //AVIF_VECTORF32_H_
@@ -38,26 +38,31 @@ void
 convertUseICC(aligned_uint8_vector &vector, uint32_t stride, uint32_t width, uint32_t height,
               const unsigned char *colorSpace, size_t colorSpaceSize,
               bool image16Bits, uint16_t bitDepth) {
-  aligned_uint8_vector target(vector.size());
+  convertUseICC(vector.data(), stride, width, height, colorSpace, colorSpaceSize,
+                image16Bits, bitDepth);
+}
+
+void
+convertUseICC(uint8_t *data, uint32_t stride, uint32_t width, uint32_t height,
+              const unsigned char *colorSpace, size_t colorSpaceSize,
+              bool image16Bits, uint16_t bitDepth, uint32_t threads) {
+  // Transformed row by row in place, so no second full-size frame is held at peak
   if (image16Bits) {
-    apply_icc_rgba16(reinterpret_cast<uint16_t *>(vector.data()),
-                     stride,
-                     reinterpret_cast<uint16_t *>(target.data()),
-                     stride,
-                     bitDepth,
-                     width,
-                     height,
-                     colorSpace,
-                     colorSpaceSize);
+    apply_icc_in_place_rgba16(reinterpret_cast<uint16_t *>(data),
+                              stride,
+                              bitDepth,
+                              width,
+                              height,
+                              colorSpace,
+                              colorSpaceSize,
+                              threads);
   } else {
-    apply_icc_rgba8(vector.data(),
-                    stride,
-                    target.data(),
-                    stride,
-                    width,
-                    height,
-                    colorSpace,
-                    colorSpaceSize);
+    apply_icc_in_place_rgba8(data,
+                             stride,
+                             width,
+                             height,
+                             colorSpace,
+                             colorSpaceSize,
+                             threads);
   }
-  vector = std::move(target);
 }
@@ -37,4 +37,13 @@ convertUseICC(aligned_uint8_vector &vector, uint32_t stride, uint32_t width, uin
               const unsigned char *colorSpace, size_t colorSpaceSize,
               bool image16Bits, uint16_t bitDepth);
 
+/**
+ * Same as above for a part of a bigger image, e.g. one grid tile on the canvas.
+ * At most threads workers are used, 0 lets the transform use every core
+ */
+void
+convertUseICC(uint8_t *data, uint32_t stride, uint32_t width, uint32_t height,
+              const unsigned char *colorSpace, size_t colorSpaceSize,
+              bool image16Bits, uint16_t bitDepth, uint32_t threads = 0);
+
 #endif //AVIF_COLORSPACE_H
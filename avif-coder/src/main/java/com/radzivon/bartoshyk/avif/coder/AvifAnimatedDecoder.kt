@@ -31,6 +31,7 @@ package com.radzivon.bartoshyk.avif.coder
 import android.annotation.SuppressLint
 import android.graphics.Bitmap
 import android.os.Build
+import android.os.ParcelFileDescriptor
 import android.util.Size
 import androidx.annotation.Keep
 import java.io.Closeable
@@ -62,6 +63,14 @@ class AvifAnimatedDecoder : Closeable {
         nativeController = createControllerFromByteBuffer(source)
     }
 
+    /**
+     * File is memory mapped and frames are read from it on demand, descriptor may be closed
+     * right after construction
+     */
+    constructor(source: ParcelFileDescriptor) {
+        nativeController = createControllerFromFd(source.fd)
+    }
+
     var toneMapper: ToneMapper = ToneMapper.REC2408
 
     private var nativeController: Long = -1
@@ -171,6 +180,7 @@ class AvifAnimatedDecoder : Closeable {
     private external fun destroy(ptr: Long)
     private external fun createControllerFromByteArray(byteArray: ByteArray): Long
     private external fun createControllerFromByteBuffer(byteBuffer: ByteBuffer): Long
+    private external fun createControllerFromFd(fd: Int): Long
     private external fun getFramesCount(ptr: Long): Int
     private external fun getLoopsCountImpl(ptr: Long): Int
     private external fun getTotalDurationImpl(ptr: Long): Int
@@ -0,0 +1,199 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+package com.radzivon.bartoshyk.avif.coder
+
+import android.annotation.SuppressLint
+import android.graphics.Bitmap
+import android.os.Build
+import android.util.Size
+import androidx.annotation.Keep
+import java.io.Closeable
+import java.nio.ByteBuffer
+
+/**
+ * Decodes AVIF while it is still being downloaded.
+ *
+ * Feed bytes with [append] as they arrive and call [finish] after the last chunk. Grid images
+ * are decoded cell by cell, so [getFrame] may be called at any moment after the header is
+ * available to display top rows that are already decoded, the rest of the frame is transparent.
+ *
+ * @param expectedSize total size of the source when known, e.g. from Content-Length, 0 otherwise
+ * @throws Exception - All functions in this class may throw if something goes wrong
+ */
+@Keep
+@SuppressLint("ObsoleteSdkInt")
+class AvifStreamingDecoder(expectedSize: Long = 0) : Closeable {
+
+    init {
+        if (Build.VERSION.SDK_INT >= 24) {
+            System.loadLibrary("coder")
+        }
+    }
+
+    private var nativeController: Long = createStreamingController(expectedSize)
+    private val lock = Any()
+
+    /**
+     * @return count of top rows that are ready to display
+     */
+    fun append(bytes: ByteArray, offset: Int = 0, length: Int = bytes.size - offset): Int {
+        synchronized(lock) {
+            checkInitialized()
+            return appendImpl(nativeController, bytes, offset, length)
+        }
+    }
+
+    /**
+     * Consumes remaining bytes of direct [ByteBuffer]
+     *
+     * @return count of top rows that are ready to display
+     */
+    fun append(byteBuffer: ByteBuffer): Int {
+        synchronized(lock) {
+            checkInitialized()
+            val rows = appendBufferImpl(
+                nativeController,
+                byteBuffer,
+                byteBuffer.position(),
+                byteBuffer.remaining()
+            )
+            byteBuffer.position(byteBuffer.limit())
+            return rows
+        }
+    }
+
+    /**
+     * Signals that whole source was appended, throws if it was truncated
+     *
+     * @return count of decoded rows, equals to image height
+     */
+    fun finish(): Int {
+        synchronized(lock) {
+            checkInitialized()
+            return finishImpl(nativeController)
+        }
+    }
+
+    fun getDecodedRows(): Int {
+        synchronized(lock) {
+            checkInitialized()
+            return getDecodedRowsImpl(nativeController)
+        }
+    }
+
+    fun isComplete(): Boolean {
+        synchronized(lock) {
+            checkInitialized()
+            return isCompleteImpl(nativeController)
+        }
+    }
+
+    /**
+     * @return image size or null when header wasn't received yet
+     */
+    fun getImageSize(): Size? {
+        synchronized(lock) {
+            checkInitialized()
+            return getSizeImpl(nativeController)
+        }
+    }
+
+    /**
+     * @return current state of the image or null when header wasn't received yet
+     */
+    fun getFrame(
+        scaledWidth: Int = 0,
+        scaledHeight: Int = 0,
+        preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
+        scaleMode: ScaleMode = ScaleMode.FIT,
+        scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
+    ): Bitmap? {
+        synchronized(lock) {
+            checkInitialized()
+            return getFrameImpl(
+                nativeController,
+                scaledWidth,
+                scaledHeight,
+                preferredColorConfig.value,
+                scaleMode.value,
+                scaleQuality.level,
+                toneMapper.value,
+            )
+        }
+    }
+
+    private fun checkInitialized() {
+        if (nativeController == -1L) {
+            throw IllegalStateException("Streaming decoder wasn't properly initialized")
+        }
+    }
+
+    protected fun finalize() {
+        synchronized(lock) {
+            if (nativeController != -1L) {
+                destroy(nativeController)
+                nativeController = -1L
+            }
+        }
+    }
+
+    override fun close() {
+        synchronized(lock) {
+            if (nativeController != -1L) {
+                destroy(nativeController)
+                nativeController = -1L
+            }
+        }
+    }
+
+    private external fun createStreamingController(expectedSize: Long): Long
+    private external fun destroy(ptr: Long)
+    private external fun appendImpl(ptr: Long, bytes: ByteArray, offset: Int, length: Int): Int
+    private external fun appendBufferImpl(
+        ptr: Long,
+        byteBuffer: ByteBuffer,
+        position: Int,
+        length: Int
+    ): Int
+
+    private external fun finishImpl(ptr: Long): Int
+    private external fun getDecodedRowsImpl(ptr: Long): Int
+    private external fun isCompleteImpl(ptr: Long): Boolean
+    private external fun getSizeImpl(ptr: Long): Size?
+    private external fun getFrameImpl(
+        ptr: Long,
+        scaledWidth: Int,
+        scaledHeight: Int,
+        preferredColorConfig: Int,
+        scaleMode: Int,
+        scaleQuality: Int,
+        toneMapper: Int,
+    ): Bitmap?
+}
@@ -32,9 +32,13 @@ package com.radzivon.bartoshyk.avif.coder
 
 import android.annotation.SuppressLint
 import android.graphics.Bitmap
+import android.graphics.Rect
 import android.os.Build
+import android.os.ParcelFileDescriptor
 import android.util.Size
 import androidx.annotation.Keep
+import java.io.File
+import java.io.InputStream
 import java.nio.ByteBuffer
 
 @Keep
@@ -56,13 +60,66 @@ class HeifCoder {
         return isSupportedImageImplBB(byteBuffer)
     }
 
+    fun getImageType(byteArray: ByteArray): HeifImageType {
+        return HeifImageType.fromPacked(getImageTypeImpl(byteArray))
+    }
+
+    fun getImageType(byteBuffer: ByteBuffer): HeifImageType {
+        return HeifImageType.fromPacked(getImageTypeImplBB(byteBuffer))
+    }
+
+    /**
+     * Reads at most a few hundred bytes, stream is rewound when it supports mark,
+     * otherwise those bytes are consumed
+     */
+    fun getImageType(stream: InputStream): HeifImageType {
+        val markSupported = stream.markSupported()
+        if (markSupported) {
+            stream.mark(HeifImageType.SNIFF_LENGTH)
+        }
+        val prefix = ByteArray(HeifImageType.SNIFF_LENGTH)
+        var read = 0
+        try {
+            while (read < prefix.size) {
+                val count = stream.read(prefix, read, prefix.size - read)
+                if (count < 0) break
+                read += count
+            }
+        } finally {
+            if (markSupported) {
+                stream.reset()
+            }
+        }
+        return getImageType(if (read == prefix.size) prefix else prefix.copyOf(read))
+    }
+
+    /**
+     * Classifies many sources in a single native call
+     */
+    fun getImageTypes(sources: List<ByteArray>): List<HeifImageType> {
+        return getImageTypesImpl(sources.toTypedArray()).map { HeifImageType.fromPacked(it) }
+    }
+
+    /**
+     * Hits and misses of the ICC transform cache shared by all decoders in the process
+     */
+    fun getIccTransformCacheStats(): IccTransformCacheStats {
+        val counters = getIccTransformCacheStatsImpl()
+        return IccTransformCacheStats(hits = counters[0], misses = counters[1])
+    }
+
     fun getSize(bytes: ByteArray): Size? {
         return getSizeImpl(bytes)
     }
 
+    /**
+     * Decodes primary image at its own size. AVIF frames go from YUV into the bitmap format
+     * in bounded bands of rows, HEIF images are still converted through a full size RGBA frame.
+     */
     fun decode(
         byteArray: ByteArray,
-        preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT
+        preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
     ): Bitmap {
         return decodeImpl(
             byteArray,
@@ -71,9 +128,16 @@ class HeifCoder {
             preferredColorConfig.value,
             ScaleMode.FIT.value,
             ScalingQuality.DEFAULT.level,
+            toneMapper.value,
         )
     }
 
+    /**
+     * Decodes primary image scaled to [scaledWidth] x [scaledHeight] with [scaleMode].
+     * Only AVIF frames that keep their size, or are reduced in YUV to exactly the target size,
+     * are converted in bounded bands of rows; HEIF images and frames the resampler scales or crops
+     * are still converted through a full size RGBA frame first.
+     */
     fun decodeSampled(
         byteArray: ByteArray,
         scaledWidth: Int,
@@ -81,6 +145,7 @@ class HeifCoder {
         preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
         scaleMode: ScaleMode = ScaleMode.FIT,
         scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
     ): Bitmap {
         return decodeImpl(
             byteArray,
@@ -89,9 +154,13 @@ class HeifCoder {
             preferredColorConfig.value,
             scaleMode.value,
             scaleQuality.level,
+            toneMapper.value,
         )
     }
 
+    /**
+     * Same as [decodeSampled] for image held in [byteBuffer]
+     */
     fun decodeSampled(
         byteBuffer: ByteBuffer,
         scaledWidth: Int,
@@ -99,6 +168,7 @@ class HeifCoder {
         preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
         scaleMode: ScaleMode = ScaleMode.FIT,
         scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
     ): Bitmap {
         return decodeByteBufferImpl(
             byteBuffer,
@@ -107,9 +177,184 @@ class HeifCoder {
             preferredColorConfig.value,
             scaleMode.value,
             scaleQuality.level,
+            toneMapper.value,
         )
     }
 
+    /**
+     * Decodes only [rect] of the image, color conversion and color management run over
+     * the region alone, then it is scaled as [decodeSampled] does.
+     * Rect is in image pixels and must lie within the image.
+     */
+    fun decodeRegion(
+        byteArray: ByteArray,
+        rect: Rect,
+        scaledWidth: Int = 0,
+        scaledHeight: Int = 0,
+        preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
+        scaleMode: ScaleMode = ScaleMode.FIT,
+        scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
+    ): Bitmap {
+        require(!rect.isEmpty) { "Region must not be empty" }
+        return decodeRegionImpl(
+            byteArray,
+            rect.left,
+            rect.top,
+            rect.width(),
+            rect.height(),
+            scaledWidth,
+            scaledHeight,
+            preferredColorConfig.value,
+            scaleMode.value,
+            scaleQuality.level,
+            toneMapper.value,
+        )
+    }
+
+    /**
+     * Decodes primary image into raw YUV planes skipping RGB conversion,
+     * planes are copied once into a single direct buffer
+     */
+    fun decodeYuv(
+        byteArray: ByteArray,
+        layout: YuvLayout = YuvLayout.PLANAR,
+    ): HeifYuvImage {
+        val meta = IntArray(HeifYuvImage.META_SIZE)
+        val buffer = decodeYuvImpl(byteArray, layout.value, meta)
+        return HeifYuvImage.create(buffer, layout, meta)
+    }
+
+    /**
+     * Decodes straight into existing mutable [bitmap], image is scaled to exactly its size,
+     * so bitmaps may be reused from a pool without extra allocation and copy.
+     * Bitmap config must be ARGB_8888, RGBA_F16, RGB_565 or RGBA_1010102.
+     *
+     * @param scaleMode only [ScaleMode.FILL] and [ScaleMode.RESIZE] fill destination exactly
+     */
+    fun decodeInto(
+        byteArray: ByteArray,
+        bitmap: Bitmap,
+        scaleMode: ScaleMode = ScaleMode.FILL,
+        scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
+    ) {
+        require(bitmap.isMutable) { "Destination bitmap must be mutable" }
+        require(scaleMode != ScaleMode.FIT) { "FIT scale mode can't fill destination exactly" }
+        decodeIntoBitmapImpl(byteArray, bitmap, scaleMode.value, scaleQuality.level, toneMapper.value)
+    }
+
+    /**
+     * Decodes straight into direct [byteBuffer] with rows of [stride] bytes
+     *
+     * @param colorConfig layout of the pixels, must be one of RGBA_8888, RGBA_F16, RGB_565 or RGBA_1010102
+     * @param scaleMode only [ScaleMode.FILL] and [ScaleMode.RESIZE] fill destination exactly
+     */
+    fun decodeInto(
+        byteArray: ByteArray,
+        byteBuffer: ByteBuffer,
+        width: Int,
+        height: Int,
+        stride: Int,
+        colorConfig: PreferredColorConfig = PreferredColorConfig.RGBA_8888,
+        scaleMode: ScaleMode = ScaleMode.FILL,
+        scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
+    ) {
+        require(byteBuffer.isDirect) { "Only direct byte buffers are supported" }
+        require(colorConfig != PreferredColorConfig.DEFAULT && colorConfig != PreferredColorConfig.HARDWARE) {
+            "Color config must describe exact pixel layout"
+        }
+        require(scaleMode != ScaleMode.FIT) { "FIT scale mode can't fill destination exactly" }
+        decodeIntoBufferImpl(
+            byteArray,
+            byteBuffer,
+            width,
+            height,
+            stride,
+            colorConfig.value,
+            scaleMode.value,
+            scaleQuality.level,
+            toneMapper.value,
+        )
+    }
+
+    /**
+     * Decodes progressive AVIF layer by layer, every layer goes through the full pipeline
+     * and is delivered to [listener], which may stop decoding after any of them.
+     * Images without layers are delivered once as a single layer.
+     *
+     * @return the last decoded layer
+     */
+    fun decodeProgressive(
+        byteArray: ByteArray,
+        scaledWidth: Int = 0,
+        scaledHeight: Int = 0,
+        preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
+        scaleMode: ScaleMode = ScaleMode.FIT,
+        scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
+        listener: AvifProgressiveListener,
+    ): Bitmap {
+        return decodeProgressiveImpl(
+            byteArray,
+            scaledWidth,
+            scaledHeight,
+            preferredColorConfig.value,
+            scaleMode.value,
+            scaleQuality.level,
+            toneMapper.value,
+            listener,
+        )
+    }
+
+    /**
+     * Decodes directly from a file, it is memory mapped so only the parts decoder reads
+     * are loaded and nothing is copied into the Java heap.
+     * Descriptor must point to a regular seekable file, it is not closed by this call.
+     */
+    fun decodeFile(
+        fd: ParcelFileDescriptor,
+        scaledWidth: Int = 0,
+        scaledHeight: Int = 0,
+        preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
+        scaleMode: ScaleMode = ScaleMode.FIT,
+        scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
+    ): Bitmap {
+        return decodeFileImpl(
+            fd.fd,
+            scaledWidth,
+            scaledHeight,
+            preferredColorConfig.value,
+            scaleMode.value,
+            scaleQuality.level,
+            toneMapper.value,
+        )
+    }
+
+    fun decodeFile(
+        file: File,
+        scaledWidth: Int = 0,
+        scaledHeight: Int = 0,
+        preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
+        scaleMode: ScaleMode = ScaleMode.FIT,
+        scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
+    ): Bitmap {
+        return ParcelFileDescriptor.open(file, ParcelFileDescriptor.MODE_READ_ONLY).use {
+            decodeFile(
+                it,
+                scaledWidth,
+                scaledHeight,
+                preferredColorConfig,
+                scaleMode,
+                scaleQuality,
+                toneMapper
+            )
+        }
+    }
+
     /**
      * Encodes an avif image
      *
@@ -190,6 +435,10 @@ class HeifCoder {
     private external fun isAvifImageImpl(byteArray: ByteArray): Boolean
     private external fun isSupportedImageImpl(byteArray: ByteArray): Boolean
     private external fun isSupportedImageImplBB(byteBuffer: ByteBuffer): Boolean
+    private external fun getImageTypeImpl(byteArray: ByteArray): Int
+    private external fun getImageTypeImplBB(byteBuffer: ByteBuffer): Int
+    private external fun getImageTypesImpl(byteArrays: Array<ByteArray>): IntArray
+    private external fun getIccTransformCacheStatsImpl(): LongArray
     private external fun decodeImpl(
         byteArray: ByteArray,
         scaledWidth: Int,
@@ -197,6 +446,7 @@ class HeifCoder {
         clrConfig: Int,
         scaleMode: Int,
         scaleQuality: Int,
+        toneMapper: Int,
     ): Bitmap
 
     private external fun decodeByteBufferImpl(
@@ -206,6 +456,68 @@ class HeifCoder {
         clrConfig: Int,
         scaleMode: Int,
         scaleQuality: Int,
+        toneMapper: Int,
+    ): Bitmap
+
+    private external fun decodeRegionImpl(
+        byteArray: ByteArray,
+        left: Int,
+        top: Int,
+        width: Int,
+        height: Int,
+        scaledWidth: Int,
+        scaledHeight: Int,
+        clrConfig: Int,
+        scaleMode: Int,
+        scaleQuality: Int,
+        toneMapper: Int,
+    ): Bitmap
+
+    private external fun decodeYuvImpl(
+        byteArray: ByteArray,
+        layout: Int,
+        metadata: IntArray,
+    ): ByteBuffer
+
+    private external fun decodeIntoBitmapImpl(
+        byteArray: ByteArray,
+        bitmap: Bitmap,
+        scaleMode: Int,
+        scaleQuality: Int,
+        toneMapper: Int,
+    )
+
+    private external fun decodeIntoBufferImpl(
+        byteArray: ByteArray,
+        byteBuffer: ByteBuffer,
+        width: Int,
+        height: Int,
+        stride: Int,
+        clrConfig: Int,
+        scaleMode: Int,
+        scaleQuality: Int,
+        toneMapper: Int,
+    )
+
+    private external fun decodeProgressiveImpl(
+        byteArray: ByteArray,
+        scaledWidth: Int,
+        scaledHeight: Int,
+        clrConfig: Int,
+        scaleMode: Int,
+        scaleQuality: Int,
+        toneMapper: Int,
+        listener: AvifProgressiveListener,
+    ): Bitmap
+
+    private external fun decodeFileImpl(
+        fd: Int,
+        scaledWidth: Int,
+        scaledHeight: Int,
+        clrConfig: Int,
+        scaleMode: Int,
+        scaleQuality: Int,
+        toneMapper: Int,
     ): Bitmap
 
     private external fun encodeAvifImpl(
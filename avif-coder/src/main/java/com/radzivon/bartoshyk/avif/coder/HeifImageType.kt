@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+package com.radzivon.bartoshyk.avif.coder
+
+import androidx.annotation.Keep
+
+@Keep
+enum class HeifBrand(internal val value: Int) {
+    UNKNOWN(0),
+    AVIF(1),
+    AVIS(2),
+    HEIC(3),
+    HEIX(4),
+
+    // Generic HEIF image or sequence, codec is not declared by brand
+    MIF1(5),
+    MSF1(6);
+
+    internal companion object {
+        fun fromValue(value: Int): HeifBrand = entries.firstOrNull { it.value == value } ?: UNKNOWN
+    }
+}
+
+/**
+ * Container classification read from the 'ftyp' box, only a bounded prefix of the source is inspected
+ */
+@Keep
+data class HeifImageType(val brand: HeifBrand, val isSequence: Boolean) {
+    val isAvif: Boolean
+        get() = brand == HeifBrand.AVIF || brand == HeifBrand.AVIS
+
+    val isHeif: Boolean
+        get() = brand == HeifBrand.HEIC || brand == HeifBrand.HEIX ||
+                brand == HeifBrand.MIF1 || brand == HeifBrand.MSF1
+
+    val isSupported: Boolean
+        get() = brand != HeifBrand.UNKNOWN
+
+    internal companion object {
+        // Must match kImageTypeSniffLength on the native side
+        const val SNIFF_LENGTH = 512
+
+        fun fromPacked(packed: Int): HeifImageType =
+            HeifImageType(HeifBrand.fromValue(packed and 0xFF), (packed and 0x100) != 0)
+    }
+}
@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+package com.radzivon.bartoshyk.avif.coder
+
+import android.annotation.SuppressLint
+import android.graphics.Bitmap
+import android.graphics.Rect
+import android.os.Build
+import android.os.ParcelFileDescriptor
+import android.util.Size
+import androidx.annotation.Keep
+import java.io.Closeable
+
+/**
+ * Decodes rectangular regions of a single AVIF or HEIC image, like [android.graphics.BitmapRegionDecoder].
+ *
+ * Image is parsed and decoded once. Regions are assembled from tiles converted on demand and kept
+ * in LRU cache, so panning over a large image converts only newly exposed tiles.
+ * Zoomed out regions are built from lower resolution tiles.
+ *
+ * Consider closing decoder with [Closeable] as soon as it is not needed, it holds decoded image.
+ *
+ * @param cacheSizeBytes memory budget for converted tiles
+ * @throws Exception - All functions in this class may throw if something goes wrong
+ */
+@Keep
+@SuppressLint("ObsoleteSdkInt")
+class HeifRegionDecoder : Closeable {
+
+    init {
+        if (Build.VERSION.SDK_INT >= 24) {
+            System.loadLibrary("coder")
+        }
+    }
+
+    constructor(source: ByteArray, cacheSizeBytes: Long = DEFAULT_CACHE_SIZE) {
+        nativeController = createFromByteArray(source, cacheSizeBytes)
+    }
+
+    /**
+     * File is memory mapped, descriptor may be closed right after construction
+     */
+    constructor(source: ParcelFileDescriptor, cacheSizeBytes: Long = DEFAULT_CACHE_SIZE) {
+        nativeController = createFromFd(source.fd, cacheSizeBytes)
+    }
+
+    private var nativeController: Long = -1
+    private val lock = Any()
+
+    fun getImageSize(): Size {
+        synchronized(lock) {
+            if (nativeController == -1L) {
+                throw IllegalStateException("Region decoder wasn't properly initialized")
+            }
+            return getSizeImpl(nativeController)
+        }
+    }
+
+    /**
+     * Decodes [rect] of the image, it is in image pixels and must lie within the image.
+     * Region is then scaled the same way [HeifCoder.decodeSampled] does, zero size keeps it as is.
+     */
+    fun decodeRegion(
+        rect: Rect,
+        scaledWidth: Int = 0,
+        scaledHeight: Int = 0,
+        preferredColorConfig: PreferredColorConfig = PreferredColorConfig.DEFAULT,
+        scaleMode: ScaleMode = ScaleMode.FIT,
+        scaleQuality: ScalingQuality = ScalingQuality.DEFAULT,
+        toneMapper: ToneMapper = ToneMapper.REC2408,
+    ): Bitmap {
+        require(!rect.isEmpty) { "Region must not be empty" }
+        synchronized(lock) {
+            if (nativeController == -1L) {
+                throw IllegalStateException("Region decoder wasn't properly initialized")
+            }
+            return decodeRegionImpl(
+                nativeController,
+                rect.left,
+                rect.top,
+                rect.width(),
+                rect.height(),
+                scaledWidth,
+                scaledHeight,
+                preferredColorConfig.value,
+                scaleMode.value,
+                scaleQuality.level,
+                toneMapper.value,
+            )
+        }
+    }
+
+    protected fun finalize() {
+        synchronized(lock) {
+            if (nativeController != -1L) {
+                destroy(nativeController)
+                nativeController = -1L
+            }
+        }
+    }
+
+    override fun close() {
+        synchronized(lock) {
+            if (nativeController != -1L) {
+                destroy(nativeController)
+                nativeController = -1L
+            }
+        }
+    }
+
+    private external fun destroy(ptr: Long)
+    private external fun createFromByteArray(byteArray: ByteArray, cacheBytes: Long): Long
+    private external fun createFromFd(fd: Int, cacheBytes: Long): Long
+    private external fun getSizeImpl(ptr: Long): Size
+    private external fun decodeRegionImpl(
+        ptr: Long,
+        left: Int,
+        top: Int,
+        width: Int,
+        height: Int,
+        scaledWidth: Int,
+        scaledHeight: Int,
+        preferredColorConfig: Int,
+        scaleMode: Int,
+        scaleQuality: Int,
+        toneMapper: Int,
+    ): Bitmap
+
+    companion object {
+        const val DEFAULT_CACHE_SIZE: Long = 64L * 1024L * 1024L
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 Radzivon Bartoshyk
+ * avif-coder [https://github.com/awxkee/avif-coder]
+ *
+ * Created by Radzivon Bartoshyk on 16/10/2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+package com.radzivon.bartoshyk.avif.coder
+
+import androidx.annotation.Keep
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+@Keep
+enum class YuvLayout(internal val value: Int) {
+    // I420, I422, I444, I400 and their 16 bit containers for deeper images
+    PLANAR(1),
+
+    // NV12 for 8 bit and P010 for deeper images, available only for 4:2:0
+    SEMI_PLANAR(2),
+}
+
+@Keep
+enum class YuvSubsampling(internal val value: Int) {
+    YUV420(0),
+    YUV422(1),
+    YUV444(2),
+    YUV400(3);
+
+    internal companion object {
+        fun fromValue(value: Int): YuvSubsampling = entries.first { it.value == value }
+    }
+}
+
+/**
+ * Decoded planes without RGB conversion.
+ *
+ * Samples of images deeper than 8 bit are 16 bit little endian, planar output keeps them
+ * LSB aligned while semi-planar output is MSB aligned as P010 expects.
+ * CICP values follow ITU-T H.273 and are needed to convert the planes downstream.
+ *
+ * @property y luma plane
+ * @property u Cb plane, or interleaved CbCr plane for [YuvLayout.SEMI_PLANAR], null for [YuvSubsampling.YUV400]
+ * @property v Cr plane, null for semi-planar and monochrome images
+ * @property buffer direct buffer backing all planes
+ */
+@Keep
+class HeifYuvImage internal constructor(
+    val width: Int,
+    val height: Int,
+    val bitDepth: Int,
+    val subsampling: YuvSubsampling,
+    val layout: YuvLayout,
+    val chromaWidth: Int,
+    val chromaHeight: Int,
+    val y: ByteBuffer,
+    val yStride: Int,
+    val u: ByteBuffer?,
+    val uStride: Int,
+    val v: ByteBuffer?,
+    val vStride: Int,
+    val colorPrimaries: Int,
+    val transferCharacteristics: Int,
+    val matrixCoefficients: Int,
+    val isFullRange: Boolean,
+    val buffer: ByteBuffer,
+) {
+    internal companion object {
+        // Must match YuvMetadataIndex on the native side
+        private const val META_WIDTH = 0
+        private const val META_HEIGHT = 1
+        private const val META_BIT_DEPTH = 2
+        private const val META_SUBSAMPLING = 3
+        private const val META_PLANES_COUNT = 4
+        private const val META_CHROMA_WIDTH = 5
+        private const val META_CHROMA_HEIGHT = 6
+        private const val META_COLOR_PRIMARIES = 7
+        private const val META_TRANSFER_CHARACTERISTICS = 8
+        private const val META_MATRIX_COEFFICIENTS = 9
+        private const val META_FULL_RANGE = 10
+        private const val META_OFFSETS = 11
+        private const val META_STRIDES = 14
+        const val META_SIZE = 17
+
+        fun create(buffer: ByteBuffer, layout: YuvLayout, meta: IntArray): HeifYuvImage {
+            buffer.order(ByteOrder.LITTLE_ENDIAN)
+            val planesCount = meta[META_PLANES_COUNT]
+            val height = meta[META_HEIGHT]
+            val chromaHeight = meta[META_CHROMA_HEIGHT]
+
+            fun plane(index: Int): ByteBuffer? {
+                if (index >= planesCount) return null
+                val offset = meta[META_OFFSETS + index]
+                val rows = if (index == 0) height else chromaHeight
+                val size = meta[META_STRIDES + index] * rows
+                val view = buffer.duplicate()
+                view.position(offset)
+                view.limit(offset + size)
+                return view.slice().order(ByteOrder.LITTLE_ENDIAN)
+            }
+
+            return HeifYuvImage(
+                width = meta[META_WIDTH],
+                height = height,
+                bitDepth = meta[META_BIT_DEPTH],
+                subsampling = YuvSubsampling.fromValue(meta[META_SUBSAMPLING]),
+                layout = layout,
+                chromaWidth = meta[META_CHROMA_WIDTH],
+                chromaHeight = chromaHeight,
+                y = plane(0)!!,
+                yStride = meta[META_STRIDES],
+                u = plane(1),
+                uStride = meta[META_STRIDES + 1],
+                v = plane(2),
+                vStride = meta[META_STRIDES + 2],
+                colorPrimaries = meta[META_COLOR_PRIMARIES],
+                transferCharacteristics = meta[META_TRANSFER_CHARACTERISTICS],
+                matrixCoefficients = meta[META_MATRIX_COEFFICIENTS],
+                isFullRange = meta[META_FULL_RANGE] != 0,
+                buffer = buffer,
+            )
+        }
+    }
+}
@@ -28,13 +28,20 @@
  */
 // build.rs
 use std::env;
+use std::path::PathBuf;
 
 fn main() {
     let crate_dir = env::var("CARGO_MANIFEST_DIR").unwrap();
+    // Bindings stay in the build directory, so building the crate never rewrites the source tree.
+    // avif-coder keeps its own avifweaver.h, this one is only to compare it against.
+    let out_dir = PathBuf::from(env::var("OUT_DIR").unwrap());
+
+    println!("cargo:rerun-if-changed=src");
+    println!("cargo:rerun-if-changed=cbindgen.toml");
 
     cbindgen::Builder::new()
         .with_crate(crate_dir)
         .generate()
         .expect("Unable to generate bindings")
-        .write_to_file("include/avifweaver.h");
+        .write_to_file(out_dir.join("avifweaver.h"));
 }
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) Radzivon Bartoshyk. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3.  Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+use moxcms::{CicpColorPrimaries, ColorProfile, ToneReprCurve, TransferCharacteristics, Xyzd};
+
+/// Largest XYZ deviation of a colorant or white point still treated as sRGB,
+/// covers s15Fixed16 rounding and slightly differently adapted vendor colorants
+const COLORANT_TOLERANCE: f64 = 2e-3;
+/// Largest xy deviation of CICP primaries from BT.709 still treated as sRGB
+const CHROMATICITY_TOLERANCE: f32 = 1e-3;
+/// Largest deviation of a normalized TRC value from the sRGB curve, about a quarter of 8-bit code
+const TRC_TOLERANCE: f32 = 1e-3;
+const TRC_SAMPLES: usize = 256;
+
+fn srgb_eotf(x: f32) -> f32 {
+    if x <= 0.04045 {
+        x / 12.92
+    } else {
+        ((x + 0.055) / 1.055).powf(2.4)
+    }
+}
+
+/// Evaluates ICC `curv`/`para` curve, None for unknown parametric function type
+fn evaluate_trc(curve: &ToneReprCurve, x: f32) -> Option<f32> {
+    match curve {
+        ToneReprCurve::Lut(table) => match table.len() {
+            0 => Some(x),
+            1 => Some(x.powf(table[0] as f32 / 256.)),
+            len => {
+                let position = x * (len - 1) as f32;
+                let index = (position as usize).min(len - 2);
+                let fraction = position - index as f32;
+                let start = table[index] as f32 / 65535.;
+                let end = table[index + 1] as f32 / 65535.;
+                Some(start + (end - start) * fraction)
+            }
+        },
+        ToneReprCurve::Parametric(params) => {
+            let g = *params.first()?;
+            match params.len() {
+                1 => Some(x.powf(g)),
+                3 => {
+                    let (a, b) = (params[1], params[2]);
+                    Some(if a * x + b >= 0. {
+                        (a * x + b).powf(g)
+                    } else {
+                        0.
+                    })
+                }
+                4 => {
+                    let (a, b, c) = (params[1], params[2], params[3]);
+                    Some(if a * x + b >= 0. {
+                        (a * x + b).powf(g) + c
+                    } else {
+                        c
+                    })
+                }
+                5 => {
+                    let (a, b, c, d) = (params[1], params[2], params[3], params[4]);
+                    Some(if x >= d { (a * x + b).powf(g) } else { c * x })
+                }
+                7 => {
+                    let (a, b, c, d) = (params[1], params[2], params[3], params[4]);
+                    let (e, f) = (params[5], params[6]);
+                    Some(if x >= d {
+                        (a * x + b).powf(g) + e
+                    } else {
+                        c * x + f
+                    })
+                }
+                _ => None,
+            }
+        }
+    }
+}
+
+fn is_srgb_trc(curve: &ToneReprCurve) -> bool {
+    (0..TRC_SAMPLES).all(|i| {
+        let x = i as f32 / (TRC_SAMPLES - 1) as f32;
+        match evaluate_trc(curve, x) {
+            Some(value) => value.is_finite() && (value - srgb_eotf(x)).abs() <= TRC_TOLERANCE,
+            None => false,
+        }
+    })
+}
+
+fn is_xyz_close(a: Xyzd, b: Xyzd) -> bool {
+    (a.x - b.x).abs() <= COLORANT_TOLERANCE
+        && (a.y - b.y).abs() <= COLORANT_TOLERANCE
+        && (a.z - b.z).abs() <= COLORANT_TOLERANCE
+}
+
+/// Checks that a matrix/shaper profile converts to sRGB as identity:
+/// colorants, white point and every channel TRC within tolerance of sRGB
+pub(crate) fn is_srgb_equivalent(profile: &ColorProfile) -> bool {
+    if !profile.is_matrix_shaper() {
+        return false;
+    }
+    if let Some(cicp) = &profile.cicp {
+        if cicp.color_primaries != CicpColorPrimaries::Bt709
+            || cicp.transfer_characteristics != TransferCharacteristics::Srgb
+        {
+            return false;
+        }
+    }
+    let srgb = ColorProfile::new_srgb();
+    let colorants_match = is_xyz_close(profile.red_colorant, srgb.red_colorant)
+        && is_xyz_close(profile.green_colorant, srgb.green_colorant)
+        && is_xyz_close(profile.blue_colorant, srgb.blue_colorant)
+        && is_xyz_close(profile.white_point, srgb.white_point);
+    colorants_match
+        && [&profile.red_trc, &profile.green_trc, &profile.blue_trc]
+            .iter()
+            .all(|trc| trc.as_ref().map(is_srgb_trc).unwrap_or(false))
+}
+
+/// Checks that CICP colorimetry given as xy primaries `[rx, ry, gx, gy, bx, by]`,
+/// xy white point and transfer characteristics is sRGB
+pub(crate) fn is_srgb_cicp(
+    primaries: &[f32; 6],
+    white_point: &[f32; 2],
+    trc: TransferCharacteristics,
+) -> bool {
+    const SRGB_PRIMARIES: [f32; 6] = [0.64, 0.33, 0.30, 0.60, 0.15, 0.06];
+    const D65: [f32; 2] = [0.3127, 0.3290];
+    trc == TransferCharacteristics::Srgb
+        && primaries
+            .iter()
+            .zip(SRGB_PRIMARIES.iter())
+            .chain(white_point.iter().zip(D65.iter()))
+            .all(|(&value, &reference)| (value - reference).abs() <= CHROMATICITY_TOLERANCE)
+}
@@ -27,7 +27,9 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 use crate::cvt::work_on_transmuted_ptr_u16;
-use moxcms::{ColorProfile, Layout, TransformOptions};
+use crate::support::process_rows_in_place;
+use crate::transform_cache::{cached_icc_transform_16bit, cached_icc_transform_8bit, IccTransform};
+use moxcms::TransformExecutor;
 
 #[no_mangle]
 pub unsafe extern "C" fn apply_icc_rgba8(
@@ -46,112 +48,43 @@ pub unsafe extern "C" fn apply_icc_rgba8(
             std::slice::from_raw_parts(src_image, src_stride as usize * height as usize);
         let dst_image =
             std::slice::from_raw_parts_mut(dst_image, dst_stride as usize * height as usize);
-        match ColorProfile::new_from_slice(&icc_data) {
-            Ok(icc_profile) => {
-                apply_icc_rgba8_impl(
-                    src_image,
-                    src_stride,
-                    dst_image,
-                    dst_stride,
-                    width,
-                    icc_profile,
-                );
+        match cached_icc_transform_8bit(icc_data) {
+            Some(IccTransform::Transform(transform)) => {
+                for (src_row, dst_row) in src_image
+                    .chunks_exact(src_stride as usize)
+                    .zip(dst_image.chunks_exact_mut(dst_stride as usize))
+                {
+                    let src = &src_row[..width as usize * 4];
+                    let dst = &mut dst_row[..width as usize * 4];
+                    transform.transform(src, dst).unwrap();
+                }
             }
-            Err(_) => {
+            Some(IccTransform::Identity) | None => {
                 straight_copy(src_stride, dst_stride, width, src_image, dst_image, 1);
             }
         };
     }
 }
 
-pub(crate) fn apply_icc_rgba8_impl(
-    src_image: &[u8],
-    src_stride: u32,
-    dst_image: &mut [u8],
-    dst_stride: u32,
+pub(crate) fn transform_rgba_in_place<T, E>(
+    image: &mut [T],
+    stride: usize,
     width: u32,
-    profile: ColorProfile,
-) {
-    let dst_profile = ColorProfile::new_srgb();
-    let transform = profile.create_transform_8bit(
-        Layout::Rgba,
-        &dst_profile,
-        Layout::Rgba,
-        TransformOptions::default(),
+    max_threads: usize,
+    transform: &E,
+) where
+    T: Copy + Default + Send,
+    E: TransformExecutor<T> + Sync + ?Sized,
+{
+    process_rows_in_place(
+        image,
+        stride,
+        width as usize * 4,
+        max_threads,
+        |src, dst| {
+            transform.transform(src, dst).unwrap();
+        },
     );
-    match transform {
-        Ok(transform) => {
-            for (src_row, dst_row) in src_image
-                .chunks_exact(src_stride as usize)
-                .zip(dst_image.chunks_exact_mut(dst_stride as usize))
-            {
-                let src = &src_row[..width as usize * 4];
-                let dst = &mut dst_row[..width as usize * 4];
-                transform.transform(src, dst).unwrap();
-            }
-        }
-        Err(_) => {
-            straight_copy(src_stride, dst_stride, width, src_image, dst_image, 1);
-        }
-    }
-}
-
-pub(crate) fn apply_icc_rgba16_impl(
-    src_image: &[u16],
-    src_stride: u32,
-    dst_image: &mut [u16],
-    dst_stride: u32,
-    width: u32,
-    bit_depth: u32,
-    profile: &ColorProfile,
-) {
-    let dst_profile = ColorProfile::new_srgb();
-    let transform = if bit_depth == 10 {
-        profile.create_transform_10bit(
-            Layout::Rgba,
-            &dst_profile,
-            Layout::Rgba,
-            TransformOptions::default(),
-        )
-    } else if bit_depth == 12 {
-        profile.create_transform_12bit(
-            Layout::Rgba,
-            &dst_profile,
-            Layout::Rgba,
-            TransformOptions::default(),
-        )
-    } else {
-        profile.create_transform_16bit(
-            Layout::Rgba,
-            &dst_profile,
-            Layout::Rgba,
-            TransformOptions::default(),
-        )
-    };
-    match transform {
-        Ok(transform) => {
-            for (src_row, dst_row) in src_image
-                .chunks_exact(src_stride as usize)
-                .zip(dst_image.chunks_exact_mut(dst_stride as usize))
-            {
-                let src = &src_row[..width as usize * 4];
-                let dst = &mut dst_row[..width as usize * 4];
-                transform.transform(src, dst).unwrap();
-            }
-        }
-        Err(_) => {
-            for (src_row, dst_row) in src_image
-                .chunks_exact(src_stride as usize)
-                .zip(dst_image.chunks_exact_mut(dst_stride as usize))
-            {
-                let src = &src_row[..width as usize * 4];
-                let dst = &mut dst_row[..width as usize * 4];
-                for (src, dst) in src.iter().zip(dst.iter_mut()) {
-                    *dst = *src;
-                }
-            }
-        }
-    }
 }
 
 #[no_mangle]
@@ -167,87 +100,42 @@ pub unsafe extern "C" fn apply_icc_rgba16(
     icc_profile_stride: u32,
 ) {
     unsafe {
-        if bit_depth != 10 && bit_depth != 12 && bit_depth != 16 {
-            let src_image = std::slice::from_raw_parts(
-                src_image as *const u8,
-                src_stride as usize * height as usize,
-            );
-            let dst_image = std::slice::from_raw_parts_mut(
-                dst_image as *mut u8,
-                dst_stride as usize * height as usize,
-            );
-            straight_copy(src_stride, dst_stride, width, src_image, dst_image, 2);
-            return;
-        }
         let icc_data = std::slice::from_raw_parts(icc_profile, icc_profile_stride as usize);
-        match ColorProfile::new_from_slice(&icc_data) {
-            Ok(icc_profile) => {
-                let dst_profile = ColorProfile::new_srgb();
-                let transform = if bit_depth == 10 {
-                    icc_profile.create_transform_10bit(
-                        Layout::Rgba,
-                        &dst_profile,
-                        Layout::Rgba,
-                        TransformOptions::default(),
-                    )
-                } else if bit_depth == 12 {
-                    icc_profile.create_transform_12bit(
-                        Layout::Rgba,
-                        &dst_profile,
-                        Layout::Rgba,
-                        TransformOptions::default(),
-                    )
-                } else {
-                    icc_profile.create_transform_16bit(
-                        Layout::Rgba,
-                        &dst_profile,
-                        Layout::Rgba,
-                        TransformOptions::default(),
-                    )
-                };
-                match transform {
-                    Ok(transform) => {
+        let transform = if bit_depth == 10 || bit_depth == 12 || bit_depth == 16 {
+            cached_icc_transform_16bit(icc_data, bit_depth)
+        } else {
+            None
+        };
+        match transform {
+            Some(IccTransform::Transform(transform)) => {
+                work_on_transmuted_ptr_u16(
+                    src_image,
+                    src_stride,
+                    width as usize,
+                    height as usize,
+                    true,
+                    |src: &mut [u16], v_src_stride: usize| {
                         work_on_transmuted_ptr_u16(
-                            src_image,
-                            src_stride,
+                            dst_image,
+                            dst_stride,
                             width as usize,
                             height as usize,
-                            true,
-                            |src: &mut [u16], v_src_stride: usize| {
-                                work_on_transmuted_ptr_u16(
-                                    dst_image,
-                                    dst_stride,
-                                    width as usize,
-                                    height as usize,
-                                    false,
-                                    |dst, v_dst_stride| {
-                                        for (src_row, dst_row) in src
-                                            .chunks_exact(v_src_stride)
-                                            .zip(dst.chunks_exact_mut(v_dst_stride))
-                                        {
-                                            let src = &src_row[..width as usize * 4];
-                                            let dst = &mut dst_row[..width as usize * 4];
-                                            transform.transform(src, dst).unwrap();
-                                        }
-                                    },
-                                );
+                            false,
+                            |dst, v_dst_stride| {
+                                for (src_row, dst_row) in src
+                                    .chunks_exact(v_src_stride)
+                                    .zip(dst.chunks_exact_mut(v_dst_stride))
+                                {
+                                    let src = &src_row[..width as usize * 4];
+                                    let dst = &mut dst_row[..width as usize * 4];
+                                    transform.transform(src, dst).unwrap();
+                                }
                             },
                         );
-                    }
-                    Err(_) => {
-                        let src_image = std::slice::from_raw_parts(
-                            src_image as *const u8,
-                            src_stride as usize * height as usize,
-                        );
-                        let dst_image = std::slice::from_raw_parts_mut(
-                            dst_image as *mut u8,
-                            dst_stride as usize * height as usize,
-                        );
-                        straight_copy(src_stride, dst_stride, width, src_image, dst_image, 2);
-                    }
-                }
+                    },
+                );
             }
-            Err(_) => {
+            Some(IccTransform::Identity) | None => {
                 let src_image = std::slice::from_raw_parts(
                     src_image as *const u8,
                     src_stride as usize * height as usize,
@@ -262,6 +150,70 @@ pub unsafe extern "C" fn apply_icc_rgba16(
     }
 }
 
+#[no_mangle]
+pub unsafe extern "C" fn apply_icc_in_place_rgba8(
+    image: *mut u8,
+    stride: u32,
+    width: u32,
+    height: u32,
+    icc_profile: *const u8,
+    icc_profile_stride: u32,
+    threads: u32,
+) {
+    unsafe {
+        let icc_data = std::slice::from_raw_parts(icc_profile, icc_profile_stride as usize);
+        let image = std::slice::from_raw_parts_mut(image, stride as usize * height as usize);
+        if let Some(IccTransform::Transform(transform)) = cached_icc_transform_8bit(icc_data) {
+            transform_rgba_in_place(
+                image,
+                stride as usize,
+                width,
+                threads as usize,
+                transform.as_ref(),
+            );
+        }
+    }
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn apply_icc_in_place_rgba16(
+    image: *mut u16,
+    stride: u32,
+    bit_depth: u32,
+    width: u32,
+    height: u32,
+    icc_profile: *const u8,
+    icc_profile_stride: u32,
+    threads: u32,
+) {
+    if bit_depth != 10 && bit_depth != 12 && bit_depth != 16 {
+        return;
+    }
+    unsafe {
+        let icc_data = std::slice::from_raw_parts(icc_profile, icc_profile_stride as usize);
+        if let Some(IccTransform::Transform(transform)) =
+            cached_icc_transform_16bit(icc_data, bit_depth)
+        {
+            work_on_transmuted_ptr_u16(
+                image,
+                stride,
+                width as usize,
+                height as usize,
+                true,
+                |image: &mut [u16], image_stride: usize| {
+                    transform_rgba_in_place(
+                        image,
+                        image_stride,
+                        width,
+                        threads as usize,
+                        transform.as_ref(),
+                    );
+                },
+            );
+        }
+    }
+}
+
 pub(crate) fn straight_copy(
     src_stride: u32,
     dst_stride: u32,
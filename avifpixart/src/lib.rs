@@ -30,11 +30,15 @@
 #![allow(clippy::missing_safety_doc)]
 #![feature(f16)]
 
+mod colorimetry;
 mod cvt;
 mod icc;
+mod lut3d;
 mod rgb_to_yuv;
 mod support;
 mod tonemapper;
+mod transform_cache;
+mod vector_f32;
 
 use crate::support::{transmute_const_ptr16, SliceStoreMut};
 use pic_scale::{
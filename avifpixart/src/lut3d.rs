@@ -0,0 +1,498 @@
+/*
+ * Copyright (c) Radzivon Bartoshyk. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3.  Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+use crate::support::process_rows_in_place;
+use crate::vector_f32::F32x4;
+use moxcms::TransferCharacteristics;
+use num_traits::AsPrimitive;
+use std::sync::{Arc, Mutex};
+
+/// Grid size for 8-bit output, finer grid gives no visible gain at this depth
+pub(crate) const LUT_GRID_8BIT: usize = 33;
+/// Grid size for 10-bit output, 12-bit reuses it and gives up a few codes to interpolation
+pub(crate) const LUT_GRID_10BIT: usize = 65;
+/// 65³ grid takes ~3 MB, keep only a few colorimetry sets around
+const LUT_CACHE_CAPACITY: usize = 3;
+
+/// Whole colour chain (linearization, tone mapping, gamut mapping, sRGB OETF)
+/// sampled on a regular RGB grid, evaluated with tetrahedral interpolation
+pub(crate) struct Lut3d {
+    grid: usize,
+    /// Normalized RGB for every node, blue varies fastest
+    nodes: Vec<[f32; 3]>,
+}
+
+impl Lut3d {
+    /// Samples `tonemap`, which maps 16-bit RGBA lanes, at every node of `grid`³ lattice
+    pub(crate) fn bake(grid: usize, tonemap: impl Fn(&[u16], &mut [u16]) + Sync) -> Lut3d {
+        let node_scale = 65535. / (grid - 1) as f32;
+        let mut lattice = vec![0u16; grid * grid * grid * 4];
+        for (index, pixel) in lattice.chunks_exact_mut(4).enumerate() {
+            let r = index / (grid * grid);
+            let g = (index / grid) % grid;
+            let b = index % grid;
+            pixel[0] = (r as f32 * node_scale).round() as u16;
+            pixel[1] = (g as f32 * node_scale).round() as u16;
+            pixel[2] = (b as f32 * node_scale).round() as u16;
+            pixel[3] = u16::MAX;
+        }
+        // Every blue run is a row, so baking is parallel as an ordinary image
+        process_rows_in_place(&mut lattice, grid * 4, grid * 4, 0, tonemap);
+        let nodes = lattice
+            .chunks_exact(4)
+            .map(|pixel| {
+                [
+                    pixel[0] as f32 / 65535.,
+                    pixel[1] as f32 / 65535.,
+                    pixel[2] as f32 / 65535.,
+                ]
+            })
+            .collect();
+        Lut3d { grid, nodes }
+    }
+
+    #[inline(always)]
+    fn node(&self, r: usize, g: usize, b: usize) -> [f32; 3] {
+        self.nodes[(r * self.grid + g) * self.grid + b]
+    }
+
+    /// Tetrahedral interpolation of normalized RGB
+    #[inline(always)]
+    fn lookup(&self, r: f32, g: f32, b: f32) -> [f32; 3] {
+        let scale = (self.grid - 1) as f32;
+        let fr = r.clamp(0., 1.) * scale;
+        let fg = g.clamp(0., 1.) * scale;
+        let fb = b.clamp(0., 1.) * scale;
+        let ir = (fr as usize).min(self.grid - 2);
+        let ig = (fg as usize).min(self.grid - 2);
+        let ib = (fb as usize).min(self.grid - 2);
+        let dr = fr - ir as f32;
+        let dg = fg - ig as f32;
+        let db = fb - ib as f32;
+
+        let c000 = self.node(ir, ig, ib);
+        let c111 = self.node(ir + 1, ig + 1, ib + 1);
+        // Picks the tetrahedron containing the point, walking c000 -> c1 -> c2 -> c111
+        let (c1, c2, w0, w1, w2) = if dr >= dg {
+            if dg >= db {
+                (
+                    self.node(ir + 1, ig, ib),
+                    self.node(ir + 1, ig + 1, ib),
+                    dr,
+                    dg,
+                    db,
+                )
+            } else if dr >= db {
+                (
+                    self.node(ir + 1, ig, ib),
+                    self.node(ir + 1, ig, ib + 1),
+                    dr,
+                    db,
+                    dg,
+                )
+            } else {
+                (
+                    self.node(ir, ig, ib + 1),
+                    self.node(ir + 1, ig, ib + 1),
+                    db,
+                    dr,
+                    dg,
+                )
+            }
+        } else if db >= dg {
+            (
+                self.node(ir, ig, ib + 1),
+                self.node(ir, ig + 1, ib + 1),
+                db,
+                dg,
+                dr,
+            )
+        } else if db >= dr {
+            (
+                self.node(ir, ig + 1, ib),
+                self.node(ir, ig + 1, ib + 1),
+                dg,
+                db,
+                dr,
+            )
+        } else {
+            (
+                self.node(ir, ig + 1, ib),
+                self.node(ir + 1, ig + 1, ib),
+                dg,
+                dr,
+                db,
+            )
+        };
+
+        let mut result = [0f32; 3];
+        for c in 0..3 {
+            result[c] =
+                c000[c] + w0 * (c1[c] - c000[c]) + w1 * (c2[c] - c1[c]) + w2 * (c111[c] - c2[c]);
+        }
+        result
+    }
+
+    /// Maps RGBA lane with values in `0..=max_value`, alpha is passed through
+    pub(crate) fn apply_lane<T>(&self, src: &[T], dst: &mut [T], max_value: f32)
+    where
+        T: Copy + 'static + AsPrimitive<f32>,
+        f32: AsPrimitive<T>,
+    {
+        let input_scale = 1. / max_value;
+        let mut src_quads = src.chunks_exact(16);
+        let mut dst_quads = dst.chunks_exact_mut(16);
+        for (src, dst) in (&mut src_quads).zip(&mut dst_quads) {
+            let channel = |c: usize| -> [f32; 4] { std::array::from_fn(|i| src[i * 4 + c].as_()) };
+            let mapped =
+                self.lookup_x4([channel(0), channel(1), channel(2)], input_scale, max_value);
+            for i in 0..4 {
+                dst[i * 4] = mapped[0][i].as_();
+                dst[i * 4 + 1] = mapped[1][i].as_();
+                dst[i * 4 + 2] = mapped[2][i].as_();
+                dst[i * 4 + 3] = src[i * 4 + 3];
+            }
+        }
+
+        let tail = src_quads.remainder();
+        for (src, dst) in tail
+            .chunks_exact(4)
+            .zip(dst_quads.into_remainder().chunks_exact_mut(4))
+        {
+            let mapped = self.lookup(
+                src[0].as_() * input_scale,
+                src[1].as_() * input_scale,
+                src[2].as_() * input_scale,
+            );
+            dst[0] = (mapped[0] * max_value).round().min(max_value).max(0.).as_();
+            dst[1] = (mapped[1] * max_value).round().min(max_value).max(0.).as_();
+            dst[2] = (mapped[2] * max_value).round().min(max_value).max(0.).as_();
+            dst[3] = src[3];
+        }
+    }
+
+    /// Same as [Lut3d::lookup] for four pixels given by channel, scaled by `input_scale` on the way in
+    /// and rounded to `0..=max_value` on the way out. The tetrahedron is picked without branches:
+    /// the walk goes along the axis of the largest fraction first and leaves the smallest for last.
+    #[inline(always)]
+    fn lookup_x4(&self, rgb: [[f32; 4]; 3], input_scale: f32, max_value: f32) -> [[f32; 4]; 3] {
+        let scale = F32x4::splat((self.grid - 1) as f32);
+        let zero = F32x4::splat(0.);
+        let one = F32x4::splat(1.);
+        let last_cell = F32x4::splat((self.grid - 2) as f32);
+        let in_scale = F32x4::splat(input_scale);
+        let position = |values: &[f32; 4]| {
+            F32x4::load(values)
+                .mul(in_scale)
+                .max(zero)
+                .min(one)
+                .mul(scale)
+        };
+        let fr = position(&rgb[0]);
+        let fg = position(&rgb[1]);
+        let fb = position(&rgb[2]);
+        let ir = fr.truncate().min(last_cell);
+        let ig = fg.truncate().min(last_cell);
+        let ib = fb.truncate().min(last_cell);
+        let dr = fr.sub(ir);
+        let dg = fg.sub(ig);
+        let db = fb.sub(ib);
+
+        // Node offsets of a step along every axis, exact in f32 for any grid this crate bakes
+        let step_r = F32x4::splat((self.grid * self.grid) as f32);
+        let step_g = F32x4::splat(self.grid as f32);
+        let step_b = one;
+        let step_all = step_r.add(step_g).add(step_b);
+
+        let max_gb = dg.max(db);
+        let min_rg = dr.min(dg);
+        let w0 = dr.max(max_gb);
+        let w1 = min_rg.max(dr.max(dg).min(db));
+        let w2 = min_rg.min(db);
+        let first_step = dr.select_ge(max_gb, step_r, dg.select_ge(db, step_g, step_b));
+        let last_step = min_rg.select_ge(db, step_b, dr.select_ge(dg, step_g, step_r));
+        let second_vertex = step_all.sub(last_step);
+
+        let base = ir.mul_add(step_r, ig.mul_add(step_g, ib)).to_array();
+        let first_step = first_step.to_array();
+        let second_vertex = second_vertex.to_array();
+        let step_all = step_all.to_array();
+        // Nodes are gathered lane by lane, then blended for all four pixels at once
+        let mut vertices = [[[0f32; 4]; 3]; 4];
+        for i in 0..4 {
+            let base = base[i] as usize;
+            let corners = [
+                base,
+                base + first_step[i] as usize,
+                base + second_vertex[i] as usize,
+                base + step_all[i] as usize,
+            ];
+            for (vertex, &corner) in vertices.iter_mut().zip(corners.iter()) {
+                let node = self.nodes[corner];
+                vertex[0][i] = node[0];
+                vertex[1][i] = node[1];
+                vertex[2][i] = node[2];
+            }
+        }
+
+        let out_scale = F32x4::splat(max_value);
+        let half = F32x4::splat(0.5);
+        std::array::from_fn(|c| {
+            let c000 = F32x4::load(&vertices[0][c]);
+            let c1 = F32x4::load(&vertices[1][c]);
+            let c2 = F32x4::load(&vertices[2][c]);
+            let c111 = F32x4::load(&vertices[3][c]);
+            let value = w0.mul_add(
+                c1.sub(c000),
+                w1.mul_add(c2.sub(c1), w2.mul_add(c111.sub(c2), c000)),
+            );
+            // Clamped first, so adding a half and truncating rounds like f32::round
+            value
+                .mul(out_scale)
+                .max(zero)
+                .min(out_scale)
+                .add(half)
+                .truncate()
+                .to_array()
+        })
+    }
+}
+
+/// Everything the baked chain depends on, floats are compared bitwise
+#[derive(PartialEq)]
+pub(crate) struct LutKey {
+    primaries: [u32; 6],
+    white_point: [u32; 2],
+    trc: TransferCharacteristics,
+    brightness: u32,
+    bit_depth: u32,
+}
+
+impl LutKey {
+    pub(crate) fn new(
+        primaries: &[f32; 6],
+        white_point: &[f32; 2],
+        trc: TransferCharacteristics,
+        brightness: f32,
+        bit_depth: u32,
+    ) -> LutKey {
+        LutKey {
+            primaries: primaries.map(f32::to_bits),
+            white_point: white_point.map(f32::to_bits),
+            trc,
+            brightness: brightness.to_bits(),
+            bit_depth,
+        }
+    }
+}
+
+/// Most recently used entry lives at the end
+static LUTS: Mutex<Vec<(LutKey, Arc<Lut3d>)>> = Mutex::new(Vec::new());
+
+/// Returns LUT for `key`, baking it with `bake` when it is not cached yet
+pub(crate) fn cached_lut(key: LutKey, bake: impl FnOnce() -> Option<Lut3d>) -> Option<Arc<Lut3d>> {
+    if let Ok(mut luts) = LUTS.lock() {
+        if let Some(position) = luts.iter().position(|(k, _)| *k == key) {
+            let entry = luts.remove(position);
+            let lut = entry.1.clone();
+            luts.push(entry);
+            return Some(lut);
+        }
+    }
+
+    // Baked outside the lock so other decoders are not stalled
+    let lut = Arc::new(bake()?);
+    if let Ok(mut luts) = LUTS.lock() {
+        if !luts.iter().any(|(k, _)| *k == key) {
+            if luts.len() >= LUT_CACHE_CAPACITY {
+                luts.remove(0);
+            }
+            luts.push((key, lut.clone()));
+        }
+    }
+    Some(lut)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn bake_with(grid: usize, mapping: fn([f32; 3]) -> [f32; 3]) -> Lut3d {
+        Lut3d::bake(grid, |src, dst| {
+            for (src, dst) in src.chunks_exact(4).zip(dst.chunks_exact_mut(4)) {
+                let mapped = mapping([
+                    src[0] as f32 / 65535.,
+                    src[1] as f32 / 65535.,
+                    src[2] as f32 / 65535.,
+                ]);
+                for c in 0..3 {
+                    dst[c] = (mapped[c] * 65535.).round() as u16;
+                }
+                dst[3] = src[3];
+            }
+        })
+    }
+
+    /// Smooth tone curve with cross talk between channels, as gamut mapping does
+    fn curve(rgb: [f32; 3]) -> [f32; 3] {
+        let mixed = [
+            0.8 * rgb[0] + 0.15 * rgb[1] + 0.05 * rgb[2],
+            0.1 * rgb[0] + 0.85 * rgb[1] + 0.05 * rgb[2],
+            0.05 * rgb[0] + 0.1 * rgb[1] + 0.85 * rgb[2],
+        ];
+        mixed.map(|x| 2. * x / (1. + x))
+    }
+
+    /// Distinct weights on every axis, so swapped vertices or weights show up
+    fn affine(rgb: [f32; 3]) -> [f32; 3] {
+        [
+            0.5 * rgb[0] + 0.3 * rgb[1] + 0.1 * rgb[2] + 0.05,
+            0.2 * rgb[0] + 0.1 * rgb[1] + 0.6 * rgb[2],
+            0.1 * rgb[0] + 0.7 * rgb[1] + 0.15 * rgb[2] + 0.02,
+        ]
+    }
+
+    fn quantized(rgb: [f32; 3]) -> [f32; 3] {
+        rgb.map(|x| (x * 65535.).round() / 65535.)
+    }
+
+    #[test]
+    fn test_lookup_returns_nodes_exactly() {
+        for grid in [LUT_GRID_8BIT, LUT_GRID_10BIT] {
+            let lut = bake_with(grid, curve);
+            let scale = (grid - 1) as f32;
+            for r in (0..grid).step_by(7) {
+                for g in (0..grid).step_by(5) {
+                    for b in 0..grid {
+                        let lookup =
+                            lut.lookup(r as f32 / scale, g as f32 / scale, b as f32 / scale);
+                        assert_eq!(lookup, lut.node(r, g, b));
+                        let node_scale = 65535. / scale;
+                        let input = [r, g, b].map(|x| (x as f32 * node_scale).round() / 65535.);
+                        assert_eq!(lookup, quantized(curve(input)));
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_interpolation_follows_mapping() {
+        let lut = bake_with(LUT_GRID_8BIT, curve);
+        let mut src = Vec::new();
+        // Deterministic LCG spread over the whole cube
+        let mut state = 0x2545f491u32;
+        for _ in 0..4096 {
+            for _ in 0..3 {
+                state = state.wrapping_mul(1664525).wrapping_add(1013904223);
+                src.push((state >> 16) as u16);
+            }
+            src.push(u16::MAX);
+        }
+        let mut dst = vec![0u16; src.len()];
+        lut.apply_lane(&src, &mut dst, 65535.);
+        for (src, dst) in src.chunks_exact(4).zip(dst.chunks_exact(4)) {
+            let expected = curve([
+                src[0] as f32 / 65535.,
+                src[1] as f32 / 65535.,
+                src[2] as f32 / 65535.,
+            ]);
+            for c in 0..3 {
+                let diff = (dst[c] as f32 / 65535. - expected[c]).abs();
+                assert!(diff < 1e-3, "{:?} mapped to {:?}, diff {}", src, dst, diff);
+            }
+            assert_eq!(dst[3], src[3]);
+        }
+    }
+
+    #[test]
+    fn test_vector_lanes_match_scalar_lookup() {
+        let lut = bake_with(LUT_GRID_8BIT, curve);
+        // 8-bit codes sweep every ordering of fractions, odd pixel count leaves a scalar tail
+        let mut src = Vec::new();
+        let mut state = 0x9e3779b9u32;
+        for _ in 0..1023 {
+            for _ in 0..3 {
+                state = state.wrapping_mul(1664525).wrapping_add(1013904223);
+                src.push((state >> 24) as u16);
+            }
+            src.push(128);
+        }
+        let mut dst = vec![0u16; src.len()];
+        lut.apply_lane(&src, &mut dst, 255.);
+        for (src, dst) in src.chunks_exact(4).zip(dst.chunks_exact(4)) {
+            let expected = lut.lookup(
+                src[0] as f32 / 255.,
+                src[1] as f32 / 255.,
+                src[2] as f32 / 255.,
+            );
+            for c in 0..3 {
+                let expected = (expected[c] * 255.).round();
+                assert!(
+                    (dst[c] as f32 - expected).abs() <= 1.,
+                    "{:?} mapped to {:?}",
+                    src,
+                    dst
+                );
+            }
+            assert_eq!(dst[3], src[3]);
+        }
+    }
+
+    #[test]
+    fn test_every_tetrahedron_is_exact_for_affine() {
+        let lut = bake_with(5, affine);
+        // Fractions inside the cell in every order of dr, dg, db
+        let orders = [
+            [0.7, 0.5, 0.2],
+            [0.7, 0.2, 0.5],
+            [0.5, 0.2, 0.7],
+            [0.2, 0.5, 0.7],
+            [0.2, 0.7, 0.5],
+            [0.5, 0.7, 0.2],
+        ];
+        for fractions in orders {
+            let rgb = [
+                (1. + fractions[0]) / 4.,
+                (2. + fractions[1]) / 4.,
+                (fractions[2]) / 4.,
+            ];
+            let lookup = lut.lookup(rgb[0], rgb[1], rgb[2]);
+            let expected = affine(rgb);
+            for c in 0..3 {
+                assert!(
+                    (lookup[c] - expected[c]).abs() < 1e-4,
+                    "{:?} mapped to {:?}, expected {:?}",
+                    rgb,
+                    lookup,
+                    expected
+                );
+            }
+        }
+    }
+}
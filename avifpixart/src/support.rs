@@ -77,3 +77,60 @@ impl<T: Copy + Debug> SliceStoreMut<'_, T> {
         }
     }
 }
+
+/// Rows handed to a single worker at minimum, below this spawning threads costs more than it saves
+const ROWS_PER_WORKER: usize = 64;
+
+/// Runs `op` over the first `lane_length` elements of every row of `image` in place.
+///
+/// Each row is copied into a one-row scratch lane owned by the worker, so `op` may read the
+/// original pixels while writing the row back, without cloning the whole image.
+/// Large images are split into row bands processed on scoped threads, at most `max_threads`
+/// of them, where 0 leaves the count to the available parallelism.
+pub(crate) fn process_rows_in_place<T, F>(
+    image: &mut [T],
+    stride: usize,
+    lane_length: usize,
+    max_threads: usize,
+    op: F,
+) where
+    T: Copy + Default + Send,
+    F: Fn(&[T], &mut [T]) + Sync,
+{
+    if stride == 0 || lane_length == 0 || lane_length > stride {
+        return;
+    }
+    let rows = image.len() / stride;
+    let available = std::thread::available_parallelism()
+        .map(|x| x.get())
+        .unwrap_or(1);
+    let threads = if max_threads == 0 {
+        available
+    } else {
+        available.min(max_threads)
+    }
+    .min(rows / ROWS_PER_WORKER)
+    .max(1);
+
+    let process_band = |band: &mut [T]| {
+        let mut scratch = vec![T::default(); lane_length];
+        for row in band.chunks_exact_mut(stride) {
+            let lane = &mut row[..lane_length];
+            scratch.copy_from_slice(lane);
+            op(&scratch, lane);
+        }
+    };
+
+    if threads == 1 {
+        process_band(image);
+        return;
+    }
+
+    let process_band = &process_band;
+    let rows_per_band = rows.div_ceil(threads);
+    std::thread::scope(|scope| {
+        for band in image.chunks_mut(rows_per_band * stride) {
+            scope.spawn(move || process_band(band));
+        }
+    });
+}
@@ -26,10 +26,15 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+use crate::colorimetry::is_srgb_cicp;
 use crate::cvt::work_on_transmuted_ptr_u16;
-use crate::icc::{apply_icc_rgba16_impl, apply_icc_rgba8_impl};
+use crate::icc::transform_rgba_in_place;
+use crate::lut3d::{cached_lut, Lut3d, LutKey, LUT_GRID_10BIT, LUT_GRID_8BIT};
+use crate::support::process_rows_in_place;
+use crate::transform_cache::{
+    cached_cicp_transform_16bit, cached_cicp_transform_8bit, IccTransform,
+};
 use gainforge::{
-    create_tone_mapper_rgba, create_tone_mapper_rgba10, create_tone_mapper_rgba12,
     create_tone_mapper_rgba16, CommonToneMapperParameters, GainHdrMetadata, GamutClipping,
     MappingColorSpace, RgbToneMapperParameters, ToneMappingMethod,
 };
@@ -121,6 +126,34 @@ pub enum ToneMapping {
     Rec2408,
 }
 
+/// Matrix-shaper profile of CICP colorimetry given as xy primaries `[rx, ry, gx, gy, bx, by]`
+/// and xy white point
+fn cicp_profile(
+    primaries: &[f32; 6],
+    white_point: &[f32; 2],
+    trc: TransferCharacteristics,
+) -> ColorProfile {
+    let white_point = XyY {
+        x: white_point[0] as f64,
+        y: white_point[1] as f64,
+        yb: 1.0,
+    };
+    let mut profile = ColorProfile::default();
+    profile.update_rgb_colorimetry_triplet(
+        white_point,
+        Chromaticity::new(primaries[0], primaries[1]).to_xyzd(),
+        Chromaticity::new(primaries[2], primaries[3]).to_xyzd(),
+        Chromaticity::new(primaries[4], primaries[5]).to_xyzd(),
+    );
+    profile.cicp = Some(CicpProfile {
+        full_range: true,
+        color_primaries: CicpColorPrimaries::Bt709,
+        transfer_characteristics: trc,
+        matrix_coefficients: MatrixCoefficients::Bt709,
+    });
+    profile
+}
+
 #[no_mangle]
 pub unsafe extern "C" fn apply_tone_mapping_rgba8(
     image: *mut u8,
@@ -132,73 +165,71 @@ pub unsafe extern "C" fn apply_tone_mapping_rgba8(
     trc: FfiTrc,
     mapping: ToneMapping,
     brightness: f32,
+    threads: u32,
 ) {
     unsafe {
-        let red_chromaticity = Chromaticity::new(
-            primaries.read_unaligned(),
-            primaries.add(1).read_unaligned(),
-        );
-        let green_chromaticity = Chromaticity::new(
-            primaries.add(2).read_unaligned(),
-            primaries.add(3).read_unaligned(),
-        );
-        let blue_chromaticity = Chromaticity::new(
-            primaries.add(4).read_unaligned(),
-            primaries.add(5).read_unaligned(),
-        );
-        let white_point = XyY {
-            x: white_point.read_unaligned() as f64,
-            y: white_point.add(1).read_unaligned() as f64,
-            yb: 1.0,
-        };
+        let primaries_xy: [f32; 6] = std::array::from_fn(|i| primaries.add(i).read_unaligned());
+        let white_point_xy = [
+            white_point.read_unaligned(),
+            white_point.add(1).read_unaligned(),
+        ];
+        // sRGB colorimetry converts to sRGB as identity, the full-frame pass is not needed
+        if matches!(mapping, ToneMapping::Skip)
+            && is_srgb_cicp(&primaries_xy, &white_point_xy, trc.to_characteristics())
+        {
+            return;
+        }
 
         let trc = trc.to_characteristics();
 
-        let mut new_profile = ColorProfile::default();
-        new_profile.update_rgb_colorimetry_triplet(
-            white_point,
-            red_chromaticity.to_xyzd(),
-            green_chromaticity.to_xyzd(),
-            blue_chromaticity.to_xyzd(),
-        );
-        new_profile.cicp = Some(CicpProfile {
-            full_range: true,
-            color_primaries: CicpColorPrimaries::Bt709,
-            transfer_characteristics: trc,
-            matrix_coefficients: MatrixCoefficients::Bt709,
-        });
-
-        let dst_image = std::slice::from_raw_parts_mut(image, stride as usize * height as usize);
-        let src_image = dst_image.to_vec();
+        let image = std::slice::from_raw_parts_mut(image, stride as usize * height as usize);
 
         match mapping {
             ToneMapping::Skip => {
-                apply_icc_rgba8_impl(&src_image, stride, dst_image, stride, width, new_profile);
+                let transform =
+                    cached_cicp_transform_8bit(&primaries_xy, &white_point_xy, trc, || {
+                        cicp_profile(&primaries_xy, &white_point_xy, trc)
+                    });
+                if let Some(IccTransform::Transform(transform)) = transform {
+                    transform_rgba_in_place(
+                        image,
+                        stride as usize,
+                        width,
+                        threads as usize,
+                        transform.as_ref(),
+                    );
+                }
             }
             ToneMapping::Rec2408 => {
-                match create_tone_mapper_rgba(
-                    &new_profile,
-                    &ColorProfile::new_srgb(),
-                    ToneMappingMethod::Rec2408(GainHdrMetadata {
-                        display_max_brightness: 203f32,
-                        content_max_brightness: brightness,
-                    }),
-                    MappingColorSpace::Rgb(RgbToneMapperParameters {
-                        gamut_clipping: GamutClipping::Clip,
-                        exposure: 1.0,
-                    }),
-                ) {
-                    Ok(tone_mapper) => {
-                        for (src_row, dst_row) in src_image
-                            .chunks_exact(stride as usize)
-                            .zip(dst_image.chunks_exact_mut(stride as usize))
-                        {
-                            let src = &src_row[..width as usize * 4];
-                            let dst = &mut dst_row[..width as usize * 4];
+                let key = LutKey::new(&primaries_xy, &white_point_xy, trc, brightness, 8);
+                let lut = cached_lut(key, || {
+                    create_tone_mapper_rgba16(
+                        &cicp_profile(&primaries_xy, &white_point_xy, trc),
+                        &ColorProfile::new_srgb(),
+                        ToneMappingMethod::Rec2408(GainHdrMetadata {
+                            display_max_brightness: 203f32,
+                            content_max_brightness: brightness,
+                        }),
+                        MappingColorSpace::Rgb(RgbToneMapperParameters {
+                            gamut_clipping: GamutClipping::Clip,
+                            exposure: 1.0,
+                        }),
+                    )
+                    .ok()
+                    .map(|tone_mapper| {
+                        Lut3d::bake(LUT_GRID_8BIT, |src, dst| {
                             tone_mapper.tonemap_lane(src, dst).unwrap();
-                        }
-                    }
-                    Err(_) => {}
+                        })
+                    })
+                });
+                if let Some(lut) = lut {
+                    process_rows_in_place(
+                        image,
+                        stride as usize,
+                        width as usize * 4,
+                        threads as usize,
+                        |src, dst| lut.apply_lane(src, dst, 255.),
+                    );
                 }
             }
         }
@@ -217,116 +248,108 @@ pub unsafe extern "C" fn apply_tone_mapping_rgba16(
     trc: FfiTrc,
     mapping: ToneMapping,
     brightness: f32,
+    threads: u32,
 ) {
     unsafe {
-        let red_chromaticity = Chromaticity::new(
-            primaries.read_unaligned(),
-            primaries.add(1).read_unaligned(),
-        );
-        let green_chromaticity = Chromaticity::new(
-            primaries.add(2).read_unaligned(),
-            primaries.add(3).read_unaligned(),
-        );
-        let blue_chromaticity = Chromaticity::new(
-            primaries.add(4).read_unaligned(),
-            primaries.add(5).read_unaligned(),
-        );
-        let white_point = XyY {
-            x: white_point.read_unaligned() as f64,
-            y: white_point.add(1).read_unaligned() as f64,
-            yb: 1.0,
-        };
+        let primaries_xy: [f32; 6] = std::array::from_fn(|i| primaries.add(i).read_unaligned());
+        let white_point_xy = [
+            white_point.read_unaligned(),
+            white_point.add(1).read_unaligned(),
+        ];
+        // sRGB colorimetry converts to sRGB as identity, the full-frame pass is not needed
+        if matches!(mapping, ToneMapping::Skip)
+            && is_srgb_cicp(&primaries_xy, &white_point_xy, trc.to_characteristics())
+        {
+            return;
+        }
 
         let trc = trc.to_characteristics();
 
-        let mut new_profile = ColorProfile::default();
-        new_profile.update_rgb_colorimetry_triplet(
-            white_point,
-            red_chromaticity.to_xyzd(),
-            green_chromaticity.to_xyzd(),
-            blue_chromaticity.to_xyzd(),
-        );
-        new_profile.cicp = Some(CicpProfile {
-            full_range: true,
-            color_primaries: CicpColorPrimaries::Bt709,
-            transfer_characteristics: trc,
-            matrix_coefficients: MatrixCoefficients::Bt709,
-        });
-
         work_on_transmuted_ptr_u16(
             image,
             stride,
             width as usize,
             height as usize,
             true,
-            |dst: &mut [u16], d_dst_stride: usize| {
-                let src_image = dst.to_vec();
-                match mapping {
-                    ToneMapping::Skip => {
-                        apply_icc_rgba16_impl(
-                            &src_image,
-                            d_dst_stride as u32,
+            |dst: &mut [u16], d_dst_stride: usize| match mapping {
+                ToneMapping::Skip => {
+                    let transform = cached_cicp_transform_16bit(
+                        &primaries_xy,
+                        &white_point_xy,
+                        trc,
+                        bit_depth,
+                        || cicp_profile(&primaries_xy, &white_point_xy, trc),
+                    );
+                    if let Some(IccTransform::Transform(transform)) = transform {
+                        transform_rgba_in_place(
                             dst,
-                            d_dst_stride as u32,
+                            d_dst_stride,
                             width,
-                            bit_depth,
-                            &new_profile,
+                            threads as usize,
+                            transform.as_ref(),
                         );
                     }
-                    ToneMapping::Rec2408 => {
-                        let mapper = if bit_depth == 10 {
-                            create_tone_mapper_rgba10(
-                                &new_profile,
-                                &ColorProfile::new_srgb(),
-                                ToneMappingMethod::Rec2408(GainHdrMetadata {
-                                    display_max_brightness: 203.,
-                                    content_max_brightness: brightness,
-                                }),
-                                MappingColorSpace::Rgb(RgbToneMapperParameters {
-                                    gamut_clipping: GamutClipping::NoClip,
-                                    exposure: 1.0,
-                                }),
-                            )
-                        } else if bit_depth == 12 {
-                            create_tone_mapper_rgba12(
-                                &new_profile,
-                                &ColorProfile::new_srgb(),
-                                ToneMappingMethod::Rec2408(GainHdrMetadata {
-                                    display_max_brightness: 203.,
-                                    content_max_brightness: brightness,
-                                }),
-                                MappingColorSpace::Rgb(RgbToneMapperParameters {
-                                    gamut_clipping: GamutClipping::NoClip,
-                                    exposure: 1.0,
-                                }),
-                            )
-                        } else {
-                            create_tone_mapper_rgba16(
-                                &new_profile,
-                                &ColorProfile::new_srgb(),
-                                ToneMappingMethod::Rec2408(GainHdrMetadata {
-                                    display_max_brightness: 203.,
-                                    content_max_brightness: brightness,
-                                }),
-                                MappingColorSpace::YRgb(CommonToneMapperParameters {
-                                    gamut_clipping: GamutClipping::NoClip,
-                                    exposure: 1.0,
-                                }),
-                            )
-                        };
-                        match mapper {
-                            Ok(tone_mapper) => {
-                                for (src_row, dst_row) in src_image
-                                    .chunks_exact(d_dst_stride)
-                                    .zip(dst.chunks_exact_mut(d_dst_stride))
-                                {
-                                    let src = &src_row[..width as usize * 4];
-                                    let dst = &mut dst_row[..width as usize * 4];
+                }
+                ToneMapping::Rec2408 if bit_depth == 10 || bit_depth == 12 => {
+                    // Lattice is normalized and the chain is the same, 12-bit shares 10-bit table
+                    let key = LutKey::new(&primaries_xy, &white_point_xy, trc, brightness, 10);
+                    let lut = cached_lut(key, || {
+                        create_tone_mapper_rgba16(
+                            &cicp_profile(&primaries_xy, &white_point_xy, trc),
+                            &ColorProfile::new_srgb(),
+                            ToneMappingMethod::Rec2408(GainHdrMetadata {
+                                display_max_brightness: 203.,
+                                content_max_brightness: brightness,
+                            }),
+                            MappingColorSpace::Rgb(RgbToneMapperParameters {
+                                gamut_clipping: GamutClipping::NoClip,
+                                exposure: 1.0,
+                            }),
+                        )
+                        .ok()
+                        .map(|tone_mapper| {
+                            Lut3d::bake(LUT_GRID_10BIT, |src, dst| {
+                                tone_mapper.tonemap_lane(src, dst).unwrap();
+                            })
+                        })
+                    });
+                    if let Some(lut) = lut {
+                        let max_value = ((1u32 << bit_depth) - 1) as f32;
+                        process_rows_in_place(
+                            dst,
+                            d_dst_stride,
+                            width as usize * 4,
+                            threads as usize,
+                            |src, dst| lut.apply_lane(src, dst, max_value),
+                        );
+                    }
+                }
+                ToneMapping::Rec2408 => {
+                    let mapper = create_tone_mapper_rgba16(
+                        &cicp_profile(&primaries_xy, &white_point_xy, trc),
+                        &ColorProfile::new_srgb(),
+                        ToneMappingMethod::Rec2408(GainHdrMetadata {
+                            display_max_brightness: 203.,
+                            content_max_brightness: brightness,
+                        }),
+                        MappingColorSpace::YRgb(CommonToneMapperParameters {
+                            gamut_clipping: GamutClipping::NoClip,
+                            exposure: 1.0,
+                        }),
+                    );
+                    match mapper {
+                        Ok(tone_mapper) => {
+                            process_rows_in_place(
+                                dst,
+                                d_dst_stride,
+                                width as usize * 4,
+                                threads as usize,
+                                |src, dst| {
                                     tone_mapper.tonemap_lane(src, dst).unwrap();
-                                }
-                            }
-                            Err(_) => {}
+                                },
+                            );
                         }
+                        Err(_) => {}
                     }
                 }
             },
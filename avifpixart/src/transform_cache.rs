@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) Radzivon Bartoshyk. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3.  Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+use crate::colorimetry::is_srgb_equivalent;
+use moxcms::{
+    CmsError, ColorProfile, Layout, TransferCharacteristics, Transform16BitExecutor,
+    Transform8BitExecutor, TransformOptions,
+};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+
+/// A handful of profiles (Display P3, Adobe RGB, some vendor ones) cover almost every image
+const CACHE_CAPACITY: usize = 8;
+
+/// Result of resolving an ICC profile against sRGB destination
+pub(crate) enum IccTransform<T: ?Sized> {
+    /// Profile is colorimetrically sRGB, pixels are already in the destination space
+    Identity,
+    Transform(Arc<T>),
+}
+
+impl<T: ?Sized> Clone for IccTransform<T> {
+    fn clone(&self) -> Self {
+        match self {
+            IccTransform::Identity => IccTransform::Identity,
+            IccTransform::Transform(transform) => IccTransform::Transform(transform.clone()),
+        }
+    }
+}
+
+/// Compiled -> sRGB transform together with the key it was built for: ICC profile bytes,
+/// or serialized CICP colorimetry. Only RGBA -> RGBA transforms are built,
+/// so the layout is implied by the key.
+struct CacheEntry<T: ?Sized> {
+    hash: u64,
+    bit_depth: u32,
+    key: Box<[u8]>,
+    transform: IccTransform<T>,
+}
+
+/// Bounded LRU, the most recently used entry lives at the end
+struct TransformLru<T: ?Sized> {
+    entries: Vec<CacheEntry<T>>,
+}
+
+impl<T: ?Sized> TransformLru<T> {
+    const fn new() -> Self {
+        Self {
+            entries: Vec::new(),
+        }
+    }
+
+    fn get(&mut self, hash: u64, bit_depth: u32, key: &[u8]) -> Option<IccTransform<T>> {
+        let position = self
+            .entries
+            .iter()
+            .position(|x| x.hash == hash && x.bit_depth == bit_depth && *x.key == *key)?;
+        let entry = self.entries.remove(position);
+        let transform = entry.transform.clone();
+        self.entries.push(entry);
+        Some(transform)
+    }
+
+    fn put(&mut self, entry: CacheEntry<T>) {
+        // Another decoder might have compiled the same profile concurrently
+        if self
+            .entries
+            .iter()
+            .any(|x| x.hash == entry.hash && x.bit_depth == entry.bit_depth && x.key == entry.key)
+        {
+            return;
+        }
+        if self.entries.len() >= CACHE_CAPACITY {
+            self.entries.remove(0);
+        }
+        self.entries.push(entry);
+    }
+}
+
+static TRANSFORMS_8BIT: Mutex<TransformLru<Transform8BitExecutor>> =
+    Mutex::new(TransformLru::new());
+static TRANSFORMS_16BIT: Mutex<TransformLru<Transform16BitExecutor>> =
+    Mutex::new(TransformLru::new());
+/// Colorimetry signalled by CICP, kept apart so serialized keys never meet ICC bytes
+static CICP_TRANSFORMS_8BIT: Mutex<TransformLru<Transform8BitExecutor>> =
+    Mutex::new(TransformLru::new());
+static CICP_TRANSFORMS_16BIT: Mutex<TransformLru<Transform16BitExecutor>> =
+    Mutex::new(TransformLru::new());
+static CACHE_HITS: AtomicU64 = AtomicU64::new(0);
+static CACHE_MISSES: AtomicU64 = AtomicU64::new(0);
+
+/// FNV-1a, profiles are a few kilobytes and equal bytes are verified on hit anyway
+fn icc_hash(key: &[u8]) -> u64 {
+    let mut hash = 0xcbf29ce484222325u64;
+    for &byte in key {
+        hash ^= byte as u64;
+        hash = hash.wrapping_mul(0x100000001b3);
+    }
+    hash
+}
+
+fn cached_transform<T: ?Sized>(
+    cache: &Mutex<TransformLru<T>>,
+    key: &[u8],
+    bit_depth: u32,
+    profile: impl FnOnce() -> Option<ColorProfile>,
+    create: impl FnOnce(&ColorProfile) -> Result<Arc<T>, CmsError>,
+) -> Option<IccTransform<T>> {
+    let hash = icc_hash(key);
+    if let Ok(mut lru) = cache.lock() {
+        if let Some(transform) = lru.get(hash, bit_depth, key) {
+            CACHE_HITS.fetch_add(1, Ordering::Relaxed);
+            return Some(transform);
+        }
+    }
+    CACHE_MISSES.fetch_add(1, Ordering::Relaxed);
+
+    // Compiled outside the lock so other decoders are not stalled behind a slow profile
+    let profile = profile()?;
+    let transform = if is_srgb_equivalent(&profile) {
+        IccTransform::Identity
+    } else {
+        IccTransform::Transform(create(&profile).ok()?)
+    };
+    if let Ok(mut lru) = cache.lock() {
+        lru.put(CacheEntry {
+            hash,
+            bit_depth,
+            key: key.into(),
+            transform: transform.clone(),
+        });
+    }
+    Some(transform)
+}
+
+pub(crate) fn create_srgb_transform_8bit(
+    profile: &ColorProfile,
+) -> Result<Arc<Transform8BitExecutor>, CmsError> {
+    profile.create_transform_8bit(
+        Layout::Rgba,
+        &ColorProfile::new_srgb(),
+        Layout::Rgba,
+        TransformOptions::default(),
+    )
+}
+
+pub(crate) fn create_srgb_transform_16bit(
+    profile: &ColorProfile,
+    bit_depth: u32,
+) -> Result<Arc<Transform16BitExecutor>, CmsError> {
+    let dst_profile = ColorProfile::new_srgb();
+    if bit_depth == 10 {
+        profile.create_transform_10bit(
+            Layout::Rgba,
+            &dst_profile,
+            Layout::Rgba,
+            TransformOptions::default(),
+        )
+    } else if bit_depth == 12 {
+        profile.create_transform_12bit(
+            Layout::Rgba,
+            &dst_profile,
+            Layout::Rgba,
+            TransformOptions::default(),
+        )
+    } else {
+        profile.create_transform_16bit(
+            Layout::Rgba,
+            &dst_profile,
+            Layout::Rgba,
+            TransformOptions::default(),
+        )
+    }
+}
+
+/// Returns ICC -> sRGB transform for 8-bit RGBA, parsed and compiled once per distinct profile
+pub(crate) fn cached_icc_transform_8bit(icc: &[u8]) -> Option<IccTransform<Transform8BitExecutor>> {
+    cached_transform(
+        &TRANSFORMS_8BIT,
+        icc,
+        8,
+        || ColorProfile::new_from_slice(icc).ok(),
+        create_srgb_transform_8bit,
+    )
+}
+
+/// Returns ICC -> sRGB transform for 10/12/16-bit RGBA, parsed and compiled once per distinct profile
+pub(crate) fn cached_icc_transform_16bit(
+    icc: &[u8],
+    bit_depth: u32,
+) -> Option<IccTransform<Transform16BitExecutor>> {
+    cached_transform(
+        &TRANSFORMS_16BIT,
+        icc,
+        bit_depth,
+        || ColorProfile::new_from_slice(icc).ok(),
+        |profile| create_srgb_transform_16bit(profile, bit_depth),
+    )
+}
+
+/// Primaries, white point and transfer function are everything a CICP profile is built from
+fn cicp_key(
+    primaries: &[f32; 6],
+    white_point: &[f32; 2],
+    trc: TransferCharacteristics,
+) -> [u8; 33] {
+    let mut key = [0u8; 33];
+    for (dst, value) in key
+        .chunks_exact_mut(4)
+        .zip(primaries.iter().chain(white_point.iter()))
+    {
+        dst.copy_from_slice(&value.to_bits().to_le_bytes());
+    }
+    key[32] = trc as u8;
+    key
+}
+
+/// Returns CICP -> sRGB transform for 8-bit RGBA, `profile` builds the source profile on a miss
+pub(crate) fn cached_cicp_transform_8bit(
+    primaries: &[f32; 6],
+    white_point: &[f32; 2],
+    trc: TransferCharacteristics,
+    profile: impl FnOnce() -> ColorProfile,
+) -> Option<IccTransform<Transform8BitExecutor>> {
+    cached_transform(
+        &CICP_TRANSFORMS_8BIT,
+        &cicp_key(primaries, white_point, trc),
+        8,
+        || Some(profile()),
+        create_srgb_transform_8bit,
+    )
+}
+
+/// Returns CICP -> sRGB transform for 10/12/16-bit RGBA, `profile` builds the source profile on a miss
+pub(crate) fn cached_cicp_transform_16bit(
+    primaries: &[f32; 6],
+    white_point: &[f32; 2],
+    trc: TransferCharacteristics,
+    bit_depth: u32,
+    profile: impl FnOnce() -> ColorProfile,
+) -> Option<IccTransform<Transform16BitExecutor>> {
+    cached_transform(
+        &CICP_TRANSFORMS_16BIT,
+        &cicp_key(primaries, white_point, trc),
+        bit_depth,
+        || Some(profile()),
+        |profile| create_srgb_transform_16bit(profile, bit_depth),
+    )
+}
+
+/// Answers of `icc_profile_is_srgb` by profile hash, most recently used at the end.
+/// Kept apart from transforms, so the question never compiles one nor counts as a miss.
+static SRGB_VERDICTS: Mutex<Vec<(u64, Box<[u8]>, bool)>> = Mutex::new(Vec::new());
+
+fn is_srgb_profile(icc: &[u8]) -> bool {
+    let hash = icc_hash(icc);
+    if let Ok(mut verdicts) = SRGB_VERDICTS.lock() {
+        if let Some(position) = verdicts.iter().position(|x| x.0 == hash && *x.1 == *icc) {
+            let entry = verdicts.remove(position);
+            let verdict = entry.2;
+            verdicts.push(entry);
+            return verdict;
+        }
+    }
+    let verdict = ColorProfile::new_from_slice(icc)
+        .map(|profile| is_srgb_equivalent(&profile))
+        .unwrap_or(false);
+    if let Ok(mut verdicts) = SRGB_VERDICTS.lock() {
+        if !verdicts.iter().any(|x| x.0 == hash && *x.1 == *icc) {
+            if verdicts.len() >= CACHE_CAPACITY {
+                verdicts.remove(0);
+            }
+            verdicts.push((hash, icc.into(), verdict));
+        }
+    }
+    verdict
+}
+
+/// Whether ICC profile converts to sRGB as identity, so colour management may be skipped
+#[no_mangle]
+pub unsafe extern "C" fn icc_profile_is_srgb(
+    icc_profile: *const u8,
+    icc_profile_size: u32,
+) -> bool {
+    if icc_profile.is_null() || icc_profile_size == 0 {
+        return false;
+    }
+    let icc_data = unsafe { std::slice::from_raw_parts(icc_profile, icc_profile_size as usize) };
+    is_srgb_profile(icc_data)
+}
+
+#[repr(C)]
+pub struct FfiTransformCacheStats {
+    pub hits: u64,
+    pub misses: u64,
+}
+
+#[no_mangle]
+pub extern "C" fn icc_transform_cache_stats() -> FfiTransformCacheStats {
+    FfiTransformCacheStats {
+        hits: CACHE_HITS.load(Ordering::Relaxed),
+        misses: CACHE_MISSES.load(Ordering::Relaxed),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn entry(id: u8) -> CacheEntry<u32> {
+        CacheEntry {
+            hash: id as u64,
+            bit_depth: 8,
+            key: vec![id; 4].into_boxed_slice(),
+            transform: IccTransform::Transform(Arc::new(id as u32)),
+        }
+    }
+
+    fn lookup(lru: &mut TransformLru<u32>, id: u8) -> Option<u32> {
+        match lru.get(id as u64, 8, &[id; 4])? {
+            IccTransform::Identity => None,
+            IccTransform::Transform(transform) => Some(*transform),
+        }
+    }
+
+    fn order(lru: &TransformLru<u32>) -> Vec<u64> {
+        lru.entries.iter().map(|x| x.hash).collect()
+    }
+
+    #[test]
+    fn test_get_promotes_entry() {
+        let mut lru = TransformLru::new();
+        for id in 0..3 {
+            lru.put(entry(id));
+        }
+        assert_eq!(lookup(&mut lru, 0), Some(0));
+        assert_eq!(order(&lru), vec![1, 2, 0]);
+        assert_eq!(lookup(&mut lru, 7), None);
+        assert_eq!(order(&lru), vec![1, 2, 0]);
+    }
+
+    #[test]
+    fn test_get_matches_whole_key() {
+        let mut lru = TransformLru::new();
+        lru.put(entry(1));
+        assert!(lru.get(1, 10, &[1; 4]).is_none());
+        assert!(lru.get(1, 8, &[2; 4]).is_none());
+        assert!(lru.get(1, 8, &[1; 4]).is_some());
+    }
+
+    #[test]
+    fn test_put_evicts_least_recently_used() {
+        let mut lru = TransformLru::new();
+        for id in 0..CACHE_CAPACITY as u8 {
+            lru.put(entry(id));
+        }
+        assert_eq!(lookup(&mut lru, 0), Some(0));
+        lru.put(entry(CACHE_CAPACITY as u8));
+        assert_eq!(lru.entries.len(), CACHE_CAPACITY);
+        assert_eq!(lookup(&mut lru, 1), None);
+        assert_eq!(lookup(&mut lru, 0), Some(0));
+        assert_eq!(
+            lookup(&mut lru, CACHE_CAPACITY as u8),
+            Some(CACHE_CAPACITY as u32)
+        );
+    }
+
+    #[test]
+    fn test_cicp_key_covers_colorimetry() {
+        const P3: [f32; 6] = [0.68, 0.32, 0.265, 0.69, 0.15, 0.06];
+        const D65: [f32; 2] = [0.3127, 0.3290];
+        let key = cicp_key(&P3, &D65, TransferCharacteristics::Srgb);
+        assert_eq!(key, cicp_key(&P3, &D65, TransferCharacteristics::Srgb));
+        assert_ne!(key, cicp_key(&P3, &D65, TransferCharacteristics::Bt709));
+        assert_ne!(
+            key,
+            cicp_key(&P3, &[0.314, 0.351], TransferCharacteristics::Srgb)
+        );
+        let mut bt709 = P3;
+        bt709[0] = 0.64;
+        assert_ne!(key, cicp_key(&bt709, &D65, TransferCharacteristics::Srgb));
+    }
+
+    #[test]
+    fn test_put_skips_duplicate() {
+        let mut lru = TransformLru::new();
+        lru.put(entry(1));
+        lru.put(entry(2));
+        let mut duplicate = entry(1);
+        duplicate.transform = IccTransform::Identity;
+        lru.put(duplicate);
+        assert_eq!(order(&lru), vec![1, 2]);
+        assert_eq!(lookup(&mut lru, 1), Some(1));
+    }
+}
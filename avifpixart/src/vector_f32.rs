@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) Radzivon Bartoshyk. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3.  Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//! Four float lanes over NEON or SSE2, the baselines of arm64 and x86 Android targets.
+//! armv7 is built without NEON, there lanes are a plain array the compiler may vectorize.
+
+#[cfg(target_arch = "aarch64")]
+use std::arch::aarch64::*;
+#[cfg(all(target_arch = "x86", target_feature = "sse2"))]
+use std::arch::x86::*;
+#[cfg(all(target_arch = "x86_64", target_feature = "sse2"))]
+use std::arch::x86_64::*;
+
+#[cfg(target_arch = "aarch64")]
+type Lanes = float32x4_t;
+#[cfg(all(
+    any(target_arch = "x86", target_arch = "x86_64"),
+    target_feature = "sse2"
+))]
+type Lanes = __m128;
+#[cfg(not(any(
+    target_arch = "aarch64",
+    all(
+        any(target_arch = "x86", target_arch = "x86_64"),
+        target_feature = "sse2"
+    )
+)))]
+type Lanes = [f32; 4];
+
+#[derive(Copy, Clone)]
+pub(crate) struct F32x4(Lanes);
+
+#[cfg(target_arch = "aarch64")]
+impl F32x4 {
+    #[inline(always)]
+    pub(crate) fn load(src: &[f32; 4]) -> F32x4 {
+        unsafe { F32x4(vld1q_f32(src.as_ptr())) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn to_array(self) -> [f32; 4] {
+        let mut dst = [0f32; 4];
+        unsafe { vst1q_f32(dst.as_mut_ptr(), self.0) };
+        dst
+    }
+
+    #[inline(always)]
+    pub(crate) fn splat(v: f32) -> F32x4 {
+        unsafe { F32x4(vdupq_n_f32(v)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn add(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(vaddq_f32(self.0, b.0)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn sub(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(vsubq_f32(self.0, b.0)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn mul(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(vmulq_f32(self.0, b.0)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn min(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(vminq_f32(self.0, b.0)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn max(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(vmaxq_f32(self.0, b.0)) }
+    }
+
+    /// self * b + c
+    #[inline(always)]
+    pub(crate) fn mul_add(self, b: F32x4, c: F32x4) -> F32x4 {
+        unsafe { F32x4(vfmaq_f32(c.0, self.0, b.0)) }
+    }
+
+    /// Drops the fraction of non-negative lanes below 2^31
+    #[inline(always)]
+    pub(crate) fn truncate(self) -> F32x4 {
+        unsafe { F32x4(vcvtq_f32_u32(vcvtq_u32_f32(self.0))) }
+    }
+
+    /// Lanes of `if_ge` where self >= b, of `otherwise` elsewhere
+    #[inline(always)]
+    pub(crate) fn select_ge(self, b: F32x4, if_ge: F32x4, otherwise: F32x4) -> F32x4 {
+        unsafe { F32x4(vbslq_f32(vcgeq_f32(self.0, b.0), if_ge.0, otherwise.0)) }
+    }
+}
+
+#[cfg(all(
+    any(target_arch = "x86", target_arch = "x86_64"),
+    target_feature = "sse2"
+))]
+impl F32x4 {
+    #[inline(always)]
+    pub(crate) fn load(src: &[f32; 4]) -> F32x4 {
+        unsafe { F32x4(_mm_loadu_ps(src.as_ptr())) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn to_array(self) -> [f32; 4] {
+        let mut dst = [0f32; 4];
+        unsafe { _mm_storeu_ps(dst.as_mut_ptr(), self.0) };
+        dst
+    }
+
+    #[inline(always)]
+    pub(crate) fn splat(v: f32) -> F32x4 {
+        unsafe { F32x4(_mm_set1_ps(v)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn add(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(_mm_add_ps(self.0, b.0)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn sub(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(_mm_sub_ps(self.0, b.0)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn mul(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(_mm_mul_ps(self.0, b.0)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn min(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(_mm_min_ps(self.0, b.0)) }
+    }
+
+    #[inline(always)]
+    pub(crate) fn max(self, b: F32x4) -> F32x4 {
+        unsafe { F32x4(_mm_max_ps(self.0, b.0)) }
+    }
+
+    /// self * b + c, FMA is not in the x86 Android baseline
+    #[inline(always)]
+    pub(crate) fn mul_add(self, b: F32x4, c: F32x4) -> F32x4 {
+        unsafe { F32x4(_mm_add_ps(_mm_mul_ps(self.0, b.0), c.0)) }
+    }
+
+    /// Drops the fraction of non-negative lanes below 2^31
+    #[inline(always)]
+    pub(crate) fn truncate(self) -> F32x4 {
+        unsafe { F32x4(_mm_cvtepi32_ps(_mm_cvttps_epi32(self.0))) }
+    }
+
+    /// Lanes of `if_ge` where self >= b, of `otherwise` elsewhere
+    #[inline(always)]
+    pub(crate) fn select_ge(self, b: F32x4, if_ge: F32x4, otherwise: F32x4) -> F32x4 {
+        unsafe {
+            let mask = _mm_cmpge_ps(self.0, b.0);
+            F32x4(_mm_or_ps(
+                _mm_and_ps(mask, if_ge.0),
+                _mm_andnot_ps(mask, otherwise.0),
+            ))
+        }
+    }
+}
+
+#[cfg(not(any(
+    target_arch = "aarch64",
+    all(
+        any(target_arch = "x86", target_arch = "x86_64"),
+        target_feature = "sse2"
+    )
+)))]
+impl F32x4 {
+    #[inline(always)]
+    fn zip(self, b: F32x4, op: impl Fn(f32, f32) -> f32) -> F32x4 {
+        F32x4(std::array::from_fn(|i| op(self.0[i], b.0[i])))
+    }
+
+    #[inline(always)]
+    pub(crate) fn load(src: &[f32; 4]) -> F32x4 {
+        F32x4(*src)
+    }
+
+    #[inline(always)]
+    pub(crate) fn to_array(self) -> [f32; 4] {
+        self.0
+    }
+
+    #[inline(always)]
+    pub(crate) fn splat(v: f32) -> F32x4 {
+        F32x4([v; 4])
+    }
+
+    #[inline(always)]
+    pub(crate) fn add(self, b: F32x4) -> F32x4 {
+        self.zip(b, |a, b| a + b)
+    }
+
+    #[inline(always)]
+    pub(crate) fn sub(self, b: F32x4) -> F32x4 {
+        self.zip(b, |a, b| a - b)
+    }
+
+    #[inline(always)]
+    pub(crate) fn mul(self, b: F32x4) -> F32x4 {
+        self.zip(b, |a, b| a * b)
+    }
+
+    #[inline(always)]
+    pub(crate) fn min(self, b: F32x4) -> F32x4 {
+        self.zip(b, f32::min)
+    }
+
+    #[inline(always)]
+    pub(crate) fn max(self, b: F32x4) -> F32x4 {
+        self.zip(b, f32::max)
+    }
+
+    /// self * b + c
+    #[inline(always)]
+    pub(crate) fn mul_add(self, b: F32x4, c: F32x4) -> F32x4 {
+        self.mul(b).add(c)
+    }
+
+    /// Drops the fraction of non-negative lanes below 2^31
+    #[inline(always)]
+    pub(crate) fn truncate(self) -> F32x4 {
+        F32x4(self.0.map(f32::trunc))
+    }
+
+    /// Lanes of `if_ge` where self >= b, of `otherwise` elsewhere
+    #[inline(always)]
+    pub(crate) fn select_ge(self, b: F32x4, if_ge: F32x4, otherwise: F32x4) -> F32x4 {
+        F32x4(std::array::from_fn(|i| {
+            if self.0[i] >= b.0[i] {
+                if_ge.0[i]
+            } else {
+                otherwise.0[i]
+            }
+        }))
+    }
+}